@@ -0,0 +1,378 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../common/api.h"
+#include "../common/model.h"
+#include "../common/rules.h"
+#include "../common/simd.h"
+#include "../common/utils.h"
+
+#define INPUTS 4096 // operations per sample
+#define DEFAULT_SAMPLES 200
+#define MAX_GAME_PLIES 60
+#define RESULT_FORMAT "awalnet_bench 1"
+
+/*
+ * Micro-benchmarks of the hot paths of model.c, api.c and utils.c.
+ * Each benchmark runs INPUTS operations per sample on inputs drawn like real games (positions of random games,
+ * users with bios of every length), and reports the mean, standard deviation and minimum of the samples in ns per
+ * operation, with hardware counters per operation when perf_event_open is allowed.
+ * Mutated inputs are restored between the samples, out of the timed part.
+ * The numbers are those of the build flags of the Makefile.
+ */
+
+// ---------------------- INPUTS ---------------------- //
+static Game positions[INPUTS]; // reached by random games
+static int moves[INPUTS]; // a legal pit (0-11) of the player to move in each position
+static int players[INPUTS];
+static Game sown[INPUTS]; // positions after moveSeeds, before the capture
+static int last_pits[INPUTS];
+static PackedBoard packed_positions[INPUTS];
+static User users[INPUTS];
+static uint8_t serialized_users[INPUTS][LEGACY_USER_SIZE];
+static uint32_t offsets[INPUTS]; // aligned and unaligned offsets in int_buffer
+static uint8_t int_buffer[INPUTS * 4 + 8];
+
+// mutable copies, restored before every sample
+static Game games[INPUTS];
+static PackedBoard packed_games[INPUTS];
+static User deserialized[INPUTS];
+
+static volatile long sink; // keeps the results alive
+
+static void generateInputs(unsigned int seed) {
+    Player player1 = newPlayer(1, -1), player2 = newPlayer(2, -1);
+    Game *start = newGame(&player1, &player2);
+    for (int i = 0; i < INPUTS; i++) {
+        Game game = *start;
+        int player = 1;
+        int plies = rand_r(&seed) % MAX_GAME_PLIES;
+        for (int p = 0; p < plies && legalMoves(&game, player); p++) {
+            unsigned int legal = legalMoves(&game, player);
+            int move;
+            do move = rand_r(&seed) % 6 + 1; while (!((legal >> (move - 1)) & 1));
+            playMove(&game, player, move);
+            player = 3 - player;
+        }
+        if (!legalMoves(&game, player)) {
+            // a finished game: start over from the beginning
+            game = *start;
+            player = 1;
+        }
+        unsigned int legal = legalMoves(&game, player);
+        int move;
+        do move = rand_r(&seed) % 6 + 1; while (!((legal >> (move - 1)) & 1));
+        positions[i] = game;
+        players[i] = player;
+        moves[i] = (player == 1 ? 0 : 6) + move - 1;
+        packed_positions[i] = packBoard(game.board);
+        sown[i] = game;
+        last_pits[i] = moveSeeds(&sown[i], moves[i]);
+
+        User user = newUser("", "");
+        snprintf(user.username, sizeof(user.username), "player%d", rand_r(&seed) % 100000);
+        int bio_len = rand_r(&seed) % 400;
+        user.bio = malloc(bio_len + 1);
+        for (int c = 0; c < bio_len; c++) user.bio[c] = (char) ('a' + rand_r(&seed) % 26);
+        user.bio[bio_len] = '\0';
+        user.total_games = rand_r(&seed) % 1000;
+        user.total_wins = rand_r(&seed) % (user.total_games + 1);
+        users[i] = user;
+        serialize_User(&users[i], serialized_users[i]);
+
+        offsets[i] = (uint32_t) (rand_r(&seed) % (INPUTS * 4 + 4));
+    }
+    for (size_t b = 0; b < sizeof(int_buffer); b++) int_buffer[b] = (uint8_t) rand_r(&seed);
+    free(start);
+}
+
+// ---------------------- BENCHMARKS ---------------------- //
+static void resetGames(void) {
+    memcpy(games, positions, sizeof(games));
+}
+
+static void resetSown(void) {
+    memcpy(games, sown, sizeof(games));
+}
+
+static void resetPacked(void) {
+    memcpy(packed_games, packed_positions, sizeof(packed_games));
+}
+
+static void freeDeserialized(void) {
+    for (int i = 0; i < INPUTS; i++) {
+        free(deserialized[i].bio);
+        deserialized[i].bio = NULL;
+    }
+}
+
+static void runMoveSeeds(void) {
+    long sum = 0;
+    for (int i = 0; i < INPUTS; i++) sum += moveSeeds(&games[i], moves[i]);
+    sink = sum;
+}
+
+static void runCollect(void) {
+    long sum = 0;
+    for (int i = 0; i < INPUTS; i++) sum += collectSeedsAndCountPoints(&games[i], last_pits[i], players[i]);
+    sink = sum;
+}
+
+static void runPlayerSeedsLeft(void) {
+    long sum = 0;
+    for (int i = 0; i < INPUTS; i++) sum += playerSeedsLeft(&positions[i], players[i]);
+    sink = sum;
+}
+
+static void runPackedMoveSeeds(void) {
+    long sum = 0;
+    for (int i = 0; i < INPUTS; i++) sum += packedMoveSeeds(&packed_games[i], moves[i]);
+    sink = sum;
+}
+
+static void runPackedPlayerSeedsLeft(void) {
+    long sum = 0;
+    for (int i = 0; i < INPUTS; i++) sum += packedPlayerSeedsLeft(&packed_positions[i], players[i]);
+    sink = sum;
+}
+
+static void runPlayMove(void) {
+    long sum = 0;
+    for (int i = 0; i < INPUTS; i++) sum += playMove(&games[i], players[i], moves[i] % 6 + 1);
+    sink = sum;
+}
+
+static void runSerializeUser(void) {
+    static uint8_t buffer[LEGACY_USER_SIZE];
+    long sum = 0;
+    for (int i = 0; i < INPUTS; i++) {
+        serialize_User(&users[i], buffer);
+        sum += buffer[40];
+    }
+    sink = sum;
+}
+
+static void runDeserializeUser(void) {
+    long sum = 0;
+    for (int i = 0; i < INPUTS; i++) {
+        deserialize_User(serialized_users[i], &deserialized[i]);
+        sum += deserialized[i].id;
+    }
+    sink = sum;
+}
+
+static void runReadInt32(void) {
+    long sum = 0;
+    for (int i = 0; i < INPUTS; i++) sum += read_int32_le(int_buffer, offsets[i]);
+    sink = sum;
+}
+
+static void runWriteInt32(void) {
+    for (int i = 0; i < INPUTS; i++) write_int32_le(int_buffer, offsets[i], (int32_t) i);
+    sink = int_buffer[0];
+}
+
+typedef struct Benchmark {
+    const char *name;
+    void (*reset)(void); // untimed, before every sample, NULL if nothing to restore
+    void (*run)(void); // INPUTS operations
+} Benchmark;
+
+static const Benchmark benchmarks[] = {
+    {"moveSeeds", resetGames, runMoveSeeds},
+    {"collectSeedsAndCountPoints", resetSown, runCollect},
+    {"playerSeedsLeft", NULL, runPlayerSeedsLeft},
+    {"packedMoveSeeds", resetPacked, runPackedMoveSeeds},
+    {"packedPlayerSeedsLeft", NULL, runPackedPlayerSeedsLeft},
+    {"playMove", resetGames, runPlayMove},
+    {"serialize_User", NULL, runSerializeUser},
+    {"deserialize_User", freeDeserialized, runDeserializeUser},
+    {"read_int32_le", NULL, runReadInt32},
+    {"write_int32_le", NULL, runWriteInt32},
+};
+
+#define NB_BENCHMARKS ((int) (sizeof(benchmarks) / sizeof(benchmarks[0])))
+
+// ---------------------- HARDWARE COUNTERS ---------------------- //
+typedef enum Counter {
+    COUNTER_CACHE_REFERENCES,
+    COUNTER_CACHE_MISSES,
+    COUNTER_INSTRUCTIONS,
+    NB_COUNTERS
+} Counter;
+
+static const uint64_t counter_configs[NB_COUNTERS] = {
+    PERF_COUNT_HW_CACHE_REFERENCES, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_INSTRUCTIONS
+};
+static int counter_fds[NB_COUNTERS] = {-1, -1, -1};
+
+// Counters of this thread, in user space. Returns 0 if at least one could be opened.
+static int openCounters(void) {
+    int opened = 0;
+    for (int c = 0; c < NB_COUNTERS; c++) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = counter_configs[c];
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        counter_fds[c] = (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        if (counter_fds[c] >= 0) opened++;
+    }
+    return opened ? 0 : -1;
+}
+
+static void controlCounters(unsigned long request) {
+    for (int c = 0; c < NB_COUNTERS; c++) {
+        if (counter_fds[c] >= 0) ioctl(counter_fds[c], request, 0);
+    }
+}
+
+// -1 when the counter is not available
+static double counterPerOp(Counter counter, long ops) {
+    uint64_t value;
+    if (counter_fds[counter] < 0 || read(counter_fds[counter], &value, sizeof(value)) != sizeof(value)) return -1;
+    return (double) value / (double) ops;
+}
+
+// ---------------------- RUN ---------------------- //
+typedef struct Result {
+    const char *name;
+    long ops;
+    double mean_ns;
+    double stddev_ns;
+    double min_ns;
+    double counters[NB_COUNTERS]; // per operation, -1 when not available
+} Result;
+
+static double nowNs(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double) now.tv_sec * 1e9 + (double) now.tv_nsec;
+}
+
+static Result runBenchmark(const Benchmark *benchmark, int samples) {
+    Result result = {benchmark->name, (long) samples * INPUTS, 0, 0, 0, {0}};
+    // warm up the caches and the branch predictors
+    if (benchmark->reset) benchmark->reset();
+    benchmark->run();
+
+    double sum = 0, sum_squares = 0, min = 0;
+    controlCounters(PERF_EVENT_IOC_RESET);
+    for (int s = 0; s < samples; s++) {
+        if (benchmark->reset) benchmark->reset();
+        controlCounters(PERF_EVENT_IOC_ENABLE);
+        double start = nowNs();
+        benchmark->run();
+        double ns = (nowNs() - start) / INPUTS;
+        controlCounters(PERF_EVENT_IOC_DISABLE);
+        sum += ns;
+        sum_squares += ns * ns;
+        if (s == 0 || ns < min) min = ns;
+    }
+    if (benchmark->reset) benchmark->reset();
+    result.mean_ns = sum / samples;
+    double variance = sum_squares / samples - result.mean_ns * result.mean_ns;
+    result.stddev_ns = variance > 0 ? sqrt(variance) : 0;
+    result.min_ns = min;
+    for (int c = 0; c < NB_COUNTERS; c++) result.counters[c] = counterPerOp((Counter) c, result.ops);
+    return result;
+}
+
+// Mean ns/op of @name in a result file, -1 if it is not there
+static double previousMean(FILE *previous, const char *name) {
+    char line[512], other[128];
+    double mean;
+    rewind(previous);
+    while (fgets(line, sizeof(line), previous)) {
+        if (line[0] == '#') continue;
+        if (sscanf(line, "%127s %*s %lf", other, &mean) == 2 && strcmp(other, name) == 0) return mean;
+    }
+    return -1;
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "Usage: %s [--samples N] [--seed S] [--filter NAME] [--label TEXT] [--output FILE] [--compare FILE]\n",
+            name);
+}
+
+int main(int argc, char **argv) {
+    int samples = DEFAULT_SAMPLES;
+    unsigned int seed = 42;
+    const char *filter = NULL, *label = "", *output = NULL, *compare = NULL;
+    for (int a = 1; a < argc; a++) {
+        if (strcmp(argv[a], "--samples") == 0 && a + 1 < argc) {
+            samples = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "--seed") == 0 && a + 1 < argc) {
+            seed = (unsigned int) strtoul(argv[++a], NULL, 10);
+        } else if (strcmp(argv[a], "--filter") == 0 && a + 1 < argc) {
+            filter = argv[++a];
+        } else if (strcmp(argv[a], "--label") == 0 && a + 1 < argc) {
+            label = argv[++a];
+        } else if (strcmp(argv[a], "--output") == 0 && a + 1 < argc) {
+            output = argv[++a];
+        } else if (strcmp(argv[a], "--compare") == 0 && a + 1 < argc) {
+            compare = argv[++a];
+        } else {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (samples < 1) samples = 1;
+
+    FILE *previous = compare ? fopen(compare, "r") : NULL;
+    if (compare && !previous) {
+        perror(compare);
+        return EXIT_FAILURE;
+    }
+    FILE *out = output ? fopen(output, "w") : NULL;
+    if (output && !out) {
+        perror(output);
+        return EXIT_FAILURE;
+    }
+
+    generateInputs(seed);
+    if (openCounters() < 0) {
+        fprintf(stderr, "perf_event_open: %s, hardware counters disabled\n", strerror(errno));
+    }
+    printf("%d samples of %d operations, row kernels %s\n", samples, INPUTS, rowKernels()->name);
+    printf("%-28s %10s %9s %9s %10s %10s %10s%s\n", "benchmark", "ns/op", "stddev", "min", "cache-ref", "cache-miss",
+           "instr", previous ? "    vs ref" : "");
+    if (out) {
+        fprintf(out, "# %s label=%s kernels=%s samples=%d\n", RESULT_FORMAT, label, rowKernels()->name, samples);
+        fprintf(out, "# name ops ns_per_op stddev_ns min_ns cache_references_per_op cache_misses_per_op "
+                     "instructions_per_op\n");
+    }
+
+    for (int b = 0; b < NB_BENCHMARKS; b++) {
+        if (filter && !strstr(benchmarks[b].name, filter)) continue;
+        Result r = runBenchmark(&benchmarks[b], samples);
+        printf("%-28s %10.2f %9.2f %9.2f", r.name, r.mean_ns, r.stddev_ns, r.min_ns);
+        for (int c = 0; c < NB_COUNTERS; c++) {
+            if (r.counters[c] < 0) printf(" %10s", "n/a");
+            else printf(" %10.3f", r.counters[c]);
+        }
+        double reference = previous ? previousMean(previous, r.name) : -1;
+        if (reference > 0) printf("  %+7.1f%%", 100.0 * (r.mean_ns - reference) / reference);
+        printf("\n");
+        if (out) {
+            fprintf(out, "%s %ld %.3f %.3f %.3f %.4f %.4f %.2f\n", r.name, r.ops, r.mean_ns, r.stddev_ns, r.min_ns,
+                    r.counters[COUNTER_CACHE_REFERENCES], r.counters[COUNTER_CACHE_MISSES],
+                    r.counters[COUNTER_INSTRUCTIONS]);
+        }
+    }
+    if (out) fclose(out);
+    if (previous) fclose(previous);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,160 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../common/ai.h"
+#include "../common/book.h"
+#include "../common/model.h"
+#include "../common/rules.h"
+
+#define DEFAULT_GAMES 2000
+#define DEFAULT_TIME_MS 20
+#define DEFAULT_EXPLORE 30 // percent of random moves
+#define DEFAULT_OUTPUT "awalnet.book"
+#define SEARCH_TT_ENTRIES (1 << 20)
+
+/*
+ * Self-play driver growing the opening book: games start from the newGame() position and, up to --plies moves,
+ * every position met is searched once and stored with its best move. The games follow the book moves, except for a
+ * share of random moves that makes them branch out. An existing book at --output is loaded first and extended.
+ */
+
+// Positions of the book being built, open addressing on the key
+typedef struct BookMap {
+    BookEntry *slots; // key 0 marks an empty slot
+    uint32_t capacity; // power of two
+    uint32_t count;
+} BookMap;
+
+static BookEntry *mapFind(BookMap *map, uint64_t key, int insert) {
+    uint32_t mask = map->capacity - 1;
+    for (uint32_t i = (uint32_t) key & mask;; i = (i + 1) & mask) {
+        if (map->slots[i].key == key) return &map->slots[i];
+        if (map->slots[i].key == 0) {
+            if (!insert) return NULL;
+            map->slots[i].key = key;
+            map->count++;
+            return &map->slots[i];
+        }
+    }
+}
+
+static int mapReserve(BookMap *map, uint32_t count) {
+    if ((uint64_t) (count + 1) * 2 <= map->capacity) return 0;
+    BookMap grown = {NULL, map->capacity ? map->capacity * 2 : 1024, 0};
+    while ((uint64_t) (count + 1) * 2 > grown.capacity) grown.capacity *= 2;
+    grown.slots = calloc(grown.capacity, sizeof(BookEntry));
+    if (!grown.slots) return -1;
+    for (uint32_t i = 0; i < map->capacity; i++) {
+        if (map->slots[i].key) *mapFind(&grown, map->slots[i].key, 1) = map->slots[i];
+    }
+    free(map->slots);
+    *map = grown;
+    return 0;
+}
+
+static int randomLegalMove(unsigned int legal, unsigned int *seed) {
+    int moves[6], count = 0;
+    for (int move = 1; move <= 6; move++) {
+        if ((legal >> (move - 1)) & 1) moves[count++] = move;
+    }
+    return moves[rand_r(seed) % count];
+}
+
+int main(int argc, char **argv) {
+    long games = DEFAULT_GAMES;
+    int plies = MAX_ROUNDS + 1;
+    AiLimits limits = {0, DEFAULT_TIME_MS, 0};
+    int explore = DEFAULT_EXPLORE;
+    unsigned int seed = (unsigned int) time(NULL);
+    const char *output = DEFAULT_OUTPUT;
+    for (int a = 1; a < argc; a++) {
+        if (strcmp(argv[a], "--games") == 0 && a + 1 < argc) {
+            games = atol(argv[++a]);
+        } else if (strcmp(argv[a], "--plies") == 0 && a + 1 < argc) {
+            plies = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "--nodes") == 0 && a + 1 < argc) {
+            limits.max_nodes = atol(argv[++a]);
+        } else if (strcmp(argv[a], "--time") == 0 && a + 1 < argc) {
+            limits.max_time_ms = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "--explore") == 0 && a + 1 < argc) {
+            explore = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "--seed") == 0 && a + 1 < argc) {
+            seed = (unsigned int) strtoul(argv[++a], NULL, 10);
+        } else if (strcmp(argv[a], "--output") == 0 && a + 1 < argc) {
+            output = argv[++a];
+        } else {
+            fprintf(stderr, "Usage: %s [--games N] [--plies N] [--nodes N] [--time MS] [--explore PERCENT] [--seed S]"
+                            " [--output FILE]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    BookMap map = {NULL, 0, 0};
+    Book previous;
+    if (bookOpen(&previous, output) == 0) {
+        if (mapReserve(&map, previous.count) < 0) return EXIT_FAILURE;
+        for (uint32_t i = 0; i < previous.count; i++) {
+            BookEntry entry;
+            bookEntryAt(&previous, i, &entry);
+            *mapFind(&map, entry.key, 1) = entry;
+        }
+        printf("Loaded %u positions from %s\n", previous.count, output);
+        bookClose(&previous);
+    }
+
+    AiSearch *search = aiCreate(SEARCH_TT_ENTRIES);
+    Player player1 = newPlayer(1, -1), player2 = newPlayer(2, -1);
+    Game *start = newGame(&player1, &player2);
+    if (!search || !start || mapReserve(&map, map.count) < 0) {
+        fprintf(stderr, "Out of memory\n");
+        return EXIT_FAILURE;
+    }
+    AiPosition start_position = aiPositionOfGame(start, 0);
+
+    uint32_t known = map.count;
+    long searched_nodes = 0;
+    clock_t begin = clock();
+    for (long g = 0; g < games; g++) {
+        AiPosition position = start_position;
+        for (int ply = 0; ply < plies; ply++) {
+            unsigned int legal = packedLegalMoves(&position.board, position.to_move);
+            if (!legal || mapReserve(&map, map.count + 1) < 0) break;
+            uint64_t key = aiHash(&position);
+            BookEntry *entry = mapFind(&map, key, 0);
+            if (!entry) {
+                AiResult result = aiBestMove(search, &position, &limits);
+                searched_nodes += result.nodes;
+                entry = mapFind(&map, key, 1);
+                entry->value = result.value;
+                entry->move = result.move;
+                entry->depth = result.depth;
+                entry->visits = 0;
+            }
+            entry->visits++;
+            int move = rand_r(&seed) % 100 < explore ? randomLegalMove(legal, &seed) : entry->move;
+            if (aiPlay(&position, move) != 0) break;
+        }
+    }
+    double seconds = (double) (clock() - begin) / CLOCKS_PER_SEC;
+
+    BookEntry *entries = malloc((map.count ? map.count : 1) * sizeof(BookEntry));
+    if (!entries) return EXIT_FAILURE;
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < map.capacity; i++) {
+        if (map.slots[i].key) entries[count++] = map.slots[i];
+    }
+    if (bookWrite(output, entries, count) < 0) {
+        perror(output);
+        return EXIT_FAILURE;
+    }
+    printf("%ld games, %u new positions (%ld nodes searched) in %.1f s\n", games, count - known, searched_nodes, seconds);
+    printf("Book written to %s: %u positions, %u bytes\n", output, count, BOOK_HEADER_SIZE + count * BOOK_ENTRY_SIZE);
+    free(entries);
+    free(map.slots);
+    free(start);
+    aiDestroy(search);
+    return EXIT_SUCCESS;
+}
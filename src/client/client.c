@@ -1,3 +1,4 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -12,6 +13,7 @@
 #include "../common/api.h"
 #include "../common/model.h"
 #include "../common/utils.h"
+#include "../common/framing.h"
 
 // Global client state
 static int client_fd = -1;
@@ -20,19 +22,28 @@ static pthread_t network_thread;
 // Notification pipe: [0] = read, [1] = write
 static int notification_pipe[2] = {-1, -1};
 
+// Processing of a message received from the server: calls the matching gui function
+typedef void (*MessageHandler)(Message *m);
+
 // Network message handling
 static int incoming_available = 0;
 static CallType incoming_call_type;
-static uint8_t *incoming_payload;
+static Message incoming_message;
 static pthread_mutex_t incoming_lock = PTHREAD_MUTEX_INITIALIZER;
 
+// Protocol version agreed with the server, known once CONNECT_CONFIRM is received
+static uint8_t protocol_version = PROTOCOL_V1;
+
+// Both the UI thread and the network thread send frames: a frame must never be interleaved with another
+static pthread_mutex_t send_lock = PTHREAD_MUTEX_INITIALIZER;
+
 static void network_error(void) {
     printf("Erreur: Connexion au serveur perdue.\n");
     exit(EXIT_FAILURE);
 }
 
 void *listen_server(void *arg);
-void process_sync_call(CallType type, int payload_size, uint8_t* payload);
+static const MessageHandler handlers[NB_CALL_TYPES];
 
 /*
  * Initialize the connexion and start the network thread
@@ -85,57 +96,190 @@ void *listen_server(void *arg) {
     int fd = *(int *) arg;
     free(arg);
 
-    CallType call_type;
+    FrameBuffer in;
+    frame_buffer_init(&in);
     while (1) {
-        // Read CallType
-        size_t n = recv(fd, &call_type, sizeof(CallType), 0);
-        if (n <= 0) network_error();
-
-        int is_sync = is_client_sync_CallType(call_type);
-        int is_async = is_client_async_CallType(call_type);
-        if (!is_sync && !is_async) {
-            printf("Avertissement: Réception d'un CallType invalide : %d\n", call_type);
-            continue;
-        }
+        // Blocking read of whatever is available, then handle every complete frame it contains
+        if (frame_buffer_fill(&in, fd, 0) <= 0) network_error();
+
+        Frame frame;
+        int ret;
+        while ((ret = frame_buffer_next(&in, &frame)) > 0) {
+            const CallDescriptor *call = describe_CallType(frame.type);
+            if (!call || !(call->flags & (CALL_TO_CLIENT_SYNC | CALL_TO_CLIENT_ASYNC)) || !handlers[frame.type]) {
+                printf("Avertissement: Réception d'un CallType invalide : %d\n", frame.type);
+                continue;
+            }
 
-        // Read Payload size
-        uint32_t payload_size;
-        n = recv(fd, &payload_size, sizeof(uint32_t), 0);
-        if (n <= 0) network_error();
-
-        // Read Payload
-        uint8_t *payload = malloc(sizeof(uint8_t) * payload_size);
-        n = recv(fd, payload, payload_size, 0);
-        if (n <= 0) network_error();
-
-        // Print
-        //printf("Receiving CallType %d with payload size %d: ", call_type, payload_size);
-        //for (int i = 0; i < payload_size; i++) printf("%02x", payload[i]);
-        //printf("\n");
-
-        if (is_async) {
-            // Save data
-            pthread_mutex_lock(&incoming_lock);
-            // Wait until the last payload has been processed
-            while (incoming_available) {
-                pthread_mutex_unlock(&incoming_lock);
-                usleep(10000);
+            // The version is given by the confirmation itself, it is then used for everything else
+            uint8_t version = frame.type == CONNECT_CONFIRM ? connect_confirm_version(frame.payload_size) : protocol_version;
+            Message message;
+            if (decode_Message(frame.type, 0, version, frame.payload, frame.payload_size, &message) < 0) {
+                printf("Avertissement: Message %d mal formé reçu du serveur (%u octets)\n", frame.type, frame.payload_size);
+                continue;
+            }
+            if (frame.type == CONNECT_CONFIRM) {
+                protocol_version = version;
+            }
+
+            if (call->flags & CALL_TO_CLIENT_ASYNC) {
+                // Save data
                 pthread_mutex_lock(&incoming_lock);
+                // Wait until the last payload has been processed
+                while (incoming_available) {
+                    pthread_mutex_unlock(&incoming_lock);
+                    usleep(10000);
+                    pthread_mutex_lock(&incoming_lock);
+                }
+                incoming_available = 1;
+                incoming_call_type = frame.type;
+                incoming_message = message;
+                incoming_message.user.bio = incoming_message.bio;
+                pthread_mutex_unlock(&incoming_lock);
+
+                // Notify UI thread via pipe
+                char notify = 1;
+                write(notification_pipe[1], &notify, 1);
+            } else {
+                // interruption: handled right away by the network thread
+                handlers[frame.type](&message);
             }
-            incoming_available = 1;
-            incoming_call_type = call_type;
-            incoming_payload = payload;
-            pthread_mutex_unlock(&incoming_lock);
-
-            // Notify UI thread via pipe
-            char notify = 1;
-            write(notification_pipe[1], &notify, 1);
-        } else {
-            process_sync_call(call_type, payload_size, payload);
+        }
+        if (ret < 0) {
+            printf("Erreur: Trame invalide reçue du serveur.\n");
+            network_error();
         }
     }
 }
 
+static void handle_connect_confirm(Message *m) {
+    // the user is kept by the gui, it gets its own copy of the bio
+    User user = m->user;
+    user.bio = strdup(m->bio);
+    on_connected(user);
+}
+
+static void handle_challenge(Message *m) {
+    on_challenge_received(m->ints[0], m->username);
+}
+
+static void handle_challenge_request_answer(Message *m) {
+    // response to a sent challenge
+    on_challenge_request_answer(m->ints[0], m->ints[1]);
+}
+
+static void handle_error(Message *m) {
+    // an error occurred in the previous call
+    char error_msg[256] = {0};
+    strncpy(error_msg, m->text, sizeof(error_msg) - 1);
+    on_error(m->ints[0], error_msg);
+}
+
+static void handle_success(Message *m) {
+    // confirmation of a successful previous call
+    on_success();
+}
+
+static void handle_watch_game_answer(Message *m) {
+    on_watch_game_answer(m->ints[0]);
+}
+
+static void handle_game_over_watcher(Message *m) {
+    // the server notifies that the game is over for the watcher
+    on_game_over_watcher((GAME_OVER_REASON) m->ints[0]);
+}
+
+static void handle_list_users(Message *m) {
+    on_list_users(m->text);
+}
+
+static void handle_list_ongoing_games(Message *m) {
+    on_list_ongoing_games(m->text);
+}
+
+static void handle_receive_user_profile(Message *m) {
+    // receiving a user profile we requested
+    on_receive_user_profile(m->user);
+}
+
+static void handle_does_user_exist(Message *m) {
+    on_does_user_exist(m->ints[0]);
+}
+
+static void handle_challenge_start(Message *m) {
+    on_challenge_start(m->username);
+}
+
+static void handle_your_turn(Message *m) {
+    on_your_turn(m->ints[0]);
+}
+
+static void handle_game_over(Message *m) {
+    on_game_over((GAME_OVER_REASON) m->ints[0]);
+}
+
+static void handle_play_made_watcher(Message *m) {
+    on_move_received(m->ints[0]);
+}
+
+static void handle_game_snapshot(Message *m) {
+    // position of the watched game when we joined: board, scores, moves played
+    int board[12];
+    for (int i = 0; i < 12; i++) {
+        board[i] = m->board[i];
+    }
+    on_game_snapshot(board, m->ints[0], m->ints[1], m->ints[2]);
+}
+
+// Chat messages: sender id, sender username and message
+static void handle_lobby_chat(Message *m) {
+    char message[MAX_CHAT_MESSAGE_SIZE] = {0};
+    strncpy(message, m->text, MAX_CHAT_MESSAGE_SIZE - 1);
+    on_receive_lobby_chat(m->ints[0], m->username, message);
+}
+
+static void handle_game_chat(Message *m) {
+    char message[MAX_CHAT_MESSAGE_SIZE] = {0};
+    strncpy(message, m->text, MAX_CHAT_MESSAGE_SIZE - 1);
+    on_receive_game_chat(m->ints[0], m->username, message);
+}
+
+static void handle_consult_user_profile(Message *m) {
+    // we need to sent our user profile to the server because somebody requested it
+    interrupt_consult_user_profile(m->ints[0]);
+}
+
+static void handle_user_wants_to_watch(Message *m) {
+    interrupt_user_wants_to_watch(m->ints[0]);
+}
+
+/*
+ * Handlers of the messages sent by the server, indexed by CallType.
+ * The CallType table tells whether they run in the gui loop (async) or in the network thread (sync).
+ */
+static const MessageHandler handlers[NB_CALL_TYPES] = {
+    [CONNECT_CONFIRM] = handle_connect_confirm,
+    [CHALLENGE] = handle_challenge,
+    [CHALLENGE_REQUEST_ANSWER] = handle_challenge_request_answer,
+    [ERROR] = handle_error,
+    [SUCCESS] = handle_success,
+    [WATCH_GAME_ANSWER] = handle_watch_game_answer,
+    [GAME_OVER_WATCHER] = handle_game_over_watcher,
+    [LIST_USERS] = handle_list_users,
+    [LIST_ONGOING_GAMES] = handle_list_ongoing_games,
+    [RECEIVE_USER_PROFILE] = handle_receive_user_profile,
+    [DOES_USER_EXIST] = handle_does_user_exist,
+    [CHALLENGE_START] = handle_challenge_start,
+    [YOUR_TURN] = handle_your_turn,
+    [GAME_OVER] = handle_game_over,
+    [PLAY_MADE_WATCHER] = handle_play_made_watcher,
+    [GAME_SNAPSHOT] = handle_game_snapshot,
+    [RECEIVE_LOBBY_CHAT] = handle_lobby_chat,
+    [RECEIVE_GAME_CHAT] = handle_game_chat,
+    [CONSULT_USER_PROFILE] = handle_consult_user_profile,
+    [USER_WANTS_TO_WATCH] = handle_user_wants_to_watch,
+};
+
 /*
  * This function calls gui functions from messages received asynchronously.
  * It should be called regularly by the gui to process pending calls.
@@ -152,241 +296,136 @@ int process_network_messages(void) {
     char dummy;
     read(notification_pipe[0], &dummy, 1);
 
-    if (incoming_call_type == CONNECT_CONFIRM) {
-        User user;
-        deserialize_User(incoming_payload, &user);
-        on_connected(user);
-
-    }else if (incoming_call_type == CHALLENGE) {
-        // read values from the incoming_payload, taking the four first bytes and merging them
-        int challenger_id = incoming_payload[0] + (incoming_payload[1] << 8) + (incoming_payload[2] << 16) + (incoming_payload[3] << 24);
-
-        // Read username 32 bits
-        char challenger_username[USERNAME_SIZE + 1];
-        for (int index = 0; index <= USERNAME_SIZE; index++) {
-            challenger_username[index] = incoming_payload[4 + index];
-        }
-        on_challenge_received(challenger_id, challenger_username);
-
-    } else if (incoming_call_type == CHALLENGE_REQUEST_ANSWER) {
-        // response to a sent challenge
-        int challenged_user_id = read_int32_le(incoming_payload, 0);
-        int answer = read_int32_le(incoming_payload, 4);
-
-        on_challenge_request_answer(challenged_user_id, answer);
-
-    } else if (incoming_call_type == ERROR) {
-        // an error occurred in the previous call
-        int previous_call = read_int32_le(incoming_payload, 0);
-        char error_msg[256] = {0};
-        memcpy(error_msg, incoming_payload + 4, 128);
-
-        on_error(previous_call, error_msg);
-    } else if (incoming_call_type == SUCCESS) {
-        // confirmation of a successful previous call
-        on_success();
-
-    } else if (incoming_call_type == WATCH_GAME_ANSWER){
-        int answer = incoming_payload[0] + (incoming_payload[1] << 8) + (incoming_payload[2] << 16) + (incoming_payload[3] << 24);
-        on_watch_game_answer(answer);
-
-    } else if (incoming_call_type == GAME_OVER_WATCHER){
-        // the server notifies that the game is over for the watcher
-        GAME_OVER_REASON reason = (GAME_OVER_REASON) (incoming_payload[0] + (incoming_payload[1] << 8) + (incoming_payload[2] << 16) + (
-                                                          incoming_payload[3] << 24));
-        on_game_over_watcher(reason);
-    }
-
-    else if (incoming_call_type == LIST_USERS) {
-        // receiving the list of online users
-        char user_list_buffer[1024] = {0};
-        memcpy(user_list_buffer, incoming_payload, 1024);
-        on_list_users(user_list_buffer);
-
-    } else if (incoming_call_type == LIST_ONGOING_GAMES) {
-        // receiving the list of ongoing games
-        char games_list_buffer[1024] = {0};
-        memcpy(games_list_buffer, incoming_payload, 1024);
-        on_list_ongoing_games(games_list_buffer);
-
-    } else if (incoming_call_type == RECEIVE_USER_PROFILE) {
-        // receiving a user profile we requested
-        uint8_t buffer[1024] = {0};
-        memcpy(buffer, incoming_payload, 1024);
-        on_receive_user_profile(buffer);
-
-    } else if (incoming_call_type == DOES_USER_EXIST) {
-        int does_exist = incoming_payload[0] + (incoming_payload[1] << 8) + (incoming_payload[2] << 16) + (incoming_payload[3] << 24);
-        on_does_user_exist(does_exist);
-
-    } else if (incoming_call_type == CHALLENGE_START) {
-        // the challenge has started
-        char opponent_username[USERNAME_SIZE + 1] = {0};
-        memcpy(opponent_username, incoming_payload, USERNAME_SIZE + 1);
-        on_challenge_start(opponent_username);
-
-    } else if (incoming_call_type == YOUR_TURN) {
-        // it's our turn to play
-        int move_played = incoming_payload[0] + (incoming_payload[1] << 8) + (incoming_payload[2] << 16) + (incoming_payload[3] << 24);
-        on_your_turn(move_played);
-
-    } else if (incoming_call_type == GAME_OVER) {
-        // the server notifies that the game is over
-        GAME_OVER_REASON reason = (GAME_OVER_REASON) (incoming_payload[0] + (incoming_payload[1] << 8) + (incoming_payload[2] << 16) + (
-                                                          incoming_payload[3] << 24));
-        on_game_over(reason);
-
-    } else if (incoming_call_type == PLAY_MADE_WATCHER) {
-        int move_played = incoming_payload[0] + (incoming_payload[1] << 8) + (incoming_payload[2] << 16) + (incoming_payload[3] << 24);
-        on_move_received(move_played);
-
-    } else if (incoming_call_type == RECEIVE_LOBBY_CHAT) {
-        // receiving a lobby chat message
-        int sender_id = incoming_payload[0] + (incoming_payload[1] << 8) + (incoming_payload[2] << 16) + (incoming_payload[3] << 24);
-        char sender_username[USERNAME_SIZE + 1] = {0};
-        memcpy(sender_username, incoming_payload + 4, USERNAME_SIZE + 1);
-        char message[MAX_CHAT_MESSAGE_SIZE] = {0};
-        memcpy(message, incoming_payload + 4 + USERNAME_SIZE + 1, MAX_CHAT_MESSAGE_SIZE);
-
-        on_receive_lobby_chat(sender_id, sender_username, message);
-
-    } else if (incoming_call_type == RECEIVE_GAME_CHAT) {
-        // receiving a game chat message
-        int sender_id = incoming_payload[0] + (incoming_payload[1] << 8) + (incoming_payload[2] << 16) + (incoming_payload[3] << 24);
-        char sender_username[USERNAME_SIZE + 1] = {0};
-        memcpy(sender_username, incoming_payload + 4, USERNAME_SIZE + 1);
-        char message[MAX_CHAT_MESSAGE_SIZE] = {0};
-        memcpy(message, incoming_payload + 4 + USERNAME_SIZE + 1, MAX_CHAT_MESSAGE_SIZE);
-
-        on_receive_game_chat(sender_id, sender_username, message);
-
-    } else {
-        printf("\n>>> Message inconnu reçu du serveur.\n");
-    }
+    handlers[incoming_call_type](&incoming_message);
 
     incoming_available = 0;
-    free(incoming_payload);
     pthread_mutex_unlock(&incoming_lock);
 
     return 1;
 }
 
-void process_sync_call(CallType type, int payload_size, uint8_t* payload) {
-    if (type == CONSULT_USER_PROFILE) {
-        if (payload_size != sizeof(int)) {
-            printf("Received invalid payload size %d for CallType %d", payload_size, type);
-            return;
-        }
-        // we need to sent our user profile to the server because somebody requested it
-        int request_user_id = payload[0] + (payload[1] << 8) + (payload[2] << 16) + (payload[3] << 24);
-        interrupt_consult_user_profile(request_user_id);
-    }else if (type == USER_WANTS_TO_WATCH) {
-        int user_id = payload[0] + (payload[1] << 8) + (payload[2] << 16) + (payload[3] << 24);
-        interrupt_user_wants_to_watch(user_id);
+/*
+ * Send functions
+ */
+
+/*
+ * Send a whole frame (header + payload) at once
+ */
+static int send_frame(CallType type, const void *payload, uint32_t payload_size) {
+    uint8_t *buffer = malloc(FRAME_HEADER_SIZE + payload_size);
+    if (!buffer) return -1;
+    frame_write_header(buffer, type, payload_size);
+    if (payload_size > 0) memcpy(buffer + FRAME_HEADER_SIZE, payload, payload_size);
+
+    size_t total = FRAME_HEADER_SIZE + payload_size;
+    size_t sent = 0;
+    pthread_mutex_lock(&send_lock);
+    while (sent < total) {
+        ssize_t n = send(client_fd, buffer + sent, total - sent, MSG_NOSIGNAL);
+        if (n <= 0) break;
+        sent += n;
     }
+    pthread_mutex_unlock(&send_lock);
+    free(buffer);
+    if (sent < total) {
+        perror("send failed");
+        return -1;
+    }
+    return 0;
 }
 
+// Encodes the message in the negotiated version and sends it
+static int send_message(CallType type, const Message *message) {
+    uint8_t payload[MAX_MESSAGE_SIZE];
+    int size = encode_Message(type, 1, protocol_version, message, payload, sizeof(payload));
+    if (size < 0) {
+        printf("Erreur: impossible d'encoder le message %d\n", type);
+        return -1;
+    }
+    return send_frame(type, payload, (uint32_t) size);
+}
 
+static void send_int(CallType type, int value) {
+    Message message;
+    message.ints[0] = value;
+    send_message(type, &message);
+}
 
-/*
- * Send functions
- */
+static void send_two_ints(CallType type, int first, int second) {
+    Message message;
+    message.ints[0] = first;
+    message.ints[1] = second;
+    send_message(type, &message);
+}
+
+static void send_text(CallType type, const char *text, size_t max_size) {
+    Message message;
+    snprintf(message.text, max_size < sizeof(message.text) ? max_size : sizeof(message.text), "%s", text);
+    send_message(type, &message);
+}
 
 void send_connect(const char *username) {
-    CallType call_type = CONNECT;
-    if (send(client_fd, &call_type, sizeof(CallType), 0) <= 0) {
-        perror("send failed");
-        exit(EXIT_FAILURE);
-    }
-    if (send(client_fd, username, USERNAME_SIZE + 1, 0) <= 0) {
-        perror("send failed");
+    Message message;
+    snprintf(message.username, sizeof(message.username), "%s", username);
+    // the server answers in the most recent version both sides speak
+    message.version = PROTOCOL_VERSION;
+    if (send_message(CONNECT, &message) < 0) {
         exit(EXIT_FAILURE);
     }
 }
 
 void send_list_users(void) {
-    CallType ct = LIST_USERS;
-    if (send(client_fd, &ct, sizeof(ct), 0) <= 0) perror("send failed");
+    send_frame(LIST_USERS, NULL, 0);
 }
 
 void send_challenge(int opponent_id) {
-    CallType ct = CHALLENGE;
-    if (send(client_fd, &ct, sizeof(ct), 0) <= 0) perror("send failed");
-    if (send(client_fd, &opponent_id, sizeof(int), 0) <= 0) perror("send failed");
+    send_int(CHALLENGE, opponent_id);
 }
 
 void send_consult_user_profile(int user_id) {
-    CallType ct = CONSULT_USER_PROFILE;
-    if (send(client_fd, &ct, sizeof(ct), 0) <= 0) perror("send failed");
-    if (send(client_fd, &user_id, sizeof(int), 0) <= 0) perror("send failed");
+    send_int(CONSULT_USER_PROFILE, user_id);
 }
 
 void send_list_ongoing_games(void) {
-    CallType ct = LIST_ONGOING_GAMES;
-    if (send(client_fd, &ct, sizeof(ct), 0) <= 0) perror("send failed");
+    send_frame(LIST_ONGOING_GAMES, NULL, 0);
 }
 
 void send_challenge_answer(int challenger_id, int answer) {
-    CallType ct = CHALLENGE_REQUEST_ANSWER;
-    if (send(client_fd, &ct, sizeof(ct), 0) <= 0) perror("send ct");
-    if (send(client_fd, &challenger_id, sizeof(challenger_id), 0) <= 0) perror("send id");
-    if (send(client_fd, &answer, sizeof(answer), 0) <= 0) perror("send answer");
+    send_two_ints(CHALLENGE_REQUEST_ANSWER, challenger_id, answer);
 }
 
-void send_user_profile(int request_user_id, uint8_t user_buffer[1024]) {
-    CallType ct = SENT_USER_PROFILE;
-    if (send(client_fd, &ct, sizeof(ct), 0) <= 0) perror("send ct");
-    if (send(client_fd, &request_user_id, sizeof(int), 0) <= 0) perror("send id");
-    if (send(client_fd, user_buffer, sizeof(uint8_t) * 1024, 0) <= 0) perror("send user");
+void send_user_profile(int request_user_id, const User *user) {
+    Message message;
+    message.ints[0] = request_user_id;
+    message.user = *user;
+    send_message(SENT_USER_PROFILE, &message);
 }
 
 void send_play_made(int move) {
-    CallType ct = PLAY_MADE;
-    if (send(client_fd, &ct, sizeof(ct), 0) <= 0) perror("send ct");
-    if (send(client_fd, &move, sizeof(move), 0) <= 0) perror("send move");
+    send_int(PLAY_MADE, move);
 }
 
 void send_lobby_chat(const char* message) {
-    CallType ct = SEND_LOBBY_CHAT;
-    char msg_buffer[MAX_CHAT_MESSAGE_SIZE] = {0};
-    strncpy(msg_buffer, message, MAX_CHAT_MESSAGE_SIZE - 1);
-
-    if (send(client_fd, &ct, sizeof(ct), 0) <= 0) perror("send ct");
-    if (send(client_fd, msg_buffer, MAX_CHAT_MESSAGE_SIZE, 0) <= 0) perror("send message");
+    send_text(SEND_LOBBY_CHAT, message, MAX_CHAT_MESSAGE_SIZE);
 }
 
 void send_game_chat(const char* message) {
-    CallType ct = SEND_GAME_CHAT;
-    char msg_buffer[MAX_CHAT_MESSAGE_SIZE] = {0};
-    strncpy(msg_buffer, message, MAX_CHAT_MESSAGE_SIZE - 1);
-
-    if (send(client_fd, &ct, sizeof(ct), 0) <= 0) perror("send ct");
-    if (send(client_fd, msg_buffer, MAX_CHAT_MESSAGE_SIZE, 0) <= 0) perror("send message");
+    send_text(SEND_GAME_CHAT, message, MAX_CHAT_MESSAGE_SIZE);
 }
 
 void send_does_user_exist(int user_id) {
-    CallType ct = DOES_USER_EXIST;
-    if (send(client_fd, &ct, sizeof(ct), 0) <= 0) perror("send ct");
-    if (send(client_fd, &user_id, sizeof(int), 0) <= 0) perror("send response");
+    send_int(DOES_USER_EXIST, user_id);
 }
 
 void send_game_watch_request(int game_id) {
-    CallType ct = WATCH_GAME;
-    if (send(client_fd, &ct, sizeof(ct), 0) <= 0) perror("send ct");
-    if (send(client_fd, &game_id, sizeof(int), 0) <= 0) perror("send game_id");
+    send_int(WATCH_GAME, game_id);
     printf("Votre demande pour regarder la partie %d a été envoyée au serveur.\n", game_id);
 }
 
 void send_game_watch_answer(int watcher_user_id, int answer){
-    CallType ct = ALLOW_WATCHER;
-    if (send(client_fd, &ct, sizeof(ct), 0) <= 0) perror("send ct");
-    if (send(client_fd, &watcher_user_id, sizeof(int), 0) <= 0) perror("send watcher_user_id");
-    if (send(client_fd, &answer, sizeof(int), 0) <= 0) perror("send answer");
+    send_two_ints(ALLOW_WATCHER, watcher_user_id, answer);
 }
 
 void send_user_wants_to_exit_watch(int game_id) {
-    CallType ct = USER_WANTS_TO_EXIT_WATCH;
-    if (send(client_fd, &ct, sizeof(ct), 0) <= 0) perror("send ct");
-    if (send(client_fd, &game_id, sizeof(int), 0) <= 0) perror("send game_id");
+    send_int(USER_WANTS_TO_EXIT_WATCH, game_id);
 }
-
@@ -15,7 +15,7 @@ void send_challenge(int opponent_id);
 void send_consult_user_profile(int user_id);
 void send_list_ongoing_games(void);
 void send_challenge_answer(int challenger_id, int answer);
-void send_user_profile(int request_user_id, uint8_t user_buffer[1024]);
+void send_user_profile(int request_user_id, const User *user);
 void send_play_made(int move);
 void send_lobby_chat(const char* message);
 void send_game_chat(const char* message);
@@ -10,6 +10,7 @@
 #include "client.h"
 #include "../common/api.h"
 #include "../common/model.h"
+#include "../common/rules.h"
 
 
 static pthread_mutex_t user_lock = PTHREAD_MUTEX_INITIALIZER;
@@ -276,10 +277,9 @@ static void handle_game_turn(void) {
     if (move_played != -1) {
         printf("Le dernier coup joué par votre adversaire était la position %d.\n", move_played);
         int opponent_order = (ui_state.order == 1) ? 2 : 1;
-        int adjusted_position = (opponent_order == 2) ? move_played + 5 : move_played - 1;
-        int position_of_last_put_seed = moveSeeds(ui_state.game, adjusted_position);
-        int new_points = collectSeedsAndCountPoints(ui_state.game, position_of_last_put_seed, opponent_order);
-        ui_state.opponent.score += new_points;
+        // the server only relays legal moves
+        int new_points = playMove(ui_state.game, opponent_order, move_played);
+        if (new_points > 0) ui_state.opponent.score += new_points;
     } else {
         printf("Vous êtes le premier à jouer.\n");
     }
@@ -313,10 +313,9 @@ static void handle_game_turn(void) {
         }
     }
 
-    // Validate the choice has seeds
-    int adjusted_position = (ui_state.order == 1) ? local_choice - 1 : local_choice + 5;
-    while (ui_state.game->board[adjusted_position] == 0) {
-        const char* prompt = "Pas de graines dans cette case. Choisissez une autre case (ou un message pour chatter) : ";
+    // Validate the choice with the rules the server applies
+    while (!isLegalMove(ui_state.game, ui_state.order, local_choice)) {
+        const char* prompt = "Coup interdit (case vide, ou qui ne nourrit pas l'adversaire). Choisissez une autre case (ou un message pour chatter) : ";
         printf("%s", prompt);
         fflush(stdout);
 
@@ -325,7 +324,7 @@ static void handle_game_turn(void) {
 
         // Try to parse as number
         if (sscanf(input_buf, "%d", &local_choice) == 1) {
-            adjusted_position = (ui_state.order == 1) ? local_choice - 1 : local_choice + 5;
+            continue;
         } else {
             // Not a number - treat as chat message
             input_buf[strcspn(input_buf, "\n")] = 0;
@@ -337,8 +336,7 @@ static void handle_game_turn(void) {
     }
 
     // Make the move
-    int position_of_last_put_seed = moveSeeds(ui_state.game, adjusted_position);
-    int new_points = collectSeedsAndCountPoints(ui_state.game, position_of_last_put_seed, ui_state.order);
+    int new_points = playMove(ui_state.game, ui_state.order, local_choice);
     printf("Vous avez collecté %d points avec ce coup.\n", new_points);
     ui_state.me.score += new_points;
 
@@ -390,11 +388,9 @@ static void handle_pending_challenge(void) {
 // Handler functions called by client.c when messages arrive
 
 void interrupt_consult_user_profile(int request_user_id) {
-    uint8_t user_buffer[1024] = {0};
     pthread_mutex_lock(&user_lock);
-    serialize_User(&user, user_buffer);
+    send_user_profile(request_user_id, &user);
     pthread_mutex_unlock(&user_lock);
-    send_user_profile(request_user_id, user_buffer);
 
 }
 
@@ -496,9 +492,7 @@ void on_list_ongoing_games(char games_list_buffer[1024]) {
     ui_state.waiting_for_game_list = 0;
 }
 
-void on_receive_user_profile(uint8_t buffer[1024]) {
-    User user_received;
-    deserialize_User(buffer, &user_received);
+void on_receive_user_profile(User user_received) {
     printf("Profil de l'utilisateur demandé :\n");
     printUser(&user_received);
     ui_state.waiting_for_user_profile = 0;
@@ -534,18 +528,39 @@ void on_your_turn(int move_played) {
     ui_state.last_move = move_played;
 }
 
+/*
+ * Position of the game when we started watching it: the moves that follow are played on it.
+ * A watcher joining in the middle of a game used to start from an empty newGame() and showed a wrong board.
+ */
+void on_game_snapshot(const int board[12], int score1, int score2, int moves_played) {
+    if (!ui_state.game_watch) {
+        ui_state.player1 = newPlayer(-1, -1);
+        ui_state.player2 = newPlayer(-1, -1);
+        ui_state.game_watch = newGame(&ui_state.player1, &ui_state.player2);
+        if (!ui_state.game_watch) return;
+    }
+    memcpy(ui_state.game_watch->board, board, sizeof(ui_state.game_watch->board));
+    ui_state.player1.score = score1;
+    ui_state.player2.score = score2;
+    ui_state.moves_played = moves_played;
+    printf("\n>>> Suivi de la partie : démarrage du visionnage (%d coups joués, au joueur %d de jouer).\n",
+           moves_played, moves_played % 2 == 0 ? 1 : 2);
+    printGame(ui_state.game_watch, 1);
+    printf("    SCORE (viewer) : p1 : %d | p2 : %d\n", ui_state.player1.score, ui_state.player2.score);
+    fflush(stdout);
+}
+
 void on_move_received(int move_played) {
+    /* La position de départ vient du snapshot envoyé par le serveur quand on rejoint la partie */
+    if (!ui_state.game_watch) {
+        printf(">>> Coup reçu avant l'état de la partie (ignoré).\n");
+        fflush(stdout);
+        return;
+    }
+
     /* Si le serveur indique qu'aucun coup n'a encore été joué */
     if (move_played == -1) {
-        if (!ui_state.game_watch) {
-            ui_state.player1 = newPlayer(-1, -1);
-            ui_state.player2 = newPlayer(-1, -1);
-            ui_state.game_watch = newGame(&ui_state.player1, &ui_state.player2);
-            ui_state.moves_played = 0;
-            printf("\n>>> Suivi de la partie : démarrage du visionnage (en attente du premier coup).\n");
-        } else {
-            printf(">>> Aucun coup joué pour le moment.\n");
-        }
+        printf(">>> Aucun coup joué pour le moment.\n");
         printGame(ui_state.game_watch, 1);
         fflush(stdout);
         return;
@@ -558,15 +573,6 @@ void on_move_received(int move_played) {
         return;
     }
 
-    /* Initialiser l'état de visionnage si nécessaire */
-    if (!ui_state.game_watch) {
-        ui_state.player1 = newPlayer(-1, -1);
-        ui_state.player2 = newPlayer(-1, -1);
-        ui_state.game_watch = newGame(&ui_state.player1, &ui_state.player2);
-        ui_state.moves_played = 0;
-        printf("\n>>> Suivi de la partie : démarrage du visionnage.\n");
-    }
-
     /* Déterminer quel joueur joue pour ce message sans incrémenter encore */
     int tentative_moves = ui_state.moves_played + 1;
     int current_player = (tentative_moves % 2 == 1) ? 1 : 2;
@@ -581,9 +587,9 @@ void on_move_received(int move_played) {
         return;
     }
 
-    if (ui_state.game_watch->board[adjusted_position] == 0) {
-        /* Coup illégal (case vide) : on l'ignore sans incrémenter pour éviter boucles */
-        printf(">>> Coup illégal : case %d vide. Ignoré.\n", move_played);
+    if (!isLegalMove(ui_state.game_watch, current_player, move_played)) {
+        /* Coup illégal : on l'ignore sans incrémenter pour éviter boucles */
+        printf(">>> Coup illégal : case %d. Ignoré.\n", move_played);
         fflush(stdout);
         return;
     }
@@ -592,8 +598,7 @@ void on_move_received(int move_played) {
     ui_state.moves_played++;
     printf("\n>>> Coup reçu (viewer) : joueur %d a joué la position %d\n", current_player, move_played);
 
-    int position_of_last_put_seed = moveSeeds(ui_state.game_watch, adjusted_position);
-    int new_points = collectSeedsAndCountPoints(ui_state.game_watch, position_of_last_put_seed, current_player);
+    int new_points = playMove(ui_state.game_watch, current_player, move_played);
 
     if (current_player == 1) ui_state.player1.score += new_points;
     else ui_state.player2.score += new_points;
@@ -883,6 +888,8 @@ void run_client_ui(void) {
                 scanf("%[^\n]%*c", bio);
                 pthread_mutex_lock(&user_lock);
                 user.bio = bio;
+                // the server keeps the profile shown to the others (0: nobody is waiting for it)
+                send_user_profile(0, &user);
                 pthread_mutex_unlock(&user_lock);
                 break;
             case 8:
@@ -19,7 +19,7 @@ void on_error(int previous_call, char error_msg[256]);
 void on_success(void);
 void on_list_users(char user_list_buffer[1024]);
 void on_list_ongoing_games(char games_list_buffer[1024]);
-void on_receive_user_profile(uint8_t buffer[1024]);
+void on_receive_user_profile(User user);
 void on_challenge_start(char opponent_username[USERNAME_SIZE + 1]);
 void on_your_turn(int move_played);
 void on_game_over(GAME_OVER_REASON reason);
@@ -28,4 +28,5 @@ void on_receive_game_chat(int sender_id, char sender_username[USERNAME_SIZE + 1]
 void on_does_user_exist(int does_exist);
 void on_watch_game_answer(int answer);
 void on_move_received(int move_played);
+void on_game_snapshot(const int board[12], int score1, int score2, int moves_played);
 void on_game_over_watcher(GAME_OVER_REASON reason);
@@ -0,0 +1,302 @@
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <time.h>
+#include "ai.h"
+#include "rules.h"
+
+#define MAX_PIT_KEY 48 // seeds in a game
+#define MAX_PLIES_KEY 64
+#define FORCED_WIN (AI_WIN_VALUE - AI_MAX_DEPTH)
+
+typedef struct TtEntry {
+    uint64_t key;
+    int16_t value;
+    int8_t depth;
+    uint8_t bound;
+    int8_t move; // 1-6, 0 if none
+} TtEntry;
+
+struct AiSearch {
+    TtEntry *table;
+    size_t mask;
+    AiContext context;
+    long max_nodes;
+    struct timespec deadline;
+    int has_deadline;
+    int can_stop; // the limits apply once the first iteration completed
+};
+
+// ---------------------- ZOBRIST KEYS ---------------------- //
+static uint64_t zobrist_pits[12][MAX_PIT_KEY + 1];
+static uint64_t zobrist_scores[2][MAX_PIT_KEY + 1];
+static uint64_t zobrist_plies[MAX_PLIES_KEY];
+static uint64_t zobrist_player2;
+static pthread_once_t zobrist_once = PTHREAD_ONCE_INIT;
+
+static uint64_t splitmix64(uint64_t *state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// fixed seed: the keys, and so the hashes, are the same in every process
+static void initZobrist(void) {
+    uint64_t state = 0x41574C4E4554ULL;
+    for (int i = 0; i < 12; i++) {
+        for (int s = 0; s <= MAX_PIT_KEY; s++) zobrist_pits[i][s] = splitmix64(&state);
+    }
+    for (int p = 0; p < 2; p++) {
+        for (int s = 0; s <= MAX_PIT_KEY; s++) zobrist_scores[p][s] = splitmix64(&state);
+    }
+    for (int i = 0; i < MAX_PLIES_KEY; i++) zobrist_plies[i] = splitmix64(&state);
+    zobrist_player2 = splitmix64(&state);
+}
+
+static int clampKey(int value, int max) {
+    return value < 0 ? 0 : value > max ? max : value;
+}
+
+uint64_t aiHash(const AiPosition *position) {
+    pthread_once(&zobrist_once, initZobrist);
+    uint64_t hash = 0;
+    for (int i = 0; i < 12; i++) {
+        hash ^= zobrist_pits[i][clampKey(packedPit(&position->board, i), MAX_PIT_KEY)];
+    }
+    hash ^= zobrist_scores[0][clampKey(position->scores[0], MAX_PIT_KEY)];
+    hash ^= zobrist_scores[1][clampKey(position->scores[1], MAX_PIT_KEY)];
+    // no limit hashes as 0
+    hash ^= zobrist_plies[position->plies_left < 0 ? 0 : clampKey(position->plies_left + 1, MAX_PLIES_KEY - 1)];
+    if (position->to_move == 2) hash ^= zobrist_player2;
+    return hash;
+}
+
+// ---------------------- POSITIONS ---------------------- //
+AiPosition aiPositionOfGame(const Game *game, int tours) {
+    AiPosition position;
+    position.board = packBoard(game->board);
+    position.scores[0] = game->player1.score;
+    position.scores[1] = game->player2.score;
+    position.to_move = tours % 2 == 0 ? 1 : 2;
+    // the server declares a draw once more than MAX_ROUNDS moves were played
+    position.plies_left = MAX_ROUNDS + 1 - tours;
+    if (position.plies_left < 1) position.plies_left = 1;
+    return position;
+}
+
+int aiPlay(AiPosition *position, int move) {
+    int player = position->to_move;
+    int points = packedPlayMove(&position->board, player, move);
+    if (points < 0) return -1;
+    position->scores[player - 1] += points;
+    position->to_move = 3 - player;
+    int winner = gameWinner(&position->board, position->scores[0], position->scores[1]);
+    if (winner) return winner;
+    if (position->plies_left > 0 && --position->plies_left == 0) return 3;
+    return 0;
+}
+
+int aiEvaluate(const AiPosition *position) {
+    int me = position->to_move;
+    int score_diff = position->scores[me - 1] - position->scores[2 - me];
+    // seeds kept on our side are future moves, and the opponent starves below MIN_SEEDS
+    int seeds_diff = packedPlayerSeedsLeft(&position->board, me) - packedPlayerSeedsLeft(&position->board, 3 - me);
+    return 16 * score_diff + seeds_diff;
+}
+
+// Value for the side to move once the game ended with @outcome (aiPlay result) @ply moves from the root
+static int outcomeValue(int outcome, int me, int ply) {
+    if (outcome == me) return AI_WIN_VALUE - ply;
+    if (outcome == 3 - me) return -(AI_WIN_VALUE - ply);
+    return 0;
+}
+
+// ---------------------- SEARCH ---------------------- //
+AiSearch *aiCreate(size_t tt_entries) {
+    AiSearch *search = calloc(1, sizeof(AiSearch));
+    if (!search) return NULL;
+    size_t size = 1;
+    while (size * 2 <= tt_entries) size *= 2;
+    search->table = calloc(size, sizeof(TtEntry));
+    if (!search->table) {
+        free(search);
+        return NULL;
+    }
+    search->mask = size - 1;
+    return search;
+}
+
+void aiDestroy(AiSearch *search) {
+    if (!search) return;
+    free(search->table);
+    free(search);
+}
+
+// 1 once the search went over its budget, which only applies after the first iteration
+static int overLimits(void *arg) {
+    AiSearch *search = arg;
+    if (!search->can_stop) return 0;
+    if (search->max_nodes > 0 && search->context.nodes >= search->max_nodes) return 1;
+    if (search->has_deadline) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (now.tv_sec > search->deadline.tv_sec
+            || (now.tv_sec == search->deadline.tv_sec && now.tv_nsec >= search->deadline.tv_nsec)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int probeTable(void *data, uint64_t key, AiTtEntry *found) {
+    AiSearch *search = data;
+    const TtEntry *entry = &search->table[key & search->mask];
+    if (entry->key != key) return 0;
+    found->value = entry->value;
+    found->depth = entry->depth;
+    found->bound = (AiBound) entry->bound;
+    found->move = entry->move;
+    return 1;
+}
+
+// depth-preferred, except for entries of other positions which are always replaced
+static void storeTable(void *data, uint64_t key, const AiTtEntry *stored) {
+    AiSearch *search = data;
+    TtEntry *entry = &search->table[key & search->mask];
+    if (entry->key == key && stored->depth < entry->depth) return;
+    entry->key = key;
+    entry->value = (int16_t) stored->value;
+    entry->depth = (int8_t) stored->depth;
+    entry->bound = (uint8_t) stored->bound;
+    entry->move = (int8_t) stored->move;
+}
+
+// forced wins are stored relative to the node, so they stay valid at another distance from the root
+static int toTt(int value, int ply) {
+    if (value > FORCED_WIN) return value + ply;
+    if (value < -FORCED_WIN) return value - ply;
+    return value;
+}
+
+static int fromTt(int value, int ply) {
+    if (value > FORCED_WIN) return value - ply;
+    if (value < -FORCED_WIN) return value + ply;
+    return value;
+}
+
+typedef struct Child {
+    AiPosition position;
+    int move;
+    int outcome;
+    int order;
+} Child;
+
+int aiNegamax(AiContext *context, const AiPosition *position, int depth, int alpha, int beta, int ply, int *best_move) {
+    context->nodes++;
+    if ((context->nodes & 1023) == 0 && context->poll && context->poll(context->poll_arg)) context->stopped = 1;
+    if (context->stopped) return 0;
+
+    uint64_t key = aiHash(position);
+    AiTtEntry entry;
+    int tt_move = 0;
+    if (context->table.probe(context->table.data, key, &entry)) {
+        tt_move = entry.move;
+        if (entry.depth >= depth && !best_move) {
+            int value = fromTt(entry.value, ply);
+            if (entry.bound == AI_BOUND_EXACT) return value;
+            if (entry.bound == AI_BOUND_LOWER && value > alpha) alpha = value;
+            if (entry.bound == AI_BOUND_UPPER && value < beta) beta = value;
+            if (alpha >= beta) return value;
+        }
+    }
+    if (depth == 0) return aiEvaluate(position);
+
+    int me = position->to_move;
+    unsigned int legal = packedLegalMoves(&position->board, me);
+    if (!legal) {
+        // no move left: the game stops on the scores
+        int diff = position->scores[me - 1] - position->scores[2 - me];
+        return diff > 0 ? AI_WIN_VALUE - ply : diff < 0 ? -(AI_WIN_VALUE - ply) : 0;
+    }
+
+    // move ordering: the best move of a previous search, then the biggest captures
+    Child children[6];
+    int count = 0;
+    for (int m = 0; m < 6; m++) {
+        int move = context->reverse_ties ? 6 - m : m + 1;
+        if (!((legal >> (move - 1)) & 1)) continue;
+        Child child;
+        child.position = *position;
+        child.move = move;
+        child.outcome = aiPlay(&child.position, move);
+        child.order = move == tt_move ? 1000 : child.position.scores[me - 1] - position->scores[me - 1];
+        int k = count++;
+        while (k > 0 && children[k - 1].order < child.order) {
+            children[k] = children[k - 1];
+            k--;
+        }
+        children[k] = child;
+    }
+
+    int alpha_start = alpha;
+    int best = -AI_WIN_VALUE - 1;
+    int best_child_move = children[0].move;
+    for (int c = 0; c < count; c++) {
+        int value = children[c].outcome
+                    ? outcomeValue(children[c].outcome, me, ply + 1)
+                    : -aiNegamax(context, &children[c].position, depth - 1, -beta, -alpha, ply + 1, NULL);
+        if (context->stopped) return 0;
+        if (value > best) {
+            best = value;
+            best_child_move = children[c].move;
+        }
+        if (value > alpha) alpha = value;
+        if (alpha >= beta) break;
+    }
+
+    AiTtEntry stored = {
+        .value = toTt(best, ply),
+        .depth = depth,
+        .bound = best <= alpha_start ? AI_BOUND_UPPER : best >= beta ? AI_BOUND_LOWER : AI_BOUND_EXACT,
+        .move = best_child_move
+    };
+    context->table.store(context->table.data, key, &stored);
+    if (best_move) *best_move = best_child_move;
+    return best;
+}
+
+AiResult aiBestMove(AiSearch *search, const AiPosition *position, const AiLimits *limits) {
+    AiResult result = {-1, 0, 0, 0};
+    search->context = (AiContext) {
+        .table = {probeTable, storeTable, search},
+        .poll = overLimits,
+        .poll_arg = search
+    };
+    search->can_stop = 0;
+    search->max_nodes = limits ? limits->max_nodes : 0;
+    search->has_deadline = limits && limits->max_time_ms > 0;
+    if (search->has_deadline) {
+        clock_gettime(CLOCK_MONOTONIC, &search->deadline);
+        long nsec = search->deadline.tv_nsec + (long) (limits->max_time_ms % 1000) * 1000000L;
+        search->deadline.tv_sec += limits->max_time_ms / 1000 + nsec / 1000000000L;
+        search->deadline.tv_nsec = nsec % 1000000000L;
+    }
+    int max_depth = limits && limits->max_depth > 0 && limits->max_depth < AI_MAX_DEPTH ? limits->max_depth : AI_MAX_DEPTH;
+    if (!packedLegalMoves(&position->board, position->to_move)) return result;
+
+    for (int depth = 1; depth <= max_depth; depth++) {
+        int move = -1;
+        int value = aiNegamax(&search->context, position, depth, -AI_WIN_VALUE - 1, AI_WIN_VALUE + 1, 0, &move);
+        if (search->context.stopped) break;
+        result.move = move;
+        result.value = value;
+        result.depth = depth;
+        // a forced result, or the whole game tree until the draw, cannot change with more depth
+        if (value > FORCED_WIN || value < -FORCED_WIN) break;
+        if (position->plies_left > 0 && depth >= position->plies_left) break;
+        search->can_stop = 1;
+        if (overLimits(search)) break;
+    }
+    result.nodes = search->context.nodes;
+    return result;
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <stdint.h>
+#include "model.h"
+
+/*
+ * Computer player: iterative-deepening alpha-beta (negamax) over the packed rules of rules.c,
+ * with a Zobrist-hashed transposition table and move ordering (transposition table move, then captures).
+ * An AiSearch owns its table and is used by one thread at a time.
+ */
+
+#define AI_WIN_VALUE 30000
+#define AI_MAX_DEPTH 64
+
+typedef struct AiPosition {
+    PackedBoard board;
+    int scores[2]; // player 1, player 2
+    int to_move; // 1 or 2
+    int plies_left; // moves before the game is a draw, -1 when there is no limit
+} AiPosition;
+
+// Budget of a search, 0 meaning unlimited. The first iteration always completes.
+typedef struct AiLimits {
+    long max_nodes;
+    int max_time_ms;
+    int max_depth; // AI_MAX_DEPTH when 0
+} AiLimits;
+
+typedef struct AiResult {
+    int move; // 1-6, -1 when the side to move has no legal move
+    int value; // for the side to move, > AI_WIN_VALUE - AI_MAX_DEPTH for a forced win
+    int depth; // of the last completed iteration
+    long nodes;
+} AiResult;
+
+typedef struct AiSearch AiSearch;
+
+// @tt_entries is rounded down to a power of two
+AiSearch *aiCreate(size_t tt_entries);
+void aiDestroy(AiSearch *search);
+
+AiResult aiBestMove(AiSearch *search, const AiPosition *position, const AiLimits *limits);
+
+// Position of a Game where @tours moves have been played, as the server counts them
+AiPosition aiPositionOfGame(const Game *game, int tours);
+
+// Plays @move (1-6) on @position. Returns the winner (1 or 2), 3 for a draw, 0 if the game goes on, -1 if illegal.
+int aiPlay(AiPosition *position, int move);
+
+uint64_t aiHash(const AiPosition *position);
+
+// Static value of a position for the side to move
+int aiEvaluate(const AiPosition *position);
+
+// ---------------------- SEARCH CORE ---------------------- //
+/*
+ * The negamax of aiBestMove, also run by the threads of the parallel solver (solver.c) on their shared table.
+ * A search reaches its transposition table through probe/store only, so every table keeps its own layout and
+ * replacement policy.
+ */
+
+typedef enum AiBound {
+    AI_BOUND_EXACT,
+    AI_BOUND_LOWER, // the value is at least the stored one (beta cutoff)
+    AI_BOUND_UPPER // the value is at most the stored one (no move raised alpha)
+} AiBound;
+
+typedef struct AiTtEntry {
+    int value; // forced wins relative to the node, so they stay valid at another distance from the root
+    int depth;
+    AiBound bound;
+    int move; // 1-6, 0 if none
+} AiTtEntry;
+
+typedef struct AiTable {
+    int (*probe)(void *data, uint64_t key, AiTtEntry *entry); // 1 and the entry of @key, 0 if it has none
+    void (*store)(void *data, uint64_t key, const AiTtEntry *entry);
+    void *data;
+} AiTable;
+
+typedef struct AiContext {
+    AiTable table;
+    int (*poll)(void *arg); // called every 1024 nodes, 1 to stop the search. NULL to never stop.
+    void *poll_arg;
+    int reverse_ties; // captures of the same size are tried from pit 6 down, to search another tree than the others
+    long nodes;
+    int stopped; // set once poll asked to stop: the values returned since are meaningless
+} AiContext;
+
+// Value of @position for the side to move, searched @depth moves deep. @best_move is set at the root (ply 0).
+int aiNegamax(AiContext *context, const AiPosition *position, int depth, int alpha, int beta, int ply, int *best_move);
@@ -1,138 +1,392 @@
+#define _GNU_SOURCE
 #include "api.h"
+#include "utils.h"
+
+// ---------------------- WIRE FORMAT ---------------------- //
+
+#define MAX_SCHEMA_FIELDS 4
+
+typedef enum FieldType {
+    FIELD_END = 0,
+    FIELD_INT, // V1: int32 LE, V2: zigzag varint
+    FIELD_USERNAME, // V1: USERNAME_SIZE + 1 bytes, V2: length-prefixed string
+    FIELD_TEXT, // V1: see legacy_text_size, V2: length-prefixed string
+    FIELD_USER, // V1: LEGACY_USER_SIZE bytes, V2: username, id, bio, total_score, total_games, total_wins
+    FIELD_VERSION, // one byte, omitted in V1 when the version is PROTOCOL_V1
+    FIELD_BOARD // 12 bytes, one per pit (a pit holds at most 48 seeds)
+} FieldType;
+
+typedef struct Schema {
+    uint8_t used; // the CallType is sent in this direction
+    uint8_t fields[MAX_SCHEMA_FIELDS];
+    uint16_t legacy_text_size; // V1 size of the zero-padded text, 0 when the text is '\0'-terminated and ends the payload
+} Schema;
+
+/*
+ * One entry per CallType: the public descriptor (name, direction, how the client processes it) and the payload schema
+ * of each direction. Everything the server and the client need to know about a CallType comes from this table.
+ */
+typedef struct CallEntry {
+    CallDescriptor descriptor;
+    Schema to_server;
+    Schema to_client;
+} CallEntry;
+
+#define TO_SERVER CALL_TO_SERVER
+#define ASYNC CALL_TO_CLIENT_ASYNC
+#define SYNC CALL_TO_CLIENT_SYNC
+
+static const CallEntry calls[NB_CALL_TYPES] = {
+    [CONNECT] = {{"CONNECT", TO_SERVER}, .to_server = {1, {FIELD_USERNAME, FIELD_VERSION}}},
+    [LIST_USERS] = {{"LIST_USERS", TO_SERVER | ASYNC}, .to_server = {1, {FIELD_END}}, .to_client = {1, {FIELD_TEXT}}},
+    [LIST_GAMES] = {{"LIST_GAMES", TO_SERVER}, .to_server = {1, {FIELD_END}}},
+    [CONNECT_CONFIRM] = {{"CONNECT_CONFIRM", ASYNC}, .to_client = {1, {FIELD_VERSION, FIELD_USER}}},
+    [CHALLENGE] = {{"CHALLENGE", TO_SERVER | ASYNC}, .to_server = {1, {FIELD_INT}}, .to_client = {1, {FIELD_INT, FIELD_USERNAME}}},
+    [CONSULT_USER_PROFILE] = {{"CONSULT_USER_PROFILE", TO_SERVER | SYNC}, .to_server = {1, {FIELD_INT}}, .to_client = {1, {FIELD_INT}}},
+    [ERROR] = {{"ERROR", ASYNC}, .to_client = {1, {FIELD_INT, FIELD_TEXT}}},
+    [SUCCESS] = {{"SUCCESS", ASYNC}, .to_client = {1, {FIELD_END}}},
+    [SENT_USER_PROFILE] = {{"SENT_USER_PROFILE", TO_SERVER}, .to_server = {1, {FIELD_INT, FIELD_USER}}},
+    [RECEIVE_USER_PROFILE] = {{"RECEIVE_USER_PROFILE", ASYNC}, .to_client = {1, {FIELD_USER}}},
+    [CHALLENGE_REQUEST_ANSWER] = {{"CHALLENGE_REQUEST_ANSWER", TO_SERVER | ASYNC}, .to_server = {1, {FIELD_INT, FIELD_INT}},
+                                  .to_client = {1, {FIELD_INT, FIELD_INT}}},
+    [CHALLENGE_START] = {{"CHALLENGE_START", ASYNC}, .to_client = {1, {FIELD_USERNAME}}},
+    [PLAY_MADE] = {{"PLAY_MADE", TO_SERVER}, .to_server = {1, {FIELD_INT}}},
+    [YOUR_TURN] = {{"YOUR_TURN", ASYNC}, .to_client = {1, {FIELD_INT}}},
+    [GAME_OVER] = {{"GAME_OVER", ASYNC}, .to_client = {1, {FIELD_INT}}},
+    [LIST_ONGOING_GAMES] = {{"LIST_ONGOING_GAMES", TO_SERVER | ASYNC}, .to_server = {1, {FIELD_END}}, .to_client = {1, {FIELD_TEXT}}},
+    [WATCH_GAME] = {{"WATCH_GAME", TO_SERVER}, .to_server = {1, {FIELD_INT}}},
+    [ALLOW_CLIENT_TO_WATCH] = {{"ALLOW_CLIENT_TO_WATCH", 0}},
+    [SEND_LOBBY_CHAT] = {{"SEND_LOBBY_CHAT", TO_SERVER}, .to_server = {1, {FIELD_TEXT}, MAX_CHAT_MESSAGE_SIZE}},
+    [SEND_GAME_CHAT] = {{"SEND_GAME_CHAT", TO_SERVER}, .to_server = {1, {FIELD_TEXT}, MAX_CHAT_MESSAGE_SIZE}},
+    [RECEIVE_LOBBY_CHAT] = {{"RECEIVE_LOBBY_CHAT", ASYNC}, .to_client = {1, {FIELD_INT, FIELD_USERNAME, FIELD_TEXT}, MAX_CHAT_MESSAGE_SIZE}},
+    [RECEIVE_GAME_CHAT] = {{"RECEIVE_GAME_CHAT", ASYNC}, .to_client = {1, {FIELD_INT, FIELD_USERNAME, FIELD_TEXT}, MAX_CHAT_MESSAGE_SIZE}},
+    [DOES_USER_EXIST] = {{"DOES_USER_EXIST", TO_SERVER | ASYNC}, .to_server = {1, {FIELD_INT}}, .to_client = {1, {FIELD_INT}}},
+    [USER_WANTS_TO_WATCH] = {{"USER_WANTS_TO_WATCH", SYNC}, .to_client = {1, {FIELD_INT}}},
+    [ALLOW_WATCHER] = {{"ALLOW_WATCHER", TO_SERVER}, .to_server = {1, {FIELD_INT, FIELD_INT}}},
+    [WATCH_GAME_ANSWER] = {{"WATCH_GAME_ANSWER", ASYNC}, .to_client = {1, {FIELD_INT}}},
+    [PLAY_MADE_WATCHER] = {{"PLAY_MADE_WATCHER", ASYNC}, .to_client = {1, {FIELD_INT}}},
+    [USER_WANTS_TO_EXIT_WATCH] = {{"USER_WANTS_TO_EXIT_WATCH", TO_SERVER}, .to_server = {1, {FIELD_INT}}},
+    [GAME_OVER_WATCHER] = {{"GAME_OVER_WATCHER", ASYNC}, .to_client = {1, {FIELD_INT}}},
+    [CONSULT_RANKING] = {{"CONSULT_RANKING", TO_SERVER | ASYNC}, .to_server = {1, {FIELD_INT, FIELD_INT}},
+                         .to_client = {1, {FIELD_INT, FIELD_INT, FIELD_TEXT}}},
+    [EVALUATE_POSITION] = {{"EVALUATE_POSITION", TO_SERVER | ASYNC}, .to_server = {1, {FIELD_BOARD, FIELD_INT}},
+                           .to_client = {1, {FIELD_INT, FIELD_INT}}},
+    [SUGGEST_MOVE] = {{"SUGGEST_MOVE", TO_SERVER | ASYNC}, .to_server = {1, {FIELD_END}}, .to_client = {1, {FIELD_INT, FIELD_INT}}},
+    [GAME_SNAPSHOT] = {{"GAME_SNAPSHOT", ASYNC}, .to_client = {1, {FIELD_BOARD, FIELD_INT, FIELD_INT, FIELD_INT}}},
+};
+
+#undef TO_SERVER
+#undef ASYNC
+#undef SYNC
+
+const CallDescriptor *describe_CallType(CallType type) {
+    if ((unsigned) type >= NB_CALL_TYPES) return NULL;
+    return &calls[type].descriptor;
+}
 
-// Returns true if the CallType is made to be sent from the client to the server
 uint8_t is_server_CallType(CallType type) {
-    switch (type) {
-        case CONNECT: return 1;
-        case CONNECT_CONFIRM: return 0;
-        case CHALLENGE: return 1;
-        case LIST_USERS: return 1;
-        case LIST_GAMES: return 1;
-        case CONSULT_USER_PROFILE: return 1;
-        case ERROR: return 0;
-        case SUCCESS: return 0;
-        case SENT_USER_PROFILE: return 1;
-        case RECEIVE_USER_PROFILE: return 0;
-        case CHALLENGE_REQUEST_ANSWER : return 1;
-        case CHALLENGE_START: return 0;
-        case PLAY_MADE: return 1;
-        case YOUR_TURN: return 0;
-        case GAME_OVER: return 0;
-        case LIST_ONGOING_GAMES: return 1;
-        case WATCH_GAME: return 1;
-        case SEND_LOBBY_CHAT: return 1;
-        case SEND_GAME_CHAT: return 1;
-        case RECEIVE_LOBBY_CHAT: return 0;
-        case RECEIVE_GAME_CHAT: return 0;
-        case DOES_USER_EXIST : return 1;
-        case USER_WANTS_TO_WATCH : return 0;
-        case ALLOW_WATCHER : return 1;
-        case WATCH_GAME_ANSWER : return 0;
-        case PLAY_MADE_WATCHER : return 0;
-        case USER_WANTS_TO_EXIT_WATCH : return 1;
-        case GAME_OVER_WATCHER : return 0;
-        case CONSULT_RANKING : return 1;
+    const CallDescriptor *descriptor = describe_CallType(type);
+    return descriptor && (descriptor->flags & CALL_TO_SERVER);
+}
+
+uint8_t is_client_async_CallType(CallType type) {
+    const CallDescriptor *descriptor = describe_CallType(type);
+    return descriptor && (descriptor->flags & CALL_TO_CLIENT_ASYNC);
+}
+
+uint8_t is_client_sync_CallType(CallType type) {
+    const CallDescriptor *descriptor = describe_CallType(type);
+    return descriptor && (descriptor->flags & CALL_TO_CLIENT_SYNC);
+}
+
+static const Schema *find_schema(CallType type, uint8_t to_server) {
+    if ((unsigned) type >= NB_CALL_TYPES) return NULL;
+    const Schema *schema = to_server ? &calls[type].to_server : &calls[type].to_client;
+    return schema->used ? schema : NULL;
+}
+
+// Smallest and largest encoding of each field type, in V1 then in V2
+static const uint16_t field_min_size[2][FIELD_BOARD + 1] = {
+    {0, 4, USERNAME_SIZE + 1, 0, LEGACY_USER_SIZE, 0, 12},
+    {0, 1, 1, 1, 6, 1, 12}
+};
+static const uint16_t field_max_size[2][FIELD_BOARD + 1] = {
+    {0, 4, USERNAME_SIZE + 1, MESSAGE_TEXT_SIZE, LEGACY_USER_SIZE, 1, 12},
+    {0, MAX_VARINT_SIZE, 1 + USERNAME_SIZE, 2 + MESSAGE_TEXT_SIZE - 1,
+     1 + USERNAME_SIZE + 2 + BIO_SIZE + 4 * MAX_VARINT_SIZE + 1, 1, 12} // +1: padding of a 1024 bytes CONNECT_CONFIRM
+};
+
+// V1 size of the fields of a schema from @first on (the fields after a version all have a fixed V1 size)
+static size_t v1_fields_size(const Schema *schema, int first) {
+    size_t size = 0;
+    for (int f = first; f < MAX_SCHEMA_FIELDS && schema->fields[f] != FIELD_END; f++) {
+        size += field_min_size[0][schema->fields[f]];
     }
-    return 0;
+    return size;
 }
 
+// Payload size bounds of a schema: at most MAX_SCHEMA_FIELDS additions, no need to cache them
+static void schema_size_bounds(const Schema *schema, uint8_t version, size_t *min, size_t *max) {
+    int v = version == PROTOCOL_V1 ? 0 : 1;
+    *min = *max = 0;
+    for (int f = 0; f < MAX_SCHEMA_FIELDS && schema->fields[f] != FIELD_END; f++) {
+        uint8_t field = schema->fields[f];
+        if (field == FIELD_TEXT && v == 0 && schema->legacy_text_size) {
+            *min += schema->legacy_text_size;
+            *max += schema->legacy_text_size;
+        } else {
+            *min += field_min_size[v][field];
+            *max += field_max_size[v][field];
+        }
+    }
+}
 
-// Returns true if the CallType is made to be sent from the server to the client, and processed in an async way
-uint8_t is_client_async_CallType(CallType type) {
-    switch (type) {
-        case CONNECT: return 1;
-        case CONNECT_CONFIRM: return 1;
-        case CHALLENGE: return 1;
-        case LIST_USERS: return 1;
-        case LIST_GAMES: return 0;
-        case CONSULT_USER_PROFILE: return 0;
-        case ERROR: return 1;
-        case SUCCESS: return 1;
-        case SENT_USER_PROFILE: return 1;
-        case RECEIVE_USER_PROFILE: return 1;
-        case CHALLENGE_REQUEST_ANSWER : return 1;
-        case CHALLENGE_START: return 1;
-        case PLAY_MADE: return 0;
-        case YOUR_TURN: return 1;
-        case GAME_OVER: return 1;
-        case LIST_ONGOING_GAMES: return 1;
-        case WATCH_GAME: return 1;
-        case SEND_LOBBY_CHAT: return 0;
-        case SEND_GAME_CHAT: return 0;
-        case RECEIVE_LOBBY_CHAT: return 1;
-        case RECEIVE_GAME_CHAT: return 1;
-        case DOES_USER_EXIST : return 1;
-        case USER_WANTS_TO_WATCH : return 1; // <-- changed to async
-        case ALLOW_WATCHER : return 0;
-        case WATCH_GAME_ANSWER : return 1;
-        case PLAY_MADE_WATCHER : return 1;
-        case USER_WANTS_TO_EXIT_WATCH : return 0;
-        case GAME_OVER_WATCHER : return 1;
-        case CONSULT_RANKING : return 1;
+size_t sizeof_CallType(CallType type, uint8_t to_server) {
+    const Schema *schema = find_schema(type, to_server);
+    if (!schema) return 0;
+    size_t min, max;
+    schema_size_bounds(schema, PROTOCOL_V1, &min, &max);
+    return min == max ? min : CALL_VARIABLE_SIZE;
+}
+
+// Bounded writer: once the buffer is full, everything else is ignored and the overflow is reported at the end
+typedef struct Writer {
+    uint8_t *buf;
+    size_t size;
+    size_t pos;
+    int overflow;
+} Writer;
+
+static void put_bytes(Writer *w, const void *data, size_t n) {
+    if (w->overflow || w->size - w->pos < n) {
+        w->overflow = 1;
+        return;
     }
+    if (data) memcpy(w->buf + w->pos, data, n);
+    else memset(w->buf + w->pos, 0, n);
+    w->pos += n;
+}
+
+static void put_int32(Writer *w, int32_t value) {
+    uint8_t bytes[4];
+    write_int32_le(bytes, 0, value);
+    put_bytes(w, bytes, sizeof(bytes));
+}
+
+static void put_varint(Writer *w, uint32_t value) {
+    uint8_t bytes[MAX_VARINT_SIZE];
+    put_bytes(w, bytes, write_varint(bytes, 0, value));
+}
+
+static void put_string(Writer *w, const char *str, size_t max_len) {
+    size_t len = str ? strnlen(str, max_len) : 0;
+    put_varint(w, (uint32_t) len);
+    put_bytes(w, str, len);
+}
+
+// Writes @str in exactly @size bytes, zero-padded and always '\0'-terminated
+static void put_fixed_string(Writer *w, const char *str, size_t size) {
+    size_t len = str ? strnlen(str, size - 1) : 0;
+    put_bytes(w, str, len);
+    put_bytes(w, NULL, size - len);
+}
+
+typedef struct Reader {
+    const uint8_t *buf;
+    size_t size;
+    size_t pos;
+} Reader;
+
+static int get_bytes(Reader *r, void *dest, size_t n) {
+    if (r->size - r->pos < n) return -1;
+    if (dest) memcpy(dest, r->buf + r->pos, n);
+    r->pos += n;
     return 0;
 }
 
-// Returns true if the CallType is made to be sent from the server to the client, and processed as an interruption
-uint8_t is_client_sync_CallType(CallType type) {
-    switch (type) {
-        case CONNECT: return 0;
-        case CONNECT_CONFIRM: return 0;
-        case CHALLENGE: return 0;
-        case LIST_USERS: return 0;
-        case LIST_GAMES: return 0;
-        case CONSULT_USER_PROFILE: return 1;
-        case ERROR: return 0;
-        case SUCCESS: return 0;
-        case SENT_USER_PROFILE: return 0;
-        case RECEIVE_USER_PROFILE: return 0;
-        case CHALLENGE_REQUEST_ANSWER : return 0;
-        case CHALLENGE_START: return 0;
-        case PLAY_MADE: return 0;
-        case YOUR_TURN: return 0;
-        case GAME_OVER: return 0;
-        case LIST_ONGOING_GAMES: return 0;
-        case WATCH_GAME: return 0;
-        case SEND_LOBBY_CHAT: return 0;
-        case SEND_GAME_CHAT: return 0;
-        case RECEIVE_LOBBY_CHAT: return 0;
-        case RECEIVE_GAME_CHAT: return 0;
-        case DOES_USER_EXIST : return 0;
-        case USER_WANTS_TO_WATCH : return 0; // <-- keep sync = 0
-        case ALLOW_WATCHER : return 0;
-        case WATCH_GAME_ANSWER : return 0;
-        case PLAY_MADE_WATCHER : return 0;
-        case USER_WANTS_TO_EXIT_WATCH : return 0;
-        case GAME_OVER_WATCHER : return 0;
-        case CONSULT_RANKING : return 0;
+static int get_int32(Reader *r, int32_t *value) {
+    if (r->size - r->pos < 4) return -1;
+    *value = read_int32_le(r->buf, r->pos);
+    r->pos += 4;
+    return 0;
+}
+
+static int get_varint_int(Reader *r, int32_t *value) {
+    uint32_t raw;
+    if (read_varint(r->buf, r->size, &r->pos, &raw) < 0) return -1;
+    *value = zigzag_decode(raw);
+    return 0;
+}
+
+// Copies @len bytes of the payload into @dest (truncated to @dest_size - 1) and terminates it
+static int get_chars(Reader *r, char *dest, size_t dest_size, size_t len) {
+    if (r->size - r->pos < len) return -1;
+    size_t kept = len < dest_size - 1 ? len : dest_size - 1;
+    memcpy(dest, r->buf + r->pos, kept);
+    dest[kept] = '\0';
+    r->pos += len;
+    return 0;
+}
+
+static int get_string(Reader *r, char *dest, size_t dest_size, size_t max_len) {
+    uint32_t len;
+    if (read_varint(r->buf, r->size, &r->pos, &len) < 0 || len > max_len) return -1;
+    return get_chars(r, dest, dest_size, len);
+}
+
+// Bytes left for the bio in a V1 user: username, id, bio length and the three totals take the rest
+#define LEGACY_BIO_SIZE (LEGACY_USER_SIZE - (USERNAME_SIZE + 1) - 5 * 4)
 
+static void put_user_v1(Writer *w, const User *user) {
+    size_t bio_len = user->bio ? strnlen(user->bio, LEGACY_BIO_SIZE) : 0;
+    size_t start = w->pos;
+    put_fixed_string(w, user->username, USERNAME_SIZE + 1);
+    put_int32(w, user->id);
+    put_int32(w, (int32_t) bio_len);
+    put_bytes(w, user->bio, bio_len);
+    put_int32(w, user->total_score);
+    put_int32(w, user->total_games);
+    put_int32(w, user->total_wins);
+    if (!w->overflow) put_bytes(w, NULL, LEGACY_USER_SIZE - (w->pos - start));
+}
+
+static int get_user_v1(Reader *r, Message *m) {
+    size_t start = r->pos;
+    int32_t bio_len;
+    if (get_chars(r, m->user.username, sizeof(m->user.username), USERNAME_SIZE + 1) < 0) return -1;
+    if (get_int32(r, &m->user.id) < 0 || get_int32(r, &bio_len) < 0) return -1;
+    if (bio_len < 0 || bio_len > LEGACY_BIO_SIZE) return -1;
+    if (get_chars(r, m->bio, sizeof(m->bio), (size_t) bio_len) < 0) return -1;
+    if (get_int32(r, &m->user.total_score) < 0 || get_int32(r, &m->user.total_games) < 0 ||
+        get_int32(r, &m->user.total_wins) < 0) return -1;
+    m->user.bio = m->bio;
+    // skip the padding
+    return get_bytes(r, NULL, LEGACY_USER_SIZE - (r->pos - start));
+}
+
+static void put_user_v2(Writer *w, const User *user) {
+    put_string(w, user->username, USERNAME_SIZE);
+    put_varint(w, zigzag_encode(user->id));
+    put_string(w, user->bio, BIO_SIZE);
+    put_varint(w, zigzag_encode(user->total_score));
+    put_varint(w, zigzag_encode(user->total_games));
+    put_varint(w, zigzag_encode(user->total_wins));
+}
+
+static int get_user_v2(Reader *r, Message *m) {
+    if (get_string(r, m->user.username, sizeof(m->user.username), USERNAME_SIZE) < 0) return -1;
+    if (get_varint_int(r, &m->user.id) < 0) return -1;
+    if (get_string(r, m->bio, sizeof(m->bio), BIO_SIZE) < 0) return -1;
+    if (get_varint_int(r, &m->user.total_score) < 0 || get_varint_int(r, &m->user.total_games) < 0 ||
+        get_varint_int(r, &m->user.total_wins) < 0) return -1;
+    m->user.bio = m->bio;
+    return 0;
+}
+
+int encode_Message(CallType type, uint8_t to_server, uint8_t version, const Message *message, uint8_t *buffer, size_t size) {
+    const Schema *schema = find_schema(type, to_server);
+    if (!schema) return -1;
+    if (type == CONNECT) version = PROTOCOL_V1;
+
+    Writer w = {buffer, size, 0, 0};
+    int nb_ints = 0;
+    for (int f = 0; f < MAX_SCHEMA_FIELDS && schema->fields[f] != FIELD_END; f++) {
+        switch (schema->fields[f]) {
+            case FIELD_INT:
+                if (version == PROTOCOL_V1) put_int32(&w, message->ints[nb_ints]);
+                else put_varint(&w, zigzag_encode(message->ints[nb_ints]));
+                nb_ints++;
+                break;
+            case FIELD_USERNAME:
+                if (version == PROTOCOL_V1) put_fixed_string(&w, message->username, USERNAME_SIZE + 1);
+                else put_string(&w, message->username, USERNAME_SIZE);
+                break;
+            case FIELD_TEXT:
+                if (version != PROTOCOL_V1) put_string(&w, message->text, MESSAGE_TEXT_SIZE - 1);
+                else if (schema->legacy_text_size) put_fixed_string(&w, message->text, schema->legacy_text_size);
+                else put_bytes(&w, message->text, strnlen(message->text, MESSAGE_TEXT_SIZE - 1) + 1);
+                break;
+            case FIELD_USER:
+                if (version == PROTOCOL_V1) put_user_v1(&w, &message->user);
+                else put_user_v2(&w, &message->user);
+                break;
+            case FIELD_VERSION:
+                if (version != PROTOCOL_V1 || message->version != PROTOCOL_V1) put_bytes(&w, &message->version, 1);
+                break;
+            case FIELD_BOARD:
+                put_bytes(&w, message->board, sizeof(message->board));
+                break;
+        }
+    }
+    // the client recognizes a V1 confirmation by its size
+    if (type == CONNECT_CONFIRM && version != PROTOCOL_V1 && w.pos == LEGACY_USER_SIZE) put_bytes(&w, NULL, 1);
+    return w.overflow ? -1 : (int) w.pos;
+}
+
+int decode_Message(CallType type, uint8_t to_server, uint8_t version, const uint8_t *payload, size_t size, Message *message) {
+    const Schema *schema = find_schema(type, to_server);
+    if (!schema) return -1;
+    if (type == CONNECT) version = PROTOCOL_V1;
+
+    // cheap rejection of the payloads that cannot match, before looking at their content
+    size_t min, max;
+    schema_size_bounds(schema, version, &min, &max);
+    if (size < min || size > max) return -1;
+
+    Reader r = {payload, size, 0};
+    int nb_ints = 0;
+    for (int f = 0; f < MAX_SCHEMA_FIELDS && schema->fields[f] != FIELD_END; f++) {
+        int ret = 0;
+        switch (schema->fields[f]) {
+            case FIELD_INT:
+                if (version == PROTOCOL_V1) ret = get_int32(&r, &message->ints[nb_ints]);
+                else ret = get_varint_int(&r, &message->ints[nb_ints]);
+                nb_ints++;
+                break;
+            case FIELD_USERNAME:
+                if (version == PROTOCOL_V1) ret = get_chars(&r, message->username, sizeof(message->username), USERNAME_SIZE + 1);
+                else ret = get_string(&r, message->username, sizeof(message->username), USERNAME_SIZE);
+                break;
+            case FIELD_TEXT:
+                if (version != PROTOCOL_V1) ret = get_string(&r, message->text, sizeof(message->text), MESSAGE_TEXT_SIZE - 1);
+                else if (schema->legacy_text_size) ret = get_chars(&r, message->text, sizeof(message->text), schema->legacy_text_size);
+                else ret = get_chars(&r, message->text, sizeof(message->text), r.size - r.pos);
+                break;
+            case FIELD_USER:
+                if (version == PROTOCOL_V1) ret = get_user_v1(&r, message);
+                else ret = get_user_v2(&r, message);
+                break;
+            case FIELD_VERSION:
+                // a V1 peer does not send any version: nothing is left but the fields that follow
+                if (version == PROTOCOL_V1 && r.size - r.pos == v1_fields_size(schema, f + 1)) message->version = PROTOCOL_V1;
+                else ret = get_bytes(&r, &message->version, 1);
+                break;
+            case FIELD_BOARD:
+                ret = get_bytes(&r, message->board, sizeof(message->board));
+                break;
+        }
+        if (ret < 0) return -1;
     }
     return 0;
 }
 
+uint8_t connect_confirm_version(size_t payload_size) {
+    return payload_size == LEGACY_USER_SIZE ? PROTOCOL_V1 : PROTOCOL_V2;
+}
 
 void serialize_User(User *user, uint8_t *buffer) {
-    memcpy(buffer, user->username, sizeof(user->username));
-    memcpy(buffer + sizeof(user->username), &user->id, sizeof(user->id));
-    // Serialize bio as a string preceded by its length
-    int bio_len = strlen(user->bio);
-    memcpy(buffer + sizeof(user->username) + sizeof(user->id), &bio_len, sizeof(bio_len));
-    memcpy(buffer + sizeof(user->username) + sizeof(user->id) + sizeof(bio_len), user->bio, bio_len);
-    memcpy(buffer + sizeof(user->username) + sizeof(user->id) + sizeof(bio_len) + bio_len, &user->total_score, sizeof(user->total_score));
-    memcpy(buffer + sizeof(user->username) + sizeof(user->id) + sizeof(bio_len) + bio_len + sizeof(user->total_score), &user->total_games, sizeof(user->total_games));
-    memcpy(buffer + sizeof(user->username) + sizeof(user->id) + sizeof(bio_len) + bio_len + sizeof(user->total_score) + sizeof(user->total_games), &user->total_wins, sizeof(user->total_wins));
+    Writer w = {buffer, LEGACY_USER_SIZE, 0, 0};
+    put_user_v1(&w, user);
 }
 
 // Deserialize a byte buffer into User struct
 void deserialize_User(uint8_t *buffer, User *user) {
-    memcpy(user->username, buffer, sizeof(user->username));
-    memcpy(&user->id, buffer + sizeof(user->username), sizeof(user->id));
-    int bio_len;
-    memcpy(&bio_len, buffer + sizeof(user->username) + sizeof(user->id), sizeof(bio_len));
-    user->bio = malloc(bio_len + 1);
-    memcpy(user->bio, buffer + sizeof(user->username) + sizeof(user->id) + sizeof(bio_len), bio_len);
-    user->bio[bio_len] = '\0';
-    memcpy(&user->total_score, buffer + sizeof(user->username) + sizeof(user->id) + sizeof(bio_len) + bio_len, sizeof(user->total_score));
-    memcpy(&user->total_games, buffer + sizeof(user->username) + sizeof(user->id) + sizeof(bio_len) + bio_len + sizeof(user->total_score), sizeof(user->total_games));
-    memcpy(&user->total_wins, buffer + sizeof(user->username) + sizeof(user->id) + sizeof(bio_len) + bio_len + sizeof(user->total_score) + sizeof(user->total_games), sizeof(user->total_wins));
+    Message m;
+    Reader r = {buffer, LEGACY_USER_SIZE, 0};
+    if (get_user_v1(&r, &m) < 0) {
+        memset(&m.user, 0, sizeof(m.user));
+        m.bio[0] = '\0';
+    }
+    *user = m.user;
+    user->bio = strdup(m.bio);
 }
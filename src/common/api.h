@@ -43,13 +43,37 @@ typedef enum CallType {
     PLAY_MADE_WATCHER = 26, // Sends to the watchers the play made
     USER_WANTS_TO_EXIT_WATCH = 27, // Notify server that the watcher wants to stop watching the game
     GAME_OVER_WATCHER = 28, // Notify the watchers that the game is over
-    CONSULT_RANKING = 29, // Request the ranking from the server
-
+    CONSULT_RANKING = 29, // Request a page of the ranking (first rank, lines), answered with own rank, players ranked, page
+    EVALUATE_POSITION = 30, // Request board + player to move, answered with the endgame tablebase value and best move
+    SUGGEST_MOVE = 31, // Request of a player whose turn it is, answered with the opening book move (0 if none) and value
+    GAME_SNAPSHOT = 32, // Sent to a new watcher before the moves: board, scores and number of moves played (PROTOCOL_V2)
 
 } CallType;
 
-// Returns the size of a CallType payload, excluding the CallType itself.
-size_t sizeof_CallType(CallType type);
+#define NB_CALL_TYPES (GAME_SNAPSHOT + 1)
+
+// Direction of a CallType, and how the client processes it
+typedef enum CallFlags {
+    CALL_TO_SERVER = 1 << 0, // sent from the client to the server
+    CALL_TO_CLIENT_ASYNC = 1 << 1, // sent to the client, processed by the gui loop
+    CALL_TO_CLIENT_SYNC = 1 << 2 // sent to the client, processed right away by the network thread (interruption)
+} CallFlags;
+
+typedef struct CallDescriptor {
+    const char *name;
+    uint8_t flags; // CallFlags
+} CallDescriptor;
+
+// O(1) lookup in the CallType table, NULL for an unknown CallType
+const CallDescriptor *describe_CallType(CallType type);
+
+#define CALL_VARIABLE_SIZE ((size_t) -1)
+
+/*
+ * Returns the size of a CallType payload in the PROTOCOL_V1 layout, excluding the frame header,
+ * CALL_VARIABLE_SIZE when it holds a variable-length text, 0 if the CallType is not sent in that direction.
+ */
+size_t sizeof_CallType(CallType type, uint8_t to_server);
 
 // Returns true if the CallType is made to send from the client to the server
 uint8_t is_server_CallType(CallType type);
@@ -69,9 +93,51 @@ typedef enum ERROR_CODE {
     UNKNOWN_ERROR = 99
 } ERROR_CODE;
 
+/*
+ * Wire format of the payloads.
+ * Every CallType has one schema per direction (list of fields), and the schema drives two encodings:
+ *  - PROTOCOL_V1: the historical layouts (int32 fields, 33-byte usernames, fixed-size texts, 1024-byte user profiles),
+ *    still spoken to the clients that do not negotiate anything. The oldest ones also send their requests without
+ *    frame header, which the server recognizes (see framing.h).
+ *  - PROTOCOL_V2: zigzag varints for integers and varint length-prefixed strings, nothing is padded.
+ * The version is negotiated at CONNECT: a client appends the highest version it speaks after the username, and the
+ * server answers with CONNECT_CONFIRM encoded in the chosen version, starting with that version.
+ * CONNECT itself always uses the PROTOCOL_V1 layout.
+ */
+#define PROTOCOL_V1 1
+#define PROTOCOL_V2 2
+#define PROTOCOL_VERSION PROTOCOL_V2
+
+#define LEGACY_USER_SIZE 1024 // size of a serialized User in PROTOCOL_V1
+#define MAX_MESSAGE_INTS 3
+#define MESSAGE_TEXT_SIZE 1024 // longest text field (user and game lists), including the terminating '\0'
+#define MAX_MESSAGE_SIZE 2048 // upper bound of an encoded payload, whatever the version
+
+// Decoded content of a payload: the fields used by the CallType schema are set, the others are left untouched
+typedef struct Message {
+    uint8_t version; // protocol version, only carried by CONNECT and CONNECT_CONFIRM
+    int32_t ints[MAX_MESSAGE_INTS]; // integer fields, in the order of the schema
+    char username[USERNAME_SIZE + 1];
+    char text[MESSAGE_TEXT_SIZE];
+    User user; // when decoded, user.bio points to the bio field below
+    char bio[BIO_SIZE + 1];
+    uint8_t board[12]; // pits, in the order of Game.board
+} Message;
+
+/*
+ * Encode @message as the payload of @type sent to the server (@to_server = 1) or to a client (@to_server = 0).
+ * Returns the payload size, or -1 if the CallType is not sent in that direction or the buffer is too small.
+ */
+int encode_Message(CallType type, uint8_t to_server, uint8_t version, const Message *message, uint8_t *buffer, size_t size);
+
+// Decode a payload into @message. Returns 0, or -1 if the payload does not match the schema.
+int decode_Message(CallType type, uint8_t to_server, uint8_t version, const uint8_t *payload, size_t size, Message *message);
+
+// Protocol version of a CONNECT_CONFIRM payload: a PROTOCOL_V2 confirmation is never LEGACY_USER_SIZE bytes long
+uint8_t connect_confirm_version(size_t payload_size);
 
-// Serialize User struct into a byte buffer
+// Serialize User struct into a LEGACY_USER_SIZE byte buffer (PROTOCOL_V1 layout)
 void serialize_User(User *user, uint8_t *buffer);
 
-// Deserialize a byte buffer into User struct
+// Deserialize a LEGACY_USER_SIZE byte buffer into User struct (the bio is allocated)
 void deserialize_User(uint8_t *buffer, User *user);
@@ -0,0 +1,127 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "book.h"
+#include "utils.h"
+
+int bookOpen(Book *book, const char *path) {
+    memset(book, 0, sizeof(*book));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return -1;
+    }
+    size_t size = (size_t) st.st_size;
+    void *map = size >= BOOK_HEADER_SIZE ? mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (map == MAP_FAILED) {
+        if (size < BOOK_HEADER_SIZE) errno = EINVAL;
+        return -1;
+    }
+
+    const uint8_t *header = map;
+    uint32_t count = (uint32_t) read_int32_le(header, 8);
+    if (memcmp(header, BOOK_MAGIC, 4) != 0 || read_int32_le(header, 4) != BOOK_VERSION
+        || size != BOOK_HEADER_SIZE + (size_t) count * BOOK_ENTRY_SIZE) {
+        munmap(map, size);
+        errno = EINVAL;
+        return -1;
+    }
+    book->map = map;
+    book->map_size = size;
+    book->entries = header + BOOK_HEADER_SIZE;
+    book->count = count;
+    return 0;
+}
+
+void bookClose(Book *book) {
+    if (book->map) munmap(book->map, book->map_size);
+    memset(book, 0, sizeof(*book));
+}
+
+static uint64_t keyAt(const Book *book, uint32_t index) {
+    return read_uint64_le(book->entries, (size_t) index * BOOK_ENTRY_SIZE);
+}
+
+void bookEntryAt(const Book *book, uint32_t index, BookEntry *entry) {
+    const uint8_t *bytes = book->entries + (size_t) index * BOOK_ENTRY_SIZE;
+    entry->key = read_uint64_le(bytes, 0);
+    entry->value = (int16_t) (bytes[8] | bytes[9] << 8);
+    entry->move = bytes[10];
+    entry->depth = bytes[11];
+    entry->visits = (uint32_t) read_int32_le(bytes, 12);
+}
+
+int bookLookup(const Book *book, uint64_t key, BookEntry *entry) {
+    if (!book->entries || book->count == 0) return -1;
+    uint32_t low = 0, high = book->count - 1;
+    uint64_t low_key = keyAt(book, low), high_key = keyAt(book, high);
+    while (low <= high && key >= low_key && key <= high_key) {
+        uint32_t probe = low;
+        if (high_key != low_key) {
+            // where the key would be if the keys between low and high were evenly spread
+            double fraction = (double) (key - low_key) / (double) (high_key - low_key);
+            probe = low + (uint32_t) (fraction * (double) (high - low));
+            if (probe > high) probe = high;
+        }
+        uint64_t probe_key = keyAt(book, probe);
+        if (probe_key == key) {
+            bookEntryAt(book, probe, entry);
+            return 0;
+        }
+        if (probe_key < key) {
+            low = probe + 1;
+            if (low > high) break;
+            low_key = keyAt(book, low);
+        } else {
+            if (probe == 0) break;
+            high = probe - 1;
+            high_key = keyAt(book, high);
+        }
+    }
+    return -1;
+}
+
+static int compareEntries(const void *a, const void *b) {
+    uint64_t key_a = ((const BookEntry *) a)->key, key_b = ((const BookEntry *) b)->key;
+    return key_a < key_b ? -1 : key_a > key_b;
+}
+
+int bookWrite(const char *path, BookEntry *entries, uint32_t count) {
+    qsort(entries, count, sizeof(BookEntry), compareEntries);
+    uint8_t header[BOOK_HEADER_SIZE] = {0};
+    memcpy(header, BOOK_MAGIC, 4);
+    write_int32_le(header, 4, BOOK_VERSION);
+    write_int32_le(header, 8, (int32_t) count);
+
+    // written aside then renamed, the servers mapping the previous book keep reading it
+    char tmp_path[4096];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    FILE *file = fopen(tmp_path, "wb");
+    if (!file) return -1;
+    int ok = fwrite(header, 1, sizeof(header), file) == sizeof(header);
+    for (uint32_t i = 0; ok && i < count; i++) {
+        uint8_t bytes[BOOK_ENTRY_SIZE];
+        write_uint64_le(bytes, 0, entries[i].key);
+        bytes[8] = (uint8_t) (entries[i].value & 0xFF);
+        bytes[9] = (uint8_t) ((entries[i].value >> 8) & 0xFF);
+        bytes[10] = (uint8_t) entries[i].move;
+        bytes[11] = (uint8_t) entries[i].depth;
+        write_int32_le(bytes, 12, (int32_t) entries[i].visits);
+        ok = fwrite(bytes, 1, sizeof(bytes), file) == sizeof(bytes);
+    }
+    if (fclose(file) != 0) ok = 0;
+    if (!ok || rename(tmp_path, path) != 0) {
+        unlink(tmp_path);
+        return -1;
+    }
+    return 0;
+}
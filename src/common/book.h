@@ -0,0 +1,45 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Opening book: the move to play in the positions of the first moves of a game, found by self-play
+ * (see src/book/main.c), keyed by the aiHash() of the position, which is the same in every process.
+ *
+ * File layout: a BOOK_HEADER_SIZE header ("AWBK", version, count as int32 LE), then count entries of
+ * BOOK_ENTRY_SIZE bytes sorted by key: key (uint64 LE), value (int16 LE), move, depth, visits (uint32 LE).
+ * Hashes are uniform, so the key of an entry is close to count * key / 2^64: the lookup is an interpolation
+ * search, a couple of probes in the mapped file whatever the size of the book.
+ */
+
+#define BOOK_MAGIC "AWBK"
+#define BOOK_VERSION 1
+#define BOOK_HEADER_SIZE 16
+#define BOOK_ENTRY_SIZE 16
+
+typedef struct BookEntry {
+    uint64_t key;
+    int value; // for the side to move, as aiBestMove() returns it
+    int move; // 1-6
+    int depth; // of the search that found the move
+    uint32_t visits; // self-play games that went through the position
+} BookEntry;
+
+typedef struct Book {
+    const uint8_t *entries; // NULL when no book is loaded
+    uint32_t count;
+    void *map;
+    size_t map_size;
+} Book;
+
+// Maps the file at @path. Returns 0, or -1 (errno set) if it cannot be read or is not a book.
+int bookOpen(Book *book, const char *path);
+void bookClose(Book *book);
+
+void bookEntryAt(const Book *book, uint32_t index, BookEntry *entry);
+
+// Returns 0 and fills @entry when the position of @key is in the book, -1 otherwise. Never allocates.
+int bookLookup(const Book *book, uint64_t key, BookEntry *entry);
+
+// Sorts @entries (keys must be unique) and writes them as a book at @path, replacing it atomically. Returns 0 or -1.
+int bookWrite(const char *path, BookEntry *entries, uint32_t count);
@@ -0,0 +1,119 @@
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include "framing.h"
+#include "utils.h"
+
+#define FRAME_BUFFER_MIN_READ 4096
+
+void frame_buffer_init(FrameBuffer *fb) {
+    fb->data = NULL;
+    fb->capacity = 0;
+    fb->start = 0;
+    fb->end = 0;
+    fb->layout = FRAME_LAYOUT_FRAMED;
+}
+
+void frame_buffer_accept_legacy(FrameBuffer *fb) {
+    fb->layout = FRAME_LAYOUT_DETECT;
+}
+
+void frame_buffer_free(FrameBuffer *fb) {
+    free(fb->data);
+    frame_buffer_init(fb);
+}
+
+// Makes room for at least @needed more bytes after the received ones
+static int reserve(FrameBuffer *fb, size_t needed) {
+    // move the pending bytes back to the beginning of the buffer first
+    if (fb->start > 0) {
+        memmove(fb->data, fb->data + fb->start, fb->end - fb->start);
+        fb->end -= fb->start;
+        fb->start = 0;
+    }
+    if (fb->capacity - fb->end >= needed) return 0;
+
+    size_t capacity = fb->capacity ? fb->capacity : FRAME_BUFFER_MIN_READ;
+    while (capacity - fb->end < needed) capacity *= 2;
+    uint8_t *data = realloc(fb->data, capacity);
+    if (!data) return -1;
+    fb->data = data;
+    fb->capacity = capacity;
+    return 0;
+}
+
+ssize_t frame_buffer_fill(FrameBuffer *fb, int fd, int flags) {
+    if (reserve(fb, FRAME_BUFFER_MIN_READ) < 0) return -1;
+    ssize_t n = recv(fd, fb->data + fb->end, fb->capacity - fb->end, flags);
+    if (n > 0) fb->end += n;
+    return n;
+}
+
+/*
+ * Payload size of a request sent by a legacy client: the fixed PROTOCOL_V1 size of the CallType, -1 if it is never
+ * sent to the server. Their CONNECT is only the username, the version came with PROTOCOL_V2.
+ */
+static long legacy_payload_size(CallType type) {
+    if (type == CONNECT) return USERNAME_SIZE + 1;
+    if (!is_server_CallType(type)) return -1;
+    size_t size = sizeof_CallType(type, 1);
+    return size == CALL_VARIABLE_SIZE ? -1 : (long) size;
+}
+
+/*
+ * A framed CONNECT carries the V1 username, maybe followed by the version, so its size is one of two values; a legacy
+ * CONNECT has the username there instead. Only the one-character usernames "!" and "\"" would read as such a size.
+ */
+static void detect_layout(FrameBuffer *fb, const uint8_t *header) {
+    uint32_t size = (uint32_t) read_int32_le(header, 4);
+    int legacy = read_int32_le(header, 0) == CONNECT && size != USERNAME_SIZE + 1 && size != USERNAME_SIZE + 2;
+    fb->layout = legacy ? FRAME_LAYOUT_LEGACY : FRAME_LAYOUT_FRAMED;
+}
+
+static int next_legacy_request(FrameBuffer *fb, Frame *frame) {
+    size_t available = fb->end - fb->start;
+    if (available < 4) return 0;
+
+    const uint8_t *request = fb->data + fb->start;
+    frame->type = (CallType) read_int32_le(request, 0);
+    long payload_size = legacy_payload_size(frame->type);
+    if (payload_size < 0) return -1;
+    if (available < 4 + (size_t) payload_size) return 0;
+
+    frame->payload_size = (uint32_t) payload_size;
+    frame->payload = request + 4;
+    fb->start += 4 + (size_t) payload_size;
+    if (fb->start == fb->end) {
+        fb->start = fb->end = 0;
+    }
+    return 1;
+}
+
+int frame_buffer_next(FrameBuffer *fb, Frame *frame) {
+    if (fb->layout == FRAME_LAYOUT_LEGACY) return next_legacy_request(fb, frame);
+    size_t available = fb->end - fb->start;
+    if (available < FRAME_HEADER_SIZE) return 0;
+
+    const uint8_t *header = fb->data + fb->start;
+    if (fb->layout == FRAME_LAYOUT_DETECT) {
+        detect_layout(fb, header);
+        if (fb->layout == FRAME_LAYOUT_LEGACY) return next_legacy_request(fb, frame);
+    }
+    uint32_t payload_size = (uint32_t) read_int32_le(header, 4);
+    if (payload_size > MAX_FRAME_PAYLOAD_SIZE) return -1;
+    if (available < FRAME_HEADER_SIZE + payload_size) return 0;
+
+    frame->type = (CallType) read_int32_le(header, 0);
+    frame->payload_size = payload_size;
+    frame->payload = header + FRAME_HEADER_SIZE;
+    fb->start += FRAME_HEADER_SIZE + payload_size;
+    if (fb->start == fb->end) {
+        fb->start = fb->end = 0;
+    }
+    return 1;
+}
+
+void frame_write_header(uint8_t *buffer, CallType type, uint32_t payload_size) {
+    write_int32_le(buffer, 0, (int32_t) type);
+    write_int32_le(buffer, 4, (int32_t) payload_size);
+}
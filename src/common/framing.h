@@ -0,0 +1,57 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include "api.h"
+
+/*
+ * Every message, in both directions, is sent as a frame:
+ *   [CallType: int32 LE][payload size: uint32 LE][payload]
+ * A FrameBuffer accumulates the bytes received on a connection and only hands out complete frames,
+ * whatever the way TCP split or merged them.
+ *
+ * Clients older than the frames send their requests as [CallType][payload in the PROTOCOL_V1 layout], without size:
+ * the server lets the first request of a connection tell them apart (frame_buffer_accept_legacy), and then takes the
+ * size of each payload from the CallType. Such a request is handed out as a Frame like the others.
+ */
+
+#define FRAME_HEADER_SIZE 8
+#define MAX_FRAME_PAYLOAD_SIZE (64 * 1024)
+
+typedef struct Frame {
+    CallType type;
+    uint32_t payload_size;
+    const uint8_t *payload; // points into the FrameBuffer, valid until the next frame_buffer_fill()
+} Frame;
+
+typedef enum FrameLayout {
+    FRAME_LAYOUT_FRAMED = 0,
+    FRAME_LAYOUT_DETECT, // the first request is not there yet: it tells a legacy client from a framed one
+    FRAME_LAYOUT_LEGACY // requests of a client older than the frames
+} FrameLayout;
+
+typedef struct FrameBuffer {
+    uint8_t *data;
+    size_t capacity;
+    size_t start; // first byte not consumed yet
+    size_t end; // end of the received bytes
+    uint8_t layout; // FrameLayout of the received bytes
+} FrameBuffer;
+
+void frame_buffer_init(FrameBuffer *fb);
+void frame_buffer_free(FrameBuffer *fb);
+
+/*
+ * Accept the requests of the legacy clients on this connection, recognized by their first request: a CONNECT not
+ * followed by the size of a framed CONNECT payload. Only for the server side of a fresh connection.
+ */
+void frame_buffer_accept_legacy(FrameBuffer *fb);
+
+// Receive the bytes available on @fd (one recv() call with @flags). Same return value as recv().
+ssize_t frame_buffer_fill(FrameBuffer *fb, int fd, int flags);
+
+// Returns 1 and fills @frame if a complete frame is buffered, 0 if more bytes are needed, -1 if the stream is invalid
+int frame_buffer_next(FrameBuffer *fb, Frame *frame);
+
+// Write the frame header in the FRAME_HEADER_SIZE first bytes of @buffer
+void frame_write_header(uint8_t *buffer, CallType type, uint32_t payload_size);
@@ -0,0 +1,163 @@
+#include <stdlib.h>
+#include <string.h>
+#include "game_record.h"
+#include "rules.h"
+#include "utils.h"
+
+#define GAME_LOG_FORMAT_VERSION 3
+
+static const char game_log_magic[4] = {'A', 'W', 'G', 'L'};
+
+void writeGameLogHeader(uint8_t *buffer) {
+    memcpy(buffer, game_log_magic, 4);
+    write_int32_le(buffer, 4, GAME_LOG_FORMAT_VERSION);
+}
+
+int checkGameLogHeader(const uint8_t *data, size_t size) {
+    if (size < GAME_LOG_HEADER_SIZE || memcmp(data, game_log_magic, 4) != 0) return -1;
+    return read_int32_le(data, 4) == GAME_LOG_FORMAT_VERSION ? 0 : -1;
+}
+
+static uint32_t checksum(const uint8_t *data, size_t size) {
+    uint32_t hash = 2166136261u;
+    for (size_t k = 0; k < size; k++) {
+        hash = (hash ^ data[k]) * 16777619u;
+    }
+    return hash;
+}
+
+// Size of the payload of an entry of @kind (of @nb_moves for a GAME_LOG_MOVES), 0 for an unknown kind
+static size_t payloadSize(uint8_t kind, uint8_t nb_moves) {
+    switch (kind) {
+        case GAME_LOG_START: return 5 + 16;
+        case GAME_LOG_MOVES: return nb_moves >= 1 && nb_moves <= GAME_LOG_MAX_MOVES ? 5 + 5 + (nb_moves + 1) / 2 : 0;
+        case GAME_LOG_END: return 5 + 9;
+        default: return 0;
+    }
+}
+
+size_t encodeGameLogEntry(const GameLogEntry *entry, uint8_t *buffer) {
+    uint8_t *payload = buffer + GAME_LOG_ENTRY_HEADER_SIZE;
+    payload[0] = entry->kind;
+    write_int32_le(payload, 1, (int32_t) entry->game_id);
+    switch (entry->kind) {
+        case GAME_LOG_START:
+            write_int32_le(payload, 5, entry->player1_id);
+            write_int32_le(payload, 9, entry->player2_id);
+            write_uint64_le(payload, 13, entry->start_time);
+            break;
+        case GAME_LOG_MOVES:
+            write_int32_le(payload, 5, (int32_t) entry->ply);
+            payload[9] = entry->nb_moves;
+            memset(payload + 10, 0, (entry->nb_moves + 1) / 2);
+            for (int k = 0; k < entry->nb_moves; k++) {
+                payload[10 + k / 2] |= (uint8_t) ((entry->moves[k] & 0x0f) << (k % 2 * 4));
+            }
+            break;
+        case GAME_LOG_END:
+            write_int32_le(payload, 5, (int32_t) entry->duration);
+            payload[9] = (uint8_t) ((entry->winner & 0x03) | (entry->abandoned ? 0x04 : 0));
+            write_int32_le(payload, 10, (int32_t) entry->plies);
+            break;
+    }
+    size_t size = payloadSize(entry->kind, entry->nb_moves);
+    write_int32_le(buffer, 0, (int32_t) size);
+    write_int32_le(buffer, 4, (int32_t) checksum(payload, size));
+    return GAME_LOG_ENTRY_HEADER_SIZE + size;
+}
+
+long decodeGameLogEntry(const uint8_t *data, size_t size, GameLogEntry *entry) {
+    if (size < GAME_LOG_ENTRY_HEADER_SIZE + 1) return -1;
+    uint32_t payload_size = (uint32_t) read_int32_le(data, 0);
+    const uint8_t *payload = data + GAME_LOG_ENTRY_HEADER_SIZE;
+    if (payload_size == 0 || payload_size > size - GAME_LOG_ENTRY_HEADER_SIZE) return -1;
+    if (checksum(payload, payload_size) != (uint32_t) read_int32_le(data, 4)) return -1;
+    if (payload_size != payloadSize(payload[0], payload_size > 9 ? payload[9] : 0)) return -1;
+    memset(entry, 0, sizeof(GameLogEntry));
+    entry->kind = payload[0];
+    entry->game_id = (uint32_t) read_int32_le(payload, 1);
+    switch (entry->kind) {
+        case GAME_LOG_START:
+            entry->player1_id = read_int32_le(payload, 5);
+            entry->player2_id = read_int32_le(payload, 9);
+            entry->start_time = read_uint64_le(payload, 13);
+            break;
+        case GAME_LOG_MOVES:
+            entry->ply = (uint32_t) read_int32_le(payload, 5);
+            entry->nb_moves = payload[9];
+            for (int k = 0; k < entry->nb_moves; k++) {
+                entry->moves[k] = (payload[10 + k / 2] >> (k % 2 * 4)) & 0x0f;
+            }
+            break;
+        case GAME_LOG_END:
+            entry->duration = (uint32_t) read_int32_le(payload, 5);
+            entry->winner = payload[9] & 0x03;
+            entry->abandoned = (payload[9] >> 2) & 1;
+            entry->plies = (uint32_t) read_int32_le(payload, 10);
+            break;
+    }
+    return (long) (GAME_LOG_ENTRY_HEADER_SIZE + payload_size);
+}
+
+int applyGameLogEntry(GameRecord *record, const GameLogEntry *entry) {
+    record->id = entry->game_id;
+    switch (entry->kind) {
+        case GAME_LOG_START:
+            record->player1_id = entry->player1_id;
+            record->player2_id = entry->player2_id;
+            record->start_time = entry->start_time;
+            break;
+        case GAME_LOG_MOVES: {
+            uint32_t end = entry->ply + entry->nb_moves;
+            if (end > record->moves_capacity) {
+                uint32_t capacity = record->moves_capacity ? record->moves_capacity : 64;
+                while (capacity < end) capacity *= 2;
+                uint8_t *moves = realloc(record->moves, capacity);
+                if (!moves) return -1;
+                memset(moves + record->moves_capacity, 0, capacity - record->moves_capacity);
+                record->moves = moves;
+                record->moves_capacity = capacity;
+            }
+            memcpy(record->moves + entry->ply, entry->moves, entry->nb_moves);
+            if (end > record->plies) record->plies = end;
+            break;
+        }
+        case GAME_LOG_END:
+            record->finished = 1;
+            record->duration = entry->duration;
+            record->winner = entry->winner;
+            record->abandoned = entry->abandoned;
+            break;
+    }
+    return 0;
+}
+
+void freeGameRecord(GameRecord *record) {
+    free(record->moves);
+    record->moves = NULL;
+    record->moves_capacity = 0;
+}
+
+int replayGameRecord(const GameRecord *record, int plies, Game *game) {
+    if (plies < 0 || (uint32_t) plies > record->plies) plies = (int) record->plies;
+    Player player1 = newPlayer(record->player1_id, -1);
+    Player player2 = newPlayer(record->player2_id, -1);
+    memset(game, 0, sizeof(Game));
+    game->id = (int) record->id;
+    game->player1 = player1;
+    game->player2 = player2;
+    for (int i = 0; i < 12; i++) {
+        game->board[i] = 4;
+    }
+    for (int ply = 0; ply < plies; ply++) {
+        int player = ply % 2 == 0 ? 1 : 2;
+        int points = playMove(game, player, record->moves[ply]);
+        if (points < 0) return -1;
+        if (player == 1) {
+            game->player1.score += points;
+        } else {
+            game->player2.score += points;
+        }
+    }
+    return plies;
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "model.h"
+
+/*
+ * Games logged while they are played, compact enough to store every one of them: the players, when the game was
+ * played, the moves as soon as they are played, 4 bits each, and how it ended. Boards are never stored, any position is
+ * rebuilt by replaying the moves.
+ *
+ * A game log is a header followed by entries, the ones of the games played at the same time interleaved:
+ *   [magic "AWGL"][format version: int32 LE]
+ *   [payload size: uint32 LE][FNV-1a of the payload: uint32 LE][kind: 1 byte][game id: uint32 LE], then by kind:
+ *   - GAME_LOG_START: [player1 id][player2 id: int32 LE][start time: uint64 LE, unix seconds]
+ *   - GAME_LOG_MOVES: moves played in a row, [first ply: uint32 LE, 0 for the first move of player1]
+ *     [count: 1 byte, 1 to GAME_LOG_MAX_MOVES][moves: 4 bits each (1-6), the first one in the low bits of the first byte]
+ *   - GAME_LOG_END: [duration: uint32 LE, seconds][result: 1 byte, winner (0 for a draw) in bits 0-1, abandoned in
+ *     bit 2][number of moves: uint32 LE]
+ * A game without its GAME_LOG_END was still being played when the server stopped, its moves are there up to the last
+ * one written.
+ */
+
+#define GAME_LOG_HEADER_SIZE 8
+#define GAME_LOG_ENTRY_HEADER_SIZE 8 // payload size, checksum
+#define GAME_LOG_MAX_MOVES 32 // of a GAME_LOG_MOVES
+#define GAME_LOG_ENTRY_MAX_SIZE (GAME_LOG_ENTRY_HEADER_SIZE + 1 + 4 + 5 + GAME_LOG_MAX_MOVES / 2) // a full GAME_LOG_MOVES
+
+typedef enum {
+    GAME_LOG_START = 1,
+    GAME_LOG_MOVES,
+    GAME_LOG_END
+} GameLogEntryKind;
+
+typedef struct GameLogEntry {
+    uint8_t kind;
+    uint32_t game_id; // given by the log when the game starts, in the order the games started
+    // GAME_LOG_START
+    int32_t player1_id;
+    int32_t player2_id;
+    uint64_t start_time;
+    // GAME_LOG_MOVES
+    uint32_t ply; // of the first move
+    uint8_t nb_moves;
+    uint8_t moves[GAME_LOG_MAX_MOVES]; // 1-6
+    // GAME_LOG_END
+    uint32_t duration;
+    uint8_t winner; // 1 or 2, 0 for a draw
+    uint8_t abandoned; // the loser left the game
+    uint32_t plies;
+} GameLogEntry;
+
+// A game rebuilt from its entries
+typedef struct GameRecord {
+    uint32_t id;
+    int32_t player1_id; // the player that played first
+    int32_t player2_id;
+    uint64_t start_time;
+    uint32_t duration;
+    uint8_t finished; // its GAME_LOG_END is in the log
+    uint8_t winner;
+    uint8_t abandoned;
+    uint32_t plies; // moves played by both players
+    uint8_t *moves; // move (1-6) of every ply, grown with the game
+    uint32_t moves_capacity;
+} GameRecord;
+
+void writeGameLogHeader(uint8_t *buffer);
+// Returns -1 if @data does not start with the header of a game log
+int checkGameLogHeader(const uint8_t *data, size_t size);
+
+// Encode @entry into @buffer (GAME_LOG_ENTRY_MAX_SIZE bytes). Returns the size of the entry.
+size_t encodeGameLogEntry(const GameLogEntry *entry, uint8_t *buffer);
+// Decode the entry at the start of @data. Returns its size, -1 if it is truncated or corrupted.
+long decodeGameLogEntry(const uint8_t *data, size_t size, GameLogEntry *entry);
+
+// Add @entry to @record, the game it belongs to (zeroed before its GAME_LOG_START). Returns -1 if out of memory.
+int applyGameLogEntry(GameRecord *record, const GameLogEntry *entry);
+void freeGameRecord(GameRecord *record);
+
+/*
+ * Rebuild in @game the position after the first @plies moves of @record (all of them if @plies is negative or larger),
+ * from the starting board and through the rules, scores included.
+ * Returns the number of moves replayed, -1 if one of them is illegal or missing.
+ */
+int replayGameRecord(const GameRecord *record, int plies, Game *game);
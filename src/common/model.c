@@ -1,4 +1,5 @@
 #include "model.h"
+#include "simd.h"
 
 void printUser(User *user) {
     printf("User { username: %s, bio: %s, total_score: %d, total_games %d, total_wins: %d }\n", user->username, user->bio, user->total_score,
@@ -14,7 +15,7 @@ void printPlayer(Player *player) {
 
 void printBoard(const int *board, int player) {
     if (player == 1) {
-        printf("]\n    - p2: [");
+        printf("    - p2: [");
         for (int i = 11; i>=6; i--) {
             printf("%d", board[i]);
             if (i != 6) printf(", ");
@@ -56,21 +57,21 @@ void printGame(Game *game, int player) {
 User newUser(char const *username, char *bio) {
     User user;
     strncpy(user.username, username, sizeof(user.username));
-    srand( time( NULL ) );
-    user.id = rand() % 100000;
+    // the id is given by the server (its user store), reseeding rand with the time here made users collide
+    user.id = 0;
     user.bio = bio;
     user.total_score = 0;
-    user.total_games = rand() % 100;
+    user.total_games = 0;
     user.total_wins = 0;
 
     return user;
 }
 
-Player newPlayer(int user_id, int fd) {
+Player newPlayer(int user_id, int32_t handle) {
     return (Player){
         .score = 0,
         .user_id = user_id,
-        .fd = fd
+        .handle = handle
     };
 }
 
@@ -78,6 +79,7 @@ Game *newGame(Player *player1, Player *player2) {
     Game *game = (Game *)malloc(sizeof(Game));
     if (!game) return NULL;
 
+    game->id = 0;
     game->player1 = *player1;
     game->player2 = *player2;
 
@@ -108,62 +110,138 @@ int moveSeeds(Game *game, int start_position) {
     return position;
 }
 
+// First pit of the run of captured pits ending at @last, from the capture mask of the row (pits holding 2 or 3 seeds)
+static int captureRunStart(unsigned int capture_mask, int last) {
+    unsigned int misses = ~capture_mask & ((2u << last) - 1);
+    return misses == 0 ? 0 : 32 - __builtin_clz(misses);
+}
+
 int collectSeedsAndCountPoints(Game *game, int position, int player) {
-    int score = 0;
-    int seeds_on_hole;
-    if (player==1) {
-        if (position<6 && position>=0){
-            return score;
-        }
+    // only the opponent's row is collected: pits 6-11 for player 1, 0-5 for player 2
+    int row = player == 1 ? 6 : player == 2 ? 0 : -1;
+    if (row == -1 || position < row || position >= row + 6) return 0;
 
-        while (1) {
-            seeds_on_hole = game->board[position];
-            if (seeds_on_hole< 2 || seeds_on_hole > 3) {
-                break;
-            }
-            score += seeds_on_hole;
-            game->board[position] = 0;
-            position--;
-            if (position == 5) {
-                break;
-            }
-        }
-        return score;
-    }
+    // most moves capture nothing: decided on the last pit alone, before loading the row
+    if ((game->board[position] & ~1) != 2) return 0;
 
-    if (player==2) {
-        if (position<12 && position>=6){
-            return score;
-        }
-        while (1) {
-            seeds_on_hole = game->board[position];
-            if (seeds_on_hole< 2 || seeds_on_hole > 3) {
-                break;
-            }
-            score += seeds_on_hole;
-            game->board[position] = 0;
-            position--;
-            if (position == - 1) {
-                break;
-            }
-        }
-        return score;
+    int score = 0;
+    int first = row + captureRunStart(rowKernels()->captureMask(game->board + row), position - row);
+    for (int i = first; i <= position; i++) {
+        score += game->board[i];
+        game->board[i] = 0;
     }
     return score;
 }
 
 
 int playerSeedsLeft(Game *game, int player) {
-    int total_seeds = 0;
+    if (player == 1) return rowKernels()->rowSum(game->board);
+    if (player == 2) return rowKernels()->rowSum(game->board + 6);
+    return 0;
+}
+
+
+// ---------------------- PACKED BOARD ---------------------- //
+#define BYTES_01 0x0101010101010101ULL
+#define BYTES_7F 0x7F7F7F7F7F7F7F7FULL
+
+// 0x01 in the bytes [first, last) of a word, 0 <= first <= last <= 8
+static uint64_t byteRange(int first, int last) {
+    if (first >= last) return 0;
+    uint64_t ones = last - first == 8 ? BYTES_01 : BYTES_01 & ((1ULL << (8 * (last - first))) - 1);
+    return ones << (8 * first);
+}
+
+// 0x01 in the pits [first, last) of the board, 0 <= first <= last <= 12
+static PackedBoard pitRange(int first, int last) {
+    PackedBoard range;
+    range.words[0] = byteRange(first < 8 ? first : 8, last < 8 ? last : 8);
+    range.words[1] = byteRange(first > 8 ? first - 8 : 0, last > 8 ? last - 8 : 0);
+    return range;
+}
+
+// Sum of the bytes of a word, valid as long as it fits in a byte
+static int sumBytes(uint64_t word) {
+    return (int) ((word * BYTES_01) >> 56);
+}
+
+PackedBoard packBoard(const int *board) {
+    PackedBoard packed = {{0, 0}};
+    for (int i = 0; i < 12; i++) {
+        packed.words[i >> 3] |= (uint64_t) (board[i] & 0xFF) << (8 * (i & 7));
+    }
+    return packed;
+}
+
+void unpackBoard(const PackedBoard *packed, int *board) {
+    for (int i = 0; i < 12; i++) {
+        board[i] = packedPit(packed, i);
+    }
+}
+
+int packedPit(const PackedBoard *board, int position) {
+    return (int) ((board->words[position >> 3] >> (8 * (position & 7))) & 0xFF);
+}
+
+int packedMoveSeeds(PackedBoard *board, int start_position) {
+    int seeds_to_move = packedPit(board, start_position);
+    if (seeds_to_move == 0) return start_position;
+
+    // every full lap puts one seed in each of the 11 other pits, the remainder goes to the pits that follow
+    uint64_t laps = seeds_to_move / 11;
+    int remainder = seeds_to_move % 11;
+    board->words[start_position >> 3] &= ~(0xFFULL << (8 * (start_position & 7)));
+    PackedBoard all_but_start = pitRange(0, 12);
+    all_but_start.words[start_position >> 3] &= ~(0xFFULL << (8 * (start_position & 7)));
+
+    int first = start_position + 1;
+    int last = first + remainder; // may wrap past pit 11, never back to the start pit
+    PackedBoard head = pitRange(first < 12 ? first : 12, last < 12 ? last : 12);
+    PackedBoard wrapped = pitRange(0, last > 12 ? last - 12 : 0);
+    for (int w = 0; w < 2; w++) {
+        board->words[w] += laps * all_but_start.words[w] + head.words[w] + wrapped.words[w];
+    }
+    if (remainder == 0) return (start_position + 11) % 12;
+    return (start_position + remainder) % 12;
+}
+
+int packedCollectSeedsAndCountPoints(PackedBoard *board, int position, int player) {
+    // only the opponent's row is collected: pits 6-11 for player 1, 0-5 for player 2
+    int row = player == 1 ? 6 : player == 2 ? 0 : -1;
+    if (row == -1 || position < row || position >= row + 6) return 0;
+
+    // pits holding 2 or 3 seeds, as the high bit of their byte
+    uint64_t matches[2];
+    for (int w = 0; w < 2; w++) {
+        uint64_t differs = (board->words[w] & ~BYTES_01) ^ (2 * BYTES_01); // 0 for 2 and 3
+        matches[w] = ~(((differs & BYTES_7F) + BYTES_7F) | differs | BYTES_7F);
+    }
+    // one bit per pit of the row, then the run of captured pits ending at @position
+    unsigned int row_matches = 0;
+    for (int i = 0; i < 6; i++) {
+        int pit = row + i;
+        row_matches |= (unsigned int) ((matches[pit >> 3] >> (8 * (pit & 7) + 7)) & 1) << i;
+    }
+    int last = position - row;
+    int first = captureRunStart(row_matches, last);
+    if (first > last) return 0;
+
+    PackedBoard captured = pitRange(row + first, row + last + 1);
+    int score = 0;
+    for (int w = 0; w < 2; w++) {
+        uint64_t bytes = captured.words[w] * 0xFF;
+        score += sumBytes(board->words[w] & bytes);
+        board->words[w] &= ~bytes;
+    }
+    return score;
+}
+
+int packedPlayerSeedsLeft(const PackedBoard *board, int player) {
     if (player == 1) {
-       for (int i=0; i<6; i++) {
-           total_seeds += game->board[i];
-       }
+        return sumBytes(board->words[0] & 0x0000FFFFFFFFFFFFULL);
     }
     if (player == 2) {
-        for (int i=6; i<12; i++) {
-            total_seeds += game->board[i];
-        }
+        return sumBytes(board->words[0] & 0xFFFF000000000000ULL) + sumBytes(board->words[1] & 0xFFFFFFFFULL);
     }
-    return total_seeds;
+    return 0;
 }
@@ -6,6 +6,7 @@
 #include <sys/time.h>
 #include <sys/select.h>
 #include <stdlib.h>
+#include <stdint.h>
 
 
 #define MAX_ROUNDS 5
@@ -31,7 +32,7 @@ typedef struct User {
 typedef struct Player {
     int score;
     int user_id; // No need to store the whole User struct here, only the id matters
-    int fd;
+    int32_t handle; // connection of the player on the server (handle of its client), -1 when there is none
 } Player;
 
 typedef struct GamePreview {
@@ -55,25 +56,34 @@ typedef struct Game {
      */
     int board[12];
 
-    /*
-     * Each char stores:
-     *  - player1 played index (1-6) in the 0b00001111 bits
-     *  - player2 played index (1-6) in the 0b11110000 bits
-     *  If the index is 0, it means it hasn’t been played
-     */
-    char played[128];
-
 } Game;
 
+/*
+ * Compact board for the rules engine (validation, search): the 12 pits of Game.board in the same order, one byte
+ * each, pits 0-7 in words[0] and pits 8-11 in words[1] (its 4 upper bytes stay 0).
+ * There are 48 seeds in a game, so a pit never overflows its byte and a whole row can be summed in one byte.
+ */
+typedef struct PackedBoard {
+    uint64_t words[2];
+} PackedBoard;
+
 void printUser(User *user);
 void printPlayer(Player *player);
 void printBoard(const int *board, int  player);
 void printGame(Game *game, int player);
 
 User newUser(const char* username, char* bio);
-Player newPlayer(int user_id, int fd);
+Player newPlayer(int user_id, int32_t handle);
 Game *newGame(Player *player1, Player *player2);
 int moveSeeds(Game *game, int start_position);
 int collectSeedsAndCountPoints(Game *game, int position, int player);
 int playerSeedsLeft(Game *game, int player);
 
+PackedBoard packBoard(const int *board);
+void unpackBoard(const PackedBoard *packed, int *board);
+int packedPit(const PackedBoard *board, int position);
+// Same rules and return values as moveSeeds, collectSeedsAndCountPoints and playerSeedsLeft
+int packedMoveSeeds(PackedBoard *board, int start_position);
+int packedCollectSeedsAndCountPoints(PackedBoard *board, int position, int player);
+int packedPlayerSeedsLeft(const PackedBoard *board, int player);
+
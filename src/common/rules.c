@@ -0,0 +1,83 @@
+#include "rules.h"
+
+#define BYTES_01 0x0101010101010101ULL
+#define BYTES_7F 0x7F7F7F7F7F7F7F7FULL
+#define BYTES_80 0x8080808080808080ULL
+#define ROW_BYTES 0x0000FFFFFFFFFFFFULL
+
+// The 6 pits of the row of @player, in the 6 low bytes
+static uint64_t rowOf(const PackedBoard *board, int player) {
+    if (player == 1) return board->words[0] & ROW_BYTES;
+    return ((board->words[0] >> 48) | (board->words[1] << 16)) & ROW_BYTES;
+}
+
+// Gathers the high bit of the 6 low bytes into bits 0-5
+static unsigned int highBits(uint64_t bytes) {
+    return (unsigned int) ((((bytes >> 7) & BYTES_01) * 0x0102040810204080ULL) >> 56) & 0x3F;
+}
+
+unsigned int packedLegalMoves(const PackedBoard *board, int player) {
+    if (player != 1 && player != 2) return 0;
+    uint64_t row = rowOf(board, player);
+    // a pit holds at most 48 seeds, so the high bit of every byte is free for the comparisons
+    unsigned int non_empty = highBits(((row & BYTES_7F) + BYTES_7F) | row);
+    if (rowOf(board, 3 - player) != 0) return non_empty;
+
+    // feeding: pit i reaches the opponent's row with at least 6 - i seeds
+    const uint64_t to_opponent = 0x010203040506ULL;
+    return highBits((row | BYTES_80) - to_opponent);
+}
+
+unsigned int legalMoves(const Game *game, int player) {
+    PackedBoard board = packBoard(game->board);
+    return packedLegalMoves(&board, player);
+}
+
+int isLegalMove(const Game *game, int player, int move) {
+    if (move < 1 || move > 6) return 0;
+    return (legalMoves(game, player) >> (move - 1)) & 1;
+}
+
+int playMove(Game *game, int player, int move) {
+    if (!isLegalMove(game, player, move)) return -1;
+
+    int opponent_row = player == 1 ? 6 : 0;
+    int last = moveSeeds(game, (player == 1 ? 0 : 6) + move - 1);
+    int before[6];
+    memcpy(before, game->board + opponent_row, sizeof(before));
+    int points = collectSeedsAndCountPoints(game, last, player);
+    if (points > 0 && playerSeedsLeft(game, 3 - player) == 0) {
+        // starvation: the opponent keeps their seeds
+        memcpy(game->board + opponent_row, before, sizeof(before));
+        return 0;
+    }
+    return points;
+}
+
+int packedPlayMove(PackedBoard *board, int player, int move) {
+    if (move < 1 || move > 6 || !((packedLegalMoves(board, player) >> (move - 1)) & 1)) return -1;
+
+    int last = packedMoveSeeds(board, (player == 1 ? 0 : 6) + move - 1);
+    PackedBoard before = *board;
+    int points = packedCollectSeedsAndCountPoints(board, last, player);
+    if (points > 0 && packedPlayerSeedsLeft(board, 3 - player) == 0) {
+        *board = before;
+        return 0;
+    }
+    return points;
+}
+
+int gameWinnerWithRules(const PackedBoard *board, int score1, int score2, const GameRules *rules) {
+    // a capture can jump past the winning score, and reaching it wins even when the seed count also ends the game
+    if (score1 >= rules->winning_score) return 1;
+    if (score2 >= rules->winning_score) return 2;
+    // player 1 is checked first, as the server always did
+    if (packedPlayerSeedsLeft(board, 2) < rules->min_seeds) return 1;
+    if (packedPlayerSeedsLeft(board, 1) < rules->min_seeds) return 2;
+    return 0;
+}
+
+int gameWinner(const PackedBoard *board, int score1, int score2) {
+    static const GameRules rules = DEFAULT_GAME_RULES;
+    return gameWinnerWithRules(board, score1, score2, &rules);
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include "model.h"
+
+/*
+ * Rules shared by the server (which validates every move) and the clients (which replay them):
+ *  - a move (1-6) takes a non-empty pit of the player's row,
+ *  - feeding: when the opponent's row is empty, only the moves that sow into it are legal,
+ *  - starvation: a move that would capture every seed of the opponent captures nothing.
+ */
+
+// Legal moves of @player (1 or 2): bit i is set when move i + 1 can be played. 0 if none.
+unsigned int legalMoves(const Game *game, int player);
+unsigned int packedLegalMoves(const PackedBoard *board, int player);
+
+int isLegalMove(const Game *game, int player, int move);
+
+/*
+ * Plays move @move (1-6) of @player: sows then captures.
+ * Returns the points won, or -1 if the move is illegal, in which case the board is left untouched.
+ */
+int playMove(Game *game, int player, int move);
+int packedPlayMove(PackedBoard *board, int player, int move);
+
+/*
+ * Winner once a move has been played: 1 or 2, 0 if the game goes on.
+ * A player wins with at least WINNING_SCORE points, or when the opponent has fewer than MIN_SEEDS seeds left.
+ */
+int gameWinner(const PackedBoard *board, int score1, int score2);
+
+// End conditions of a game, to play variants of the server rules (the simulator)
+typedef struct GameRules {
+    int max_rounds; // the game is a draw once more than max_rounds moves were played
+    int winning_score;
+    int min_seeds;
+} GameRules;
+
+#define DEFAULT_GAME_RULES {MAX_ROUNDS, WINNING_SCORE, MIN_SEEDS}
+
+int gameWinnerWithRules(const PackedBoard *board, int score1, int score2, const GameRules *rules);
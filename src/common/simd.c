@@ -0,0 +1,113 @@
+#include <stdlib.h>
+#include <string.h>
+#include "simd.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+static int rowSumScalar(const int *row) {
+    int total = 0;
+    for (int i = 0; i < 6; i++) {
+        total += row[i];
+    }
+    return total;
+}
+
+static unsigned int captureMaskScalar(const int *row) {
+    unsigned int mask = 0;
+    for (int i = 0; i < 6; i++) {
+        mask |= (unsigned int) ((row[i] & ~1) == 2) << i;
+    }
+    return mask;
+}
+
+static const RowKernels scalar_kernels = {"scalar", rowSumScalar, captureMaskScalar};
+
+#ifdef HAVE_X86_KERNELS
+// pits 0-3 in one register, pits 4-5 in the low half of another: never reads past the row
+__attribute__((target("sse2")))
+static int rowSumSse2(const int *row) {
+    __m128i sum = _mm_add_epi32(_mm_loadu_si128((const __m128i *) row),
+                                _mm_loadl_epi64((const __m128i *) (row + 4)));
+    // horizontal add of the 4 lanes
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(sum);
+}
+
+__attribute__((target("sse2")))
+static unsigned int captureMaskSse2(const int *row) {
+    const __m128i not_one = _mm_set1_epi32(~1);
+    const __m128i two = _mm_set1_epi32(2);
+    __m128i low = _mm_cmpeq_epi32(_mm_and_si128(_mm_loadu_si128((const __m128i *) row), not_one), two);
+    __m128i high = _mm_cmpeq_epi32(_mm_and_si128(_mm_loadl_epi64((const __m128i *) (row + 4)), not_one), two);
+    unsigned int mask = (unsigned int) _mm_movemask_ps(_mm_castsi128_ps(low));
+    return mask | ((unsigned int) _mm_movemask_ps(_mm_castsi128_ps(high)) & 3) << 4;
+}
+
+static const RowKernels sse2_kernels = {"sse2", rowSumSse2, captureMaskSse2};
+
+// the 6 pits with a masked load, lanes 6 and 7 read as 0
+__attribute__((target("avx2")))
+static __m256i loadRowAvx2(const int *row) {
+    return _mm256_maskload_epi32(row, _mm256_setr_epi32(-1, -1, -1, -1, -1, -1, 0, 0));
+}
+
+__attribute__((target("avx2")))
+static int rowSumAvx2(const int *row) {
+    __m256i pits = loadRowAvx2(row);
+    __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(pits), _mm256_extracti128_si256(pits, 1));
+    sum = _mm_hadd_epi32(sum, sum);
+    sum = _mm_hadd_epi32(sum, sum);
+    return _mm_cvtsi128_si32(sum);
+}
+
+__attribute__((target("avx2")))
+static unsigned int captureMaskAvx2(const int *row) {
+    __m256i pits = _mm256_and_si256(loadRowAvx2(row), _mm256_set1_epi32(~1));
+    __m256i matches = _mm256_cmpeq_epi32(pits, _mm256_set1_epi32(2));
+    return (unsigned int) _mm256_movemask_ps(_mm256_castsi256_ps(matches)) & 0x3F;
+}
+
+static const RowKernels avx2_kernels = {"avx2", rowSumAvx2, captureMaskAvx2};
+#endif
+
+int supportedRowKernels(const RowKernels **kernels, int max) {
+    int count = 0;
+    if (count < max) kernels[count++] = &scalar_kernels;
+#ifdef HAVE_X86_KERNELS
+    __builtin_cpu_init();
+    if (count < max && __builtin_cpu_supports("sse2")) kernels[count++] = &sse2_kernels;
+    if (count < max && __builtin_cpu_supports("avx2")) kernels[count++] = &avx2_kernels;
+#endif
+    return count;
+}
+
+static const RowKernels *selectRowKernels(void) {
+    const RowKernels *supported[3];
+    int count = supportedRowKernels(supported, 3);
+    const char *forced = getenv("AWALNET_KERNELS");
+    if (forced) {
+        for (int i = 0; i < count; i++) {
+            if (strcmp(supported[i]->name, forced) == 0) return supported[i];
+        }
+    }
+    // SSE2 by default: on 6 pits, the masked load and the lane crossing of AVX2 cost more than they save
+    for (int i = 0; i < count; i++) {
+        if (strcmp(supported[i]->name, "sse2") == 0) return supported[i];
+    }
+    return supported[0];
+}
+
+const RowKernels *rowKernels(void) {
+    // every thread selects the same kernels, a concurrent first call only repeats the detection
+    static const RowKernels *selected = NULL;
+    const RowKernels *kernels = __atomic_load_n(&selected, __ATOMIC_ACQUIRE);
+    if (!kernels) {
+        kernels = selectRowKernels();
+        __atomic_store_n(&selected, kernels, __ATOMIC_RELEASE);
+    }
+    return kernels;
+}
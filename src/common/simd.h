@@ -0,0 +1,20 @@
+#pragma once
+
+/*
+ * Row kernels of the rules engine, on the 6 int pits of a row of Game.board.
+ * The SSE2 and AVX2 versions are compiled with target attributes and checked at runtime against the CPU features.
+ * SSE2 is used when the CPU has it, the scalar version everywhere else: AVX2 is slower on a row of 6 pits and only
+ * runs when forced. AWALNET_KERNELS=scalar|sse2|avx2 forces a version (when supported).
+ */
+
+typedef struct RowKernels {
+    const char *name;
+    int (*rowSum)(const int *row); // seeds in the row
+    unsigned int (*captureMask)(const int *row); // bit i set when pit i holds 2 or 3 seeds
+} RowKernels;
+
+// Kernels selected for this CPU, chosen on the first call
+const RowKernels *rowKernels(void);
+
+// Every version this CPU can run, scalar first, for benchmarks. Returns the count.
+int supportedRowKernels(const RowKernels **kernels, int max);
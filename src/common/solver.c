@@ -0,0 +1,197 @@
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "solver.h"
+#include "rules.h"
+
+#define FORCED_WIN (AI_WIN_VALUE - AI_MAX_DEPTH)
+#define DEFAULT_TT_MEGABYTES 64
+
+/*
+ * Lock-free entry: the key is stored xored with the data, both written and read as independent 64-bit words.
+ * An entry torn by two concurrent writers no longer matches its key and is simply a miss.
+ */
+typedef struct SharedEntry {
+    uint64_t check; // key ^ data
+    uint64_t data; // value (16 bits) | depth (8) | bound (8) | move (8)
+} SharedEntry;
+
+typedef struct Shared {
+    SharedEntry *table;
+    size_t mask;
+    int stop;
+    struct timespec deadline;
+    int has_deadline;
+} Shared;
+
+typedef struct Worker {
+    Shared *shared;
+    pthread_t thread;
+    int id;
+    AiPosition root;
+    int max_depth;
+    AiContext context; // of its searches, counts its nodes
+    // last iteration completed
+    int move;
+    int value;
+    int depth;
+} Worker;
+
+static uint64_t packEntry(const AiTtEntry *entry) {
+    return (uint64_t) (uint16_t) entry->value | (uint64_t) (uint8_t) entry->depth << 16
+           | (uint64_t) entry->bound << 24 | (uint64_t) (uint8_t) entry->move << 32;
+}
+
+static int entryDepth(uint64_t data) {
+    return (int) ((data >> 16) & 0xFF);
+}
+
+static int probe(void *arg, uint64_t key, AiTtEntry *found) {
+    const Shared *shared = arg;
+    const SharedEntry *entry = &shared->table[key & shared->mask];
+    uint64_t check = __atomic_load_n(&entry->check, __ATOMIC_RELAXED);
+    uint64_t data = __atomic_load_n(&entry->data, __ATOMIC_RELAXED);
+    if ((check ^ data) != key) return 0;
+    found->value = (int16_t) (data & 0xFFFF);
+    found->depth = entryDepth(data);
+    found->bound = (AiBound) ((data >> 24) & 0xFF);
+    found->move = (int) ((data >> 32) & 0xFF);
+    return 1;
+}
+
+static void store(void *arg, uint64_t key, const AiTtEntry *stored) {
+    Shared *shared = arg;
+    SharedEntry *entry = &shared->table[key & shared->mask];
+    uint64_t data = packEntry(stored);
+    // depth-preferred, except for entries of other positions which are always replaced
+    uint64_t old = __atomic_load_n(&entry->data, __ATOMIC_RELAXED);
+    uint64_t old_check = __atomic_load_n(&entry->check, __ATOMIC_RELAXED);
+    if ((old_check ^ old) == key && entryDepth(old) > entryDepth(data)) return;
+    __atomic_store_n(&entry->check, key ^ data, __ATOMIC_RELAXED);
+    __atomic_store_n(&entry->data, data, __ATOMIC_RELAXED);
+}
+
+static int stopped(const Shared *shared) {
+    return __atomic_load_n(&shared->stop, __ATOMIC_RELAXED);
+}
+
+static void checkDeadline(Shared *shared) {
+    if (!shared->has_deadline) return;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (now.tv_sec > shared->deadline.tv_sec
+        || (now.tv_sec == shared->deadline.tv_sec && now.tv_nsec >= shared->deadline.tv_nsec)) {
+        __atomic_store_n(&shared->stop, 1, __ATOMIC_RELAXED);
+    }
+}
+
+/*
+ * Polled by the searches of a worker: only the main thread reads the clock, the helpers stop with it.
+ * The main thread always completes its first iteration, so that there is a move to return.
+ */
+static int mustStop(void *arg) {
+    Worker *worker = arg;
+    if (worker->id == 0) {
+        if (worker->depth == 0) return 0;
+        checkDeadline(worker->shared);
+    }
+    return stopped(worker->shared);
+}
+
+static void *runWorker(void *arg) {
+    Worker *worker = arg;
+    worker->context = (AiContext) {
+        .table = {probe, store, worker->shared},
+        .poll = mustStop,
+        .poll_arg = worker,
+        // the helpers break ties from the other end of the row
+        .reverse_ties = worker->id % 2
+    };
+    // half of the helpers search one ply ahead of the main thread
+    int step = worker->id > 0 && worker->id % 2 == 0 ? 1 : 0;
+    for (int depth = 1 + step; depth <= worker->max_depth; depth++) {
+        int move = -1;
+        int value = aiNegamax(&worker->context, &worker->root, depth, -AI_WIN_VALUE - 1, AI_WIN_VALUE + 1, 0, &move);
+        if (worker->context.stopped) break;
+        worker->move = move;
+        worker->value = value;
+        worker->depth = depth;
+        if (value > FORCED_WIN || value < -FORCED_WIN) break;
+        if (worker->root.plies_left > 0 && depth >= worker->root.plies_left) break;
+        if (mustStop(worker)) break;
+    }
+    // the main thread decides: once it is done, the helpers stop too
+    if (worker->id == 0) __atomic_store_n(&worker->shared->stop, 1, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+static double elapsedSince(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double) (now.tv_sec - start->tv_sec) + (double) (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+SolverResult solvePosition(const AiPosition *position, const SolverOptions *options) {
+    SolverResult result = {-1, 0, 0, 0, 0, 0.0};
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (!packedLegalMoves(&position->board, position->to_move)) return result;
+
+    int threads = options && options->threads > 0 ? options->threads : (int) sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads < 1) threads = 1;
+    size_t megabytes = options && options->tt_megabytes ? options->tt_megabytes : DEFAULT_TT_MEGABYTES;
+    size_t entries = 1;
+    while (entries * 2 * sizeof(SharedEntry) <= megabytes << 20) entries *= 2;
+
+    Shared shared;
+    shared.table = calloc(entries, sizeof(SharedEntry));
+    Worker *workers = calloc(threads, sizeof(Worker));
+    if (!shared.table || !workers) {
+        free(shared.table);
+        free(workers);
+        return result;
+    }
+    shared.mask = entries - 1;
+    shared.stop = 0;
+    shared.has_deadline = options && options->max_time_ms > 0;
+    if (shared.has_deadline) {
+        shared.deadline = start;
+        long nsec = shared.deadline.tv_nsec + (long) (options->max_time_ms % 1000) * 1000000L;
+        shared.deadline.tv_sec += options->max_time_ms / 1000 + nsec / 1000000000L;
+        shared.deadline.tv_nsec = nsec % 1000000000L;
+    }
+    int max_depth = options && options->max_depth > 0 && options->max_depth < AI_MAX_DEPTH
+                    ? options->max_depth : AI_MAX_DEPTH;
+
+    for (int t = 0; t < threads; t++) {
+        workers[t].shared = &shared;
+        workers[t].id = t;
+        workers[t].root = *position;
+        workers[t].max_depth = max_depth;
+        workers[t].move = -1;
+    }
+    // the calling thread is the main one
+    int started = 1;
+    while (started < threads && pthread_create(&workers[started].thread, NULL, runWorker, &workers[started]) == 0) {
+        started++;
+    }
+    runWorker(&workers[0]);
+    for (int t = 1; t < started; t++) {
+        pthread_join(workers[t].thread, NULL);
+    }
+
+    result.move = workers[0].move;
+    result.value = workers[0].value;
+    result.depth = workers[0].depth;
+    result.proven = result.value > FORCED_WIN || result.value < -FORCED_WIN
+                    || (position->plies_left > 0 && result.depth >= position->plies_left);
+    for (int t = 0; t < started; t++) {
+        result.nodes += workers[t].context.nodes;
+    }
+    result.seconds = elapsedSince(&start);
+    free(workers);
+    free(shared.table);
+    return result;
+}
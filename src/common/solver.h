@@ -0,0 +1,27 @@
+#pragma once
+#include <stddef.h>
+#include "ai.h"
+
+/*
+ * Parallel solver (Lazy SMP): every thread runs the iterative deepening of aiNegamax (ai.c) on the same root, they only
+ * share a lock-free transposition table, which makes each thread start from what the others already searched.
+ * Helper threads search one ply deeper every other thread and order the moves differently, to spread the work.
+ */
+
+typedef struct SolverOptions {
+    int threads; // one per online core when <= 0
+    int max_time_ms; // 0 for no limit
+    int max_depth; // AI_MAX_DEPTH when 0
+    size_t tt_megabytes; // 64 when 0
+} SolverOptions;
+
+typedef struct SolverResult {
+    int move; // 1-6, -1 when the side to move has no legal move
+    int value; // for the side to move
+    int depth; // of the last iteration completed by the main thread
+    int proven; // the value is exact: forced result, or the search reached the end of the game
+    long nodes; // of all the threads
+    double seconds;
+} SolverResult;
+
+SolverResult solvePosition(const AiPosition *position, const SolverOptions *options);
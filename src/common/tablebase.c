@@ -0,0 +1,137 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "tablebase.h"
+#include "rules.h"
+#include "utils.h"
+
+// offsets[i][r][v]: boards where pit i holds less than v seeds, when pits i to 11 hold r seeds
+static uint32_t offsets[12][TABLEBASE_MAX_SEEDS + 1][TABLEBASE_MAX_SEEDS + 1];
+// layer_start[n]: boards holding less than n seeds
+static uint32_t layer_start[TABLEBASE_MAX_SEEDS + 2];
+static pthread_once_t offsets_once = PTHREAD_ONCE_INIT;
+
+static uint64_t binomial(int n, int k) {
+    uint64_t result = 1;
+    for (int i = 1; i <= k; i++) result = result * (uint64_t) (n - k + i) / (uint64_t) i;
+    return result;
+}
+
+// Ways to spread @seeds over @pits pits
+static uint64_t boards(int seeds, int pits) {
+    return binomial(seeds + pits - 1, pits - 1);
+}
+
+static void initOffsets(void) {
+    for (int i = 0; i < 11; i++) {
+        for (int r = 0; r <= TABLEBASE_MAX_SEEDS; r++) {
+            uint64_t sum = 0;
+            for (int v = 0; v <= r; v++) {
+                offsets[i][r][v] = (uint32_t) sum;
+                sum += boards(r - v, 11 - i);
+            }
+        }
+    }
+    for (int n = 0; n <= TABLEBASE_MAX_SEEDS + 1; n++) layer_start[n] = (uint32_t) binomial(n + 11, 12);
+}
+
+uint32_t tablebaseEntries(int max_seeds) {
+    pthread_once(&offsets_once, initOffsets);
+    if (max_seeds < 0) return 0;
+    if (max_seeds > TABLEBASE_MAX_SEEDS) max_seeds = TABLEBASE_MAX_SEEDS;
+    return layer_start[max_seeds + 1];
+}
+
+uint32_t tablebaseIndex(const int *pits) {
+    pthread_once(&offsets_once, initOffsets);
+    int seeds = 0;
+    for (int i = 0; i < 12; i++) seeds += pits[i];
+    uint32_t index = layer_start[seeds];
+    for (int i = 0, left = seeds; i < 11; left -= pits[i], i++) {
+        index += offsets[i][left][pits[i]];
+    }
+    return index;
+}
+
+int tablebaseOpen(Tablebase *tablebase, const char *path) {
+    memset(tablebase, 0, sizeof(*tablebase));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return -1;
+    }
+    size_t size = (size_t) st.st_size;
+    void *map = size >= TABLEBASE_HEADER_SIZE ? mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (map == MAP_FAILED) {
+        if (size < TABLEBASE_HEADER_SIZE) errno = EINVAL;
+        return -1;
+    }
+
+    const uint8_t *header = map;
+    int max_seeds = read_int32_le(header, 8);
+    if (memcmp(header, TABLEBASE_MAGIC, 4) != 0 || read_int32_le(header, 4) != TABLEBASE_VERSION
+        || max_seeds < 0 || max_seeds > TABLEBASE_MAX_SEEDS
+        || (uint32_t) read_int32_le(header, 12) != tablebaseEntries(max_seeds)
+        || size != TABLEBASE_HEADER_SIZE + (size_t) tablebaseEntries(max_seeds)) {
+        munmap(map, size);
+        errno = EINVAL;
+        return -1;
+    }
+    // every probe is a jump somewhere in the file
+    madvise(map, size, MADV_RANDOM);
+    tablebase->map = map;
+    tablebase->map_size = size;
+    tablebase->values = (const int8_t *) header + TABLEBASE_HEADER_SIZE;
+    tablebase->max_seeds = max_seeds;
+    tablebase->entries = tablebaseEntries(max_seeds);
+    return 0;
+}
+
+void tablebaseClose(Tablebase *tablebase) {
+    if (tablebase->map) munmap(tablebase->map, tablebase->map_size);
+    memset(tablebase, 0, sizeof(*tablebase));
+}
+
+// Pits of @board seen from @player: its row first
+static void relativePits(const PackedBoard *board, int player, int *pits) {
+    int absolute[12];
+    unpackBoard(board, absolute);
+    int first = player == 1 ? 0 : 6;
+    for (int i = 0; i < 12; i++) pits[i] = absolute[(first + i) % 12];
+}
+
+int tablebaseEvaluate(const Tablebase *tablebase, const PackedBoard *board, int player, int *value, int *best_move) {
+    if (!tablebase->values || (player != 1 && player != 2)) return -1;
+    int pits[12];
+    relativePits(board, player, pits);
+    int seeds = 0;
+    for (int i = 0; i < 12; i++) {
+        if (pits[i] < 0) return -1;
+        seeds += pits[i];
+    }
+    if (seeds > tablebase->max_seeds) return -1;
+
+    *value = tablebase->values[tablebaseIndex(pits)];
+    *best_move = 0;
+    PackedBoard relative = packBoard(pits);
+    unsigned int legal = packedLegalMoves(&relative, 1);
+    for (int move = 1; move <= 6; move++) {
+        if (!((legal >> (move - 1)) & 1)) continue;
+        PackedBoard child = relative;
+        int points = packedPlayMove(&child, 1, move);
+        int child_pits[12];
+        relativePits(&child, 2, child_pits);
+        if (points - tablebase->values[tablebaseIndex(child_pits)] == *value) {
+            *best_move = move;
+            break;
+        }
+    }
+    return 0;
+}
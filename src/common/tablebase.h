@@ -0,0 +1,49 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "model.h"
+
+/*
+ * Endgame tablebase: the exact value of every board holding at most max_seeds seeds, for the side to move, as the
+ * net number of seeds it still captures with perfect play from both sides (captures minus the opponent's).
+ * The moves are those of rules.c (feeding, starvation). A game that ends without legal move, or that loops forever,
+ * captures nothing more. The scores and the server's end conditions (WINNING_SCORE, MIN_SEEDS, MAX_ROUNDS) are not
+ * part of the position: add the value to the score difference.
+ *
+ * File layout: a TABLEBASE_HEADER_SIZE header ("AWTB", version, max_seeds, entries as int32 LE), then one int8 value
+ * per position. Positions are seen from the side to move (its row first) and ordered by seeds on the board, then
+ * lexicographically by pit, so that the index of a board is a sum of 11 table lookups.
+ * The file is mapped read-only: every process using it shares the same pages of the page cache.
+ */
+
+#define TABLEBASE_MAGIC "AWTB"
+#define TABLEBASE_VERSION 1
+#define TABLEBASE_HEADER_SIZE 16
+// 1,251,677,700 positions, C(36, 12). The int32 entry count of the header would still hold 25 seeds (1,852,482,996),
+// the cap is the memory of the generator: all the values, plus the children (uint32 each) of its largest layer,
+// C(35, 11) = 417 million boards at 24 seeds and 600 million at 25.
+#define TABLEBASE_MAX_SEEDS 24
+
+typedef struct Tablebase {
+    const int8_t *values; // NULL when no table is loaded
+    int max_seeds;
+    uint32_t entries;
+    void *map;
+    size_t map_size;
+} Tablebase;
+
+// Positions with at most @max_seeds seeds on the board
+uint32_t tablebaseEntries(int max_seeds);
+
+// Index of @pits (12 pits, the row of the side to move first, at most TABLEBASE_MAX_SEEDS seeds in total)
+uint32_t tablebaseIndex(const int *pits);
+
+// Maps the file at @path. Returns 0, or -1 (errno set) if it cannot be read or is not a tablebase.
+int tablebaseOpen(Tablebase *tablebase, const char *path);
+void tablebaseClose(Tablebase *tablebase);
+
+/*
+ * Value of @board for @player (1 or 2) to move, and the move (1-6) reaching it, 0 when the player cannot move.
+ * Returns 0, or -1 when the board holds more seeds than the table. Never allocates.
+ */
+int tablebaseEvaluate(const Tablebase *tablebase, const PackedBoard *board, int player, int *value, int *best_move);
@@ -19,3 +19,44 @@ void write_int32_le(uint8_t *buf, size_t offset, int32_t value) {
     buf[offset + 2] = (uint8_t) ((value >> 16) & 0xFF);
     buf[offset + 3] = (uint8_t) ((value >> 24) & 0xFF);
 }
+
+uint64_t read_uint64_le(const uint8_t *buf, size_t offset) {
+    return (uint64_t) (uint32_t) read_int32_le(buf, offset) | (uint64_t) (uint32_t) read_int32_le(buf, offset + 4) << 32;
+}
+
+void write_uint64_le(uint8_t *buf, size_t offset, uint64_t value) {
+    write_int32_le(buf, offset, (int32_t) (uint32_t) value);
+    write_int32_le(buf, offset + 4, (int32_t) (uint32_t) (value >> 32));
+}
+
+size_t write_varint(uint8_t *buf, size_t offset, uint32_t value) {
+    size_t n = 0;
+    while (value >= 0x80) {
+        buf[offset + n++] = (uint8_t) (value | 0x80);
+        value >>= 7;
+    }
+    buf[offset + n++] = (uint8_t) value;
+    return n;
+}
+
+int read_varint(const uint8_t *buf, size_t size, size_t *offset, uint32_t *value) {
+    uint32_t result = 0;
+    for (int i = 0; i < MAX_VARINT_SIZE; i++) {
+        if (*offset >= size) return -1;
+        uint8_t byte = buf[(*offset)++];
+        result |= (uint32_t) (byte & 0x7F) << (7 * i);
+        if (!(byte & 0x80)) {
+            *value = result;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+uint32_t zigzag_encode(int32_t value) {
+    return ((uint32_t) value << 1) ^ (uint32_t) (value >> 31);
+}
+
+int32_t zigzag_decode(uint32_t value) {
+    return (int32_t) (value >> 1) ^ -(int32_t) (value & 1);
+}
@@ -4,3 +4,18 @@
 
 int32_t read_int32_le(const uint8_t *buf, size_t offset);
 void write_int32_le(uint8_t *buf, size_t offset, int32_t value);
+uint64_t read_uint64_le(const uint8_t *buf, size_t offset);
+void write_uint64_le(uint8_t *buf, size_t offset, uint64_t value);
+
+/*
+ * Varints (unsigned LEB128, 7 bits per byte, at most 5 bytes for 32 bits).
+ * Signed values are zigzag-encoded first so that small negative numbers stay short.
+ */
+#define MAX_VARINT_SIZE 5
+
+size_t write_varint(uint8_t *buf, size_t offset, uint32_t value);
+// Reads the varint at *offset without going past @size. Returns 0 and advances *offset, -1 if it is truncated or too long.
+int read_varint(const uint8_t *buf, size_t size, size_t *offset, uint32_t *value);
+
+uint32_t zigzag_encode(int32_t value);
+int32_t zigzag_decode(uint32_t value);
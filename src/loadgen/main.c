@@ -0,0 +1,775 @@
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../common/api.h"
+#include "../common/framing.h"
+#include "../common/model.h"
+#include "../common/rules.h"
+
+#define DEFAULT_CLIENTS 1000
+#define DEFAULT_DURATION_S 10
+#define DEFAULT_RATE 1.0 // lobby actions per second and per idle client
+#define DEFAULT_CONNECT_RATE 500 // new connections per second
+#define REQUEST_TIMEOUT_NS 5000000000LL
+#define WATCH_DURATION_NS 3000000000LL
+#define OUT_BUFFER_SIZE 8192
+#define USERNAME_PREFIX "load"
+
+/*
+ * Load generator: thousands of clients speaking the CallType protocol against a server.
+ * In the lobby, every client picks actions at random following the mix: list the users, challenge another load
+ * client (which accepts if it is free), chat, consult a profile, watch a game or read a page of the ranking.
+ * Games are played to the end with random legal moves. The clients are spread over threads, each with its own epoll
+ * loop.
+ *
+ * Latency of a call: from the request to its answer (LIST_USERS, LIST_ONGOING_GAMES, CONSULT_RANKING, CONNECT ->
+ * CONNECT_CONFIRM, CHALLENGE -> CHALLENGE_REQUEST_ANSWER, CONSULT_USER_PROFILE -> RECEIVE_USER_PROFILE, WATCH_GAME ->
+ * GAME_SNAPSHOT), from an
+ * accepted challenge to CHALLENGE_START, from PLAY_MADE to the YOUR_TURN of the opponent and to each
+ * PLAY_MADE_WATCHER, and from SEND_LOBBY_CHAT to each RECEIVE_LOBBY_CHAT.
+ */
+
+// ---------------------- LATENCY HISTOGRAMS ---------------------- //
+// Log-linear buckets of microseconds: 32 per power of two, about 3% of error
+#define SUB_BUCKET_BITS 5
+#define SUB_BUCKETS (1 << SUB_BUCKET_BITS)
+#define HISTOGRAM_BUCKETS (40 * SUB_BUCKETS)
+
+typedef struct Histogram {
+    uint64_t buckets[HISTOGRAM_BUCKETS];
+    uint64_t count;
+    uint64_t max_us;
+} Histogram;
+
+static int bucketOf(uint64_t us) {
+    if (us < SUB_BUCKETS) return (int) us;
+    int shift = 63 - __builtin_clzll(us) - SUB_BUCKET_BITS;
+    int bucket = (shift + 1) * SUB_BUCKETS + (int) ((us >> shift) - SUB_BUCKETS);
+    return bucket < HISTOGRAM_BUCKETS ? bucket : HISTOGRAM_BUCKETS - 1;
+}
+
+static uint64_t bucketValue(int bucket) {
+    if (bucket < SUB_BUCKETS) return (uint64_t) bucket;
+    int shift = bucket / SUB_BUCKETS - 1;
+    return (uint64_t) (bucket % SUB_BUCKETS + SUB_BUCKETS) << shift;
+}
+
+static void histogramAdd(Histogram *histogram, int64_t ns) {
+    uint64_t us = ns > 0 ? (uint64_t) ns / 1000 : 0;
+    histogram->buckets[bucketOf(us)]++;
+    histogram->count++;
+    if (us > histogram->max_us) histogram->max_us = us;
+}
+
+static uint64_t histogramPercentile(const Histogram *histogram, double percentile) {
+    uint64_t rank = (uint64_t) (percentile / 100.0 * (double) histogram->count);
+    uint64_t seen = 0;
+    for (int b = 0; b < HISTOGRAM_BUCKETS; b++) {
+        seen += histogram->buckets[b];
+        if (seen > rank) return bucketValue(b);
+    }
+    return histogram->max_us;
+}
+
+// ---------------------- CLIENTS ---------------------- //
+typedef enum Action {
+    ACTION_LIST_USERS,
+    ACTION_CHALLENGE,
+    ACTION_CHAT,
+    ACTION_PROFILE,
+    ACTION_WATCH,
+    ACTION_RANKING,
+    NB_ACTIONS
+} Action;
+
+static const char *action_names[NB_ACTIONS] = {"list", "challenge", "chat", "profile", "watch", "ranking"};
+
+typedef enum ClientState {
+    CLIENT_NEW, // connection not opened yet
+    CLIENT_CONNECTING, // waiting for CONNECT_CONFIRM
+    CLIENT_IDLE, // in the lobby
+    CLIENT_WAITING, // for the answer of a lobby request
+    CLIENT_PLAYING,
+    CLIENT_WATCHING,
+    CLIENT_CLOSED
+} ClientState;
+
+typedef struct LoadClient {
+    int index;
+    int fd;
+    int state; // ClientState, read by the other threads to pick a challenge target
+    int user_id; // same
+    uint8_t version;
+    FrameBuffer in;
+    uint8_t out[OUT_BUFFER_SIZE];
+    size_t out_len;
+    int writing; // EPOLLOUT is registered
+    // request waiting for its answer
+    CallType pending_call;
+    int64_t pending_since;
+    int64_t next_action;
+    // game
+    Game game;
+    int me; // 1 or 2, 0 until the first YOUR_TURN
+    int opponent; // index of the opponent, -1 when it is not a load client
+    int64_t last_play_sent; // read by the opponent's thread
+    // watch
+    int watched_game;
+    int watched_players[2]; // load client indexes, -1 for the others
+    int64_t watch_until;
+} LoadClient;
+
+typedef struct Stats {
+    Histogram latencies[NB_CALL_TYPES];
+    uint64_t sent[NB_CALL_TYPES];
+    uint64_t received[NB_CALL_TYPES];
+    uint64_t errors;
+    uint64_t timeouts;
+    uint64_t connect_failures;
+    uint64_t disconnections;
+    uint64_t games_finished;
+} Stats;
+
+typedef struct Config {
+    struct sockaddr_in address;
+    int clients;
+    int threads;
+    int duration_s;
+    double rate;
+    int connect_rate;
+    int think_ms;
+    uint8_t version;
+    int mix[NB_ACTIONS]; // weights
+    int mix_total;
+} Config;
+
+typedef struct Worker {
+    int id;
+    pthread_t thread;
+    int epoll_fd;
+    unsigned int seed;
+    Stats *stats;
+} Worker;
+
+static Config config;
+static LoadClient *clients;
+static int64_t start_ns, end_ns;
+
+static int64_t nowNs(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t) now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+static int loadState(const LoadClient *client) {
+    return __atomic_load_n(&client->state, __ATOMIC_RELAXED);
+}
+
+static void setState(LoadClient *client, ClientState state) {
+    __atomic_store_n(&client->state, (int) state, __ATOMIC_RELAXED);
+}
+
+// Next lobby action, exponentially distributed around the configured rate
+static void scheduleAction(LoadClient *client, Worker *worker, int64_t now) {
+    double u = (rand_r(&worker->seed) + 1.0) / ((double) RAND_MAX + 2.0);
+    double delay_s = config.rate > 0 ? -__builtin_log(u) / config.rate : 1e9;
+    client->next_action = now + (int64_t) (delay_s * 1e9);
+}
+
+static void closeClient(LoadClient *client, Worker *worker) {
+    if (client->fd >= 0) {
+        epoll_ctl(worker->epoll_fd, EPOLL_CTL_DEL, client->fd, NULL);
+        close(client->fd);
+    }
+    client->fd = -1;
+    setState(client, CLIENT_CLOSED);
+}
+
+static void flushOut(LoadClient *client, Worker *worker) {
+    size_t sent = 0;
+    while (sent < client->out_len) {
+        ssize_t n = send(client->fd, client->out + sent, client->out_len - sent, MSG_NOSIGNAL);
+        if (n > 0) {
+            sent += (size_t) n;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        } else {
+            worker->stats->disconnections++;
+            closeClient(client, worker);
+            return;
+        }
+    }
+    memmove(client->out, client->out + sent, client->out_len - sent);
+    client->out_len -= sent;
+    int writing = client->out_len > 0;
+    if (writing != client->writing) {
+        struct epoll_event event = {.events = EPOLLIN | (writing ? EPOLLOUT : 0), .data.ptr = client};
+        epoll_ctl(worker->epoll_fd, EPOLL_CTL_MOD, client->fd, &event);
+        client->writing = writing;
+    }
+}
+
+static void sendCall(LoadClient *client, Worker *worker, CallType type, const Message *message) {
+    if (client->fd < 0) return;
+    uint8_t *frame = client->out + client->out_len;
+    size_t room = OUT_BUFFER_SIZE - client->out_len;
+    int size = room > FRAME_HEADER_SIZE
+               ? encode_Message(type, 1, client->version, message, frame + FRAME_HEADER_SIZE, room - FRAME_HEADER_SIZE)
+               : -1;
+    if (size < 0) {
+        // the server does not read: the client is stuck, as a real one would be
+        worker->stats->errors++;
+        return;
+    }
+    frame_write_header(frame, type, (uint32_t) size);
+    client->out_len += FRAME_HEADER_SIZE + (size_t) size;
+    worker->stats->sent[type]++;
+    flushOut(client, worker);
+}
+
+static void sendRequest(LoadClient *client, Worker *worker, CallType type, const Message *message, int64_t now) {
+    client->pending_call = type;
+    client->pending_since = now;
+    setState(client, CLIENT_WAITING);
+    sendCall(client, worker, type, message);
+}
+
+// The answer to the pending request arrived (or an ERROR about it): back to the lobby
+static void answerReceived(LoadClient *client, Worker *worker, int64_t now) {
+    histogramAdd(&worker->stats->latencies[client->pending_call], now - client->pending_since);
+    setState(client, CLIENT_IDLE);
+    scheduleAction(client, worker, now);
+}
+
+static int openConnection(LoadClient *client, Worker *worker, int64_t now) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (fd < 0) return -1;
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (connect(fd, (struct sockaddr *) &config.address, sizeof(config.address)) < 0 && errno != EINPROGRESS) {
+        close(fd);
+        return -1;
+    }
+    client->fd = fd;
+    client->writing = 0;
+    client->out_len = 0;
+    struct epoll_event event = {.events = EPOLLIN, .data.ptr = client};
+    if (epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0) {
+        close(fd);
+        client->fd = -1;
+        return -1;
+    }
+    // the request is queued until the connection is established
+    Message connect_message;
+    memset(&connect_message, 0, sizeof(connect_message));
+    snprintf(connect_message.username, sizeof(connect_message.username), USERNAME_PREFIX "%d", client->index);
+    connect_message.version = config.version;
+    client->version = PROTOCOL_V1;
+    sendRequest(client, worker, CONNECT, &connect_message, now);
+    setState(client, CLIENT_CONNECTING);
+    return 0;
+}
+
+static int randomLegalMove(const Game *game, int player, unsigned int *seed) {
+    unsigned int legal = legalMoves(game, player);
+    if (!legal) return 0;
+    int skip = rand_r(seed) % __builtin_popcount(legal);
+    while (skip--) legal &= legal - 1;
+    return __builtin_ctz(legal) + 1;
+}
+
+// A random load client in the lobby, other than @client, -1 if none was found
+static int pickIdleClient(const LoadClient *client, Worker *worker) {
+    for (int attempt = 0; attempt < 8; attempt++) {
+        int other = rand_r(&worker->seed) % config.clients;
+        if (other != client->index && loadState(&clients[other]) == CLIENT_IDLE
+            && __atomic_load_n(&clients[other].user_id, __ATOMIC_RELAXED) != 0) {
+            return other;
+        }
+    }
+    return -1;
+}
+
+static Action pickAction(Worker *worker) {
+    int r = rand_r(&worker->seed) % config.mix_total;
+    for (int a = 0; a < NB_ACTIONS; a++) {
+        if (r < config.mix[a]) return (Action) a;
+        r -= config.mix[a];
+    }
+    return ACTION_LIST_USERS;
+}
+
+static void runAction(LoadClient *client, Worker *worker, int64_t now) {
+    Message m;
+    memset(&m, 0, sizeof(m));
+    int other;
+    switch (pickAction(worker)) {
+        case ACTION_LIST_USERS:
+            sendRequest(client, worker, LIST_USERS, &m, now);
+            break;
+        case ACTION_CHALLENGE:
+            if ((other = pickIdleClient(client, worker)) < 0) break;
+            m.ints[0] = __atomic_load_n(&clients[other].user_id, __ATOMIC_RELAXED);
+            sendRequest(client, worker, CHALLENGE, &m, now);
+            break;
+        case ACTION_CHAT:
+            // the receivers measure the delivery from the timestamp
+            snprintf(m.text, MAX_CHAT_MESSAGE_SIZE, "load %lld", (long long) now);
+            sendCall(client, worker, SEND_LOBBY_CHAT, &m);
+            break;
+        case ACTION_PROFILE:
+            if ((other = pickIdleClient(client, worker)) < 0) break;
+            m.ints[0] = __atomic_load_n(&clients[other].user_id, __ATOMIC_RELAXED);
+            sendRequest(client, worker, CONSULT_USER_PROFILE, &m, now);
+            break;
+        case ACTION_WATCH:
+            // the list of the games first, the watch request once it is received
+            sendRequest(client, worker, LIST_ONGOING_GAMES, &m, now);
+            break;
+        case ACTION_RANKING:
+            // a random page among the first ones
+            m.ints[0] = (rand_r(&worker->seed) % 10) * 10;
+            m.ints[1] = 10;
+            sendRequest(client, worker, CONSULT_RANKING, &m, now);
+            break;
+        default:
+            break;
+    }
+    if (loadState(client) == CLIENT_IDLE) scheduleAction(client, worker, now);
+}
+
+static void startGame(LoadClient *client, const Message *m) {
+    Player player1 = newPlayer(0, -1), player2 = newPlayer(0, -1);
+    memset(&client->game, 0, sizeof(client->game));
+    client->game.player1 = player1;
+    client->game.player2 = player2;
+    for (int p = 0; p < 12; p++) client->game.board[p] = 4;
+    client->me = 0;
+    client->opponent = -1;
+    if (strncmp(m->username, USERNAME_PREFIX, strlen(USERNAME_PREFIX)) == 0) {
+        int opponent = atoi(m->username + strlen(USERNAME_PREFIX));
+        if (opponent >= 0 && opponent < config.clients) client->opponent = opponent;
+    }
+    setState(client, CLIENT_PLAYING);
+}
+
+static void playTurn(LoadClient *client, Worker *worker, int opponent_move, int64_t now) {
+    if (client->me == 0) client->me = opponent_move <= 0 ? 1 : 2;
+    if (opponent_move > 0) {
+        playMove(&client->game, 3 - client->me, opponent_move);
+        if (client->opponent >= 0) {
+            int64_t sent = __atomic_load_n(&clients[client->opponent].last_play_sent, __ATOMIC_RELAXED);
+            if (sent) histogramAdd(&worker->stats->latencies[PLAY_MADE], now - sent);
+        }
+    }
+    int move = randomLegalMove(&client->game, client->me, &worker->seed);
+    if (!move) return;
+    if (config.think_ms > 0) usleep((useconds_t) config.think_ms * 1000);
+    playMove(&client->game, client->me, move);
+    Message m;
+    memset(&m, 0, sizeof(m));
+    m.ints[0] = move;
+    __atomic_store_n(&client->last_play_sent, nowNs(), __ATOMIC_RELAXED);
+    sendCall(client, worker, PLAY_MADE, &m);
+}
+
+// Load client logged in as @user_id, -1 if none (or if it is another user, like the bot)
+static int findClientByUserId(int user_id) {
+    for (int c = 0; c < config.clients; c++) {
+        if (__atomic_load_n(&clients[c].user_id, __ATOMIC_RELAXED) == user_id) return c;
+    }
+    return -1;
+}
+
+// Picks one of the games of a LIST_ONGOING_GAMES answer ("Game <id>: <user id> VS <user id> ..." lines) and watches it
+static void watchListedGame(LoadClient *client, Worker *worker, const char *list, int64_t now) {
+    int ids[64][3], count = 0;
+    for (const char *line = strstr(list, "Game "); line && count < 64; line = strstr(line + 1, "Game ")) {
+        if (sscanf(line, "Game %d: %d VS %d", &ids[count][0], &ids[count][1], &ids[count][2]) == 3) count++;
+    }
+    if (count == 0) return;
+    int chosen = rand_r(&worker->seed) % count;
+    Message m;
+    memset(&m, 0, sizeof(m));
+    m.ints[0] = ids[chosen][0];
+    client->watched_game = ids[chosen][0];
+    client->watched_players[0] = findClientByUserId(ids[chosen][1]);
+    client->watched_players[1] = findClientByUserId(ids[chosen][2]);
+    client->watch_until = now + WATCH_DURATION_NS;
+    // measured until the GAME_SNAPSHOT
+    client->pending_call = WATCH_GAME;
+    client->pending_since = now;
+    setState(client, CLIENT_WATCHING);
+    sendCall(client, worker, WATCH_GAME, &m);
+}
+
+// A move was relayed to a watcher: measured from the PLAY_MADE of the player who made it, the most recent one
+static void watchedMoveReceived(LoadClient *client, Worker *worker, int64_t now) {
+    int64_t sent = 0;
+    for (int p = 0; p < 2; p++) {
+        if (client->watched_players[p] < 0) continue;
+        int64_t last = __atomic_load_n(&clients[client->watched_players[p]].last_play_sent, __ATOMIC_RELAXED);
+        if (last > sent) sent = last;
+    }
+    if (sent && now >= sent) histogramAdd(&worker->stats->latencies[PLAY_MADE_WATCHER], now - sent);
+}
+
+static void stopWatching(LoadClient *client, Worker *worker, int64_t now, int notify) {
+    if (notify) {
+        Message m;
+        memset(&m, 0, sizeof(m));
+        m.ints[0] = client->watched_game;
+        sendCall(client, worker, USER_WANTS_TO_EXIT_WATCH, &m);
+    }
+    setState(client, CLIENT_IDLE);
+    scheduleAction(client, worker, now);
+}
+
+static void handleFrame(LoadClient *client, Worker *worker, const Frame *frame, int64_t now) {
+    Stats *stats = worker->stats;
+    uint8_t version = frame->type == CONNECT_CONFIRM ? connect_confirm_version(frame->payload_size) : client->version;
+    Message m;
+    if ((unsigned) frame->type >= NB_CALL_TYPES
+        || decode_Message(frame->type, 0, version, frame->payload, frame->payload_size, &m) < 0) {
+        stats->errors++;
+        return;
+    }
+    stats->received[frame->type]++;
+    int state = loadState(client);
+    Message reply;
+    memset(&reply, 0, sizeof(reply));
+
+    switch (frame->type) {
+        case CONNECT_CONFIRM:
+            client->version = version;
+            __atomic_store_n(&client->user_id, m.user.id, __ATOMIC_RELAXED);
+            answerReceived(client, worker, now);
+            break;
+        case LIST_USERS:
+        case RECEIVE_USER_PROFILE:
+        case CONSULT_RANKING:
+            if (state == CLIENT_WAITING) answerReceived(client, worker, now);
+            break;
+        case LIST_ONGOING_GAMES:
+            if (state == CLIENT_WAITING) {
+                answerReceived(client, worker, now);
+                watchListedGame(client, worker, m.text, now);
+            }
+            break;
+        case ERROR:
+            stats->errors++;
+            if (state == CLIENT_WAITING && m.ints[0] == (int32_t) client->pending_call) answerReceived(client, worker, now);
+            else if (state == CLIENT_WATCHING && m.ints[0] == WATCH_GAME) stopWatching(client, worker, now, 0);
+            break;
+        case CHALLENGE:
+            // accepted when free, as a player in the lobby would do
+            reply.ints[0] = m.ints[0];
+            reply.ints[1] = state == CLIENT_IDLE;
+            sendCall(client, worker, CHALLENGE_REQUEST_ANSWER, &reply);
+            if (reply.ints[1]) {
+                // measured until CHALLENGE_START
+                client->pending_call = CHALLENGE_REQUEST_ANSWER;
+                client->pending_since = now;
+                setState(client, CLIENT_WAITING);
+            }
+            break;
+        case CHALLENGE_REQUEST_ANSWER:
+            if (state == CLIENT_WAITING && client->pending_call == CHALLENGE) answerReceived(client, worker, now);
+            break;
+        case CHALLENGE_START:
+            if (state == CLIENT_WAITING && client->pending_call == CHALLENGE_REQUEST_ANSWER) {
+                histogramAdd(&stats->latencies[CHALLENGE_START], now - client->pending_since);
+            }
+            startGame(client, &m);
+            break;
+        case YOUR_TURN:
+            if (state == CLIENT_PLAYING) playTurn(client, worker, m.ints[0], now);
+            break;
+        case GAME_OVER:
+            if (state == CLIENT_PLAYING) {
+                stats->games_finished++;
+                setState(client, CLIENT_IDLE);
+                scheduleAction(client, worker, now);
+            }
+            break;
+        case RECEIVE_LOBBY_CHAT: {
+            long long sent;
+            if (sscanf(m.text, "load %lld", &sent) == 1) histogramAdd(&stats->latencies[SEND_LOBBY_CHAT], now - sent);
+            break;
+        }
+        case GAME_SNAPSHOT:
+            if (state == CLIENT_WATCHING && client->pending_call == WATCH_GAME && client->pending_since) {
+                histogramAdd(&stats->latencies[WATCH_GAME], now - client->pending_since);
+                client->pending_since = 0;
+            }
+            break;
+        case PLAY_MADE_WATCHER:
+            if (state == CLIENT_WATCHING) watchedMoveReceived(client, worker, now);
+            break;
+        case GAME_OVER_WATCHER:
+            if (state == CLIENT_WATCHING) stopWatching(client, worker, now, 0);
+            break;
+        default:
+            break;
+    }
+}
+
+static void readClient(LoadClient *client, Worker *worker, int64_t now) {
+    ssize_t n = frame_buffer_fill(&client->in, client->fd, MSG_DONTWAIT);
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+        worker->stats->disconnections++;
+        closeClient(client, worker);
+        return;
+    }
+    Frame frame;
+    int ret;
+    while (client->fd >= 0 && (ret = frame_buffer_next(&client->in, &frame)) == 1) {
+        handleFrame(client, worker, &frame, now);
+    }
+    if (client->fd >= 0 && ret < 0) {
+        worker->stats->errors++;
+        closeClient(client, worker);
+    }
+}
+
+// Lobby actions, timeouts and watch ends that are due
+static void runTimers(Worker *worker, int64_t now) {
+    for (int i = worker->id; i < config.clients; i += config.threads) {
+        LoadClient *client = &clients[i];
+        int state = loadState(client);
+        if (state == CLIENT_IDLE && now >= client->next_action) {
+            runAction(client, worker, now);
+        } else if ((state == CLIENT_WAITING || state == CLIENT_CONNECTING) && now - client->pending_since > REQUEST_TIMEOUT_NS) {
+            worker->stats->timeouts++;
+            if (state == CLIENT_CONNECTING) {
+                closeClient(client, worker);
+            } else {
+                setState(client, CLIENT_IDLE);
+                scheduleAction(client, worker, now);
+            }
+        } else if (state == CLIENT_WATCHING && now >= client->watch_until) {
+            stopWatching(client, worker, now, 1);
+        }
+    }
+}
+
+static void *runWorker(void *arg) {
+    Worker *worker = arg;
+    struct epoll_event events[256];
+    int next_connect = worker->id;
+    // each worker opens its share of the connections at its share of the rate
+    double connect_interval_ns = 1e9 * config.threads / (config.connect_rate > 0 ? config.connect_rate : 1);
+    int64_t next_connect_at = start_ns;
+    int64_t next_timers = start_ns;
+    while (1) {
+        int64_t now = nowNs();
+        if (now >= end_ns) break;
+        while (next_connect < config.clients && now >= next_connect_at) {
+            if (openConnection(&clients[next_connect], worker, now) < 0) {
+                worker->stats->connect_failures++;
+                setState(&clients[next_connect], CLIENT_CLOSED);
+            }
+            next_connect += config.threads;
+            next_connect_at += (int64_t) connect_interval_ns;
+        }
+        if (now >= next_timers) {
+            runTimers(worker, now);
+            next_timers = now + 1000000;
+        }
+        int n = epoll_wait(worker->epoll_fd, events, 256, 1);
+        now = nowNs();
+        for (int e = 0; e < n; e++) {
+            LoadClient *client = events[e].data.ptr;
+            if (client->fd < 0) continue;
+            if (events[e].events & EPOLLOUT) flushOut(client, worker);
+            if (client->fd >= 0 && (events[e].events & (EPOLLIN | EPOLLERR | EPOLLHUP))) readClient(client, worker, now);
+        }
+    }
+    for (int i = worker->id; i < config.clients; i += config.threads) {
+        closeClient(&clients[i], worker);
+        frame_buffer_free(&clients[i].in);
+    }
+    return NULL;
+}
+
+// ---------------------- MAIN ---------------------- //
+static int parseMix(const char *text) {
+    memset(config.mix, 0, sizeof(config.mix));
+    char copy[256];
+    snprintf(copy, sizeof(copy), "%s", text);
+    for (char *item = strtok(copy, ","); item; item = strtok(NULL, ",")) {
+        char *equal = strchr(item, '=');
+        if (!equal) return -1;
+        *equal = '\0';
+        int a = 0;
+        while (a < NB_ACTIONS && strcmp(action_names[a], item) != 0) a++;
+        if (a == NB_ACTIONS) return -1;
+        config.mix[a] = atoi(equal + 1);
+    }
+    return 0;
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "Usage: %s [--host IP] [--port PORT] [--clients N] [--threads N] [--duration S] [--rate R]\n"
+                    "          [--connect-rate N] [--think MS] [--v1] [--mix list=W,challenge=W,chat=W,profile=W,watch=W,ranking=W]\n",
+            name);
+}
+
+int main(int argc, char **argv) {
+    const char *host = "127.0.0.1";
+    int port = 8080;
+    config.clients = DEFAULT_CLIENTS;
+    config.threads = 0;
+    config.duration_s = DEFAULT_DURATION_S;
+    config.rate = DEFAULT_RATE;
+    config.connect_rate = DEFAULT_CONNECT_RATE;
+    config.version = PROTOCOL_VERSION;
+    parseMix("list=25,challenge=30,chat=5,profile=15,watch=15,ranking=10");
+    for (int a = 1; a < argc; a++) {
+        if (strcmp(argv[a], "--host") == 0 && a + 1 < argc) {
+            host = argv[++a];
+        } else if (strcmp(argv[a], "--port") == 0 && a + 1 < argc) {
+            port = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "--clients") == 0 && a + 1 < argc) {
+            config.clients = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "--threads") == 0 && a + 1 < argc) {
+            config.threads = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "--duration") == 0 && a + 1 < argc) {
+            config.duration_s = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "--rate") == 0 && a + 1 < argc) {
+            config.rate = atof(argv[++a]);
+        } else if (strcmp(argv[a], "--connect-rate") == 0 && a + 1 < argc) {
+            config.connect_rate = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "--think") == 0 && a + 1 < argc) {
+            config.think_ms = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "--v1") == 0) {
+            config.version = PROTOCOL_V1;
+        } else if (strcmp(argv[a], "--mix") == 0 && a + 1 < argc) {
+            if (parseMix(argv[++a]) < 0) {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        } else {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    config.mix_total = 0;
+    for (int a = 0; a < NB_ACTIONS; a++) config.mix_total += config.mix[a] > 0 ? config.mix[a] : 0;
+    if (config.clients < 1 || config.mix_total <= 0) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (config.threads <= 0) config.threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    if (config.threads < 1) config.threads = 1;
+    config.address.sin_family = AF_INET;
+    config.address.sin_port = htons(port);
+    if (inet_pton(AF_INET, host, &config.address.sin_addr) <= 0) {
+        fprintf(stderr, "Invalid address %s\n", host);
+        return EXIT_FAILURE;
+    }
+
+    // one descriptor per client
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < (rlim_t) config.clients + 64) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    clients = calloc(config.clients, sizeof(LoadClient));
+    Worker *workers = calloc(config.threads, sizeof(Worker));
+    if (!clients || !workers) {
+        perror("calloc");
+        return EXIT_FAILURE;
+    }
+    for (int i = 0; i < config.clients; i++) {
+        clients[i].index = i;
+        clients[i].fd = -1;
+        clients[i].opponent = -1;
+        clients[i].watched_players[0] = clients[i].watched_players[1] = -1;
+        frame_buffer_init(&clients[i].in);
+    }
+    printf("%d clients on %d threads against %s:%d for %d s, %.2f actions/s per client\n", config.clients,
+           config.threads, host, port, config.duration_s, config.rate);
+
+    start_ns = nowNs();
+    end_ns = start_ns + (int64_t) config.duration_s * 1000000000LL;
+    int started = 0;
+    for (int t = 0; t < config.threads; t++) {
+        workers[t].id = t;
+        workers[t].seed = (unsigned int) (start_ns ^ (t * 2654435761U));
+        workers[t].stats = calloc(1, sizeof(Stats));
+        workers[t].epoll_fd = epoll_create1(0);
+        if (!workers[t].stats || workers[t].epoll_fd < 0) {
+            perror("worker");
+            return EXIT_FAILURE;
+        }
+        if (pthread_create(&workers[t].thread, NULL, runWorker, &workers[t]) != 0) break;
+        started++;
+    }
+    config.threads = started;
+    for (int t = 0; t < started; t++) pthread_join(workers[t].thread, NULL);
+    double seconds = (double) (nowNs() - start_ns) / 1e9;
+
+    Stats *total = calloc(1, sizeof(Stats));
+    if (!total) return EXIT_FAILURE;
+    for (int t = 0; t < started; t++) {
+        Stats *s = workers[t].stats;
+        for (int c = 0; c < NB_CALL_TYPES; c++) {
+            total->sent[c] += s->sent[c];
+            total->received[c] += s->received[c];
+            for (int b = 0; b < HISTOGRAM_BUCKETS; b++) total->latencies[c].buckets[b] += s->latencies[c].buckets[b];
+            total->latencies[c].count += s->latencies[c].count;
+            if (s->latencies[c].max_us > total->latencies[c].max_us) total->latencies[c].max_us = s->latencies[c].max_us;
+        }
+        total->errors += s->errors;
+        total->timeouts += s->timeouts;
+        total->connect_failures += s->connect_failures;
+        total->disconnections += s->disconnections;
+        total->games_finished += s->games_finished;
+        close(workers[t].epoll_fd);
+        free(s);
+    }
+
+    uint64_t sent = 0, received = 0;
+    for (int c = 0; c < NB_CALL_TYPES; c++) {
+        sent += total->sent[c];
+        received += total->received[c];
+    }
+    printf("%.1f s: %llu frames sent (%.0f/s), %llu received (%.0f/s), %llu games finished (%.1f/s)\n", seconds,
+           (unsigned long long) sent, sent / seconds, (unsigned long long) received, received / seconds,
+           (unsigned long long) total->games_finished, total->games_finished / seconds);
+    printf("errors %llu, timeouts %llu, connection failures %llu, disconnections %llu\n",
+           (unsigned long long) total->errors, (unsigned long long) total->timeouts,
+           (unsigned long long) total->connect_failures, (unsigned long long) total->disconnections);
+    printf("%-24s %10s %10s %10s %10s %10s %10s\n", "call (latency in us)", "sent", "measured", "p50", "p99", "p999",
+           "max");
+    for (int c = 0; c < NB_CALL_TYPES; c++) {
+        const Histogram *h = &total->latencies[c];
+        if (!total->sent[c] && !h->count) continue;
+        printf("%-24s %10llu %10llu", describe_CallType((CallType) c)->name, (unsigned long long) total->sent[c],
+               (unsigned long long) h->count);
+        if (h->count) {
+            printf(" %10llu %10llu %10llu %10llu", (unsigned long long) histogramPercentile(h, 50),
+                   (unsigned long long) histogramPercentile(h, 99), (unsigned long long) histogramPercentile(h, 99.9),
+                   (unsigned long long) h->max_us);
+        }
+        printf("\n");
+    }
+    free(total);
+    free(workers);
+    free(clients);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,162 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../common/game_record.h"
+#include "../common/model.h"
+
+#define DEFAULT_LOG "games.log"
+
+/*
+ * Reads the game log written by the server (--data-dir): lists the games, or replays one of them move by move, or up
+ * to --ply moves, from the moves logged as they were played.
+ */
+
+static const char *resultName(const GameRecord *record) {
+    if (!record->finished) return "interrupted";
+    if (record->winner == 0) return "draw";
+    if (record->abandoned) return record->winner == 1 ? "player 2 left" : "player 1 left";
+    return record->winner == 1 ? "player 1 won" : "player 2 won";
+}
+
+static uint8_t *readLog(const char *path, size_t *size) {
+    FILE *file = fopen(path, "rb");
+    if (!file) return NULL;
+    uint8_t *data = NULL;
+    if (fseek(file, 0, SEEK_END) == 0) {
+        long length = ftell(file);
+        rewind(file);
+        data = length >= 0 ? malloc((size_t) length + 1) : NULL;
+        if (data) *size = fread(data, 1, (size_t) length, file);
+    }
+    fclose(file);
+    return data;
+}
+
+static void printRecord(const GameRecord *record) {
+    char date[32];
+    time_t start = (time_t) record->start_time;
+    strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", localtime(&start));
+    printf("#%u  %s  joueur %d vs joueur %d  %s  %u coups  %us\n", record->id, date, record->player1_id,
+           record->player2_id, resultName(record), record->plies, record->duration);
+}
+
+static int replay(const GameRecord *record, int ply) {
+    printRecord(record);
+    Game game;
+    if (ply >= 0) {
+        if (replayGameRecord(record, ply, &game) < 0) {
+            fprintf(stderr, "Game %u: illegal move in the record\n", record->id);
+            return -1;
+        }
+        printf("Position after %u moves (scores %d - %d):\n", (uint32_t) ply > record->plies ? record->plies : (uint32_t) ply,
+               game.player1.score, game.player2.score);
+        printBoard(game.board, 1);
+        return 0;
+    }
+    for (int p = 1; (uint32_t) p <= record->plies; p++) {
+        if (replayGameRecord(record, p, &game) < 0) {
+            fprintf(stderr, "Game %u: illegal move %d at ply %d\n", record->id, record->moves[p - 1], p);
+            return -1;
+        }
+        printf("%d. joueur %d joue %d (scores %d - %d)\n", p, 2 - p % 2, record->moves[p - 1],
+               game.player1.score, game.player2.score);
+        printBoard(game.board, 1);
+    }
+    return 0;
+}
+
+// Game @id among the @count games of @games, sorted by id since the ids are given in the order the games start
+static GameRecord *findGame(GameRecord *games, size_t count, uint32_t id) {
+    size_t low = 0, high = count;
+    while (low < high) {
+        size_t middle = (low + high) / 2;
+        if (games[middle].id == id) return &games[middle];
+        if (games[middle].id < id) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return NULL;
+}
+
+int main(int argc, char **argv) {
+    const char *path = DEFAULT_LOG;
+    long game_id = -1;
+    int ply = -1;
+    for (int a = 1; a < argc; a++) {
+        if (strcmp(argv[a], "--log") == 0 && a + 1 < argc) {
+            path = argv[++a];
+        } else if (strcmp(argv[a], "--game") == 0 && a + 1 < argc) {
+            game_id = atol(argv[++a]);
+        } else if (strcmp(argv[a], "--ply") == 0 && a + 1 < argc) {
+            ply = atoi(argv[++a]);
+        } else {
+            fprintf(stderr, "Usage: %s [--log FILE] [--game ID] [--ply N]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    size_t size = 0;
+    uint8_t *data = readLog(path, &size);
+    if (!data) {
+        perror(path);
+        return EXIT_FAILURE;
+    }
+    if (checkGameLogHeader(data, size) < 0) {
+        fprintf(stderr, "%s is not a game log\n", path);
+        free(data);
+        return EXIT_FAILURE;
+    }
+
+    // the entries of the games played at the same time are interleaved, every game is rebuilt first
+    int status = EXIT_SUCCESS;
+    GameRecord *games = NULL;
+    size_t count = 0, capacity = 0;
+    size_t pos = GAME_LOG_HEADER_SIZE;
+    while (pos < size && status == EXIT_SUCCESS) {
+        GameLogEntry entry;
+        long n = decodeGameLogEntry(data + pos, size - pos, &entry);
+        if (n < 0) {
+            fprintf(stderr, "Entry at offset %zu unreadable, the end of the log is ignored\n", pos);
+            break;
+        }
+        pos += (size_t) n;
+        GameRecord *record = findGame(games, count, entry.game_id);
+        if (entry.kind == GAME_LOG_START && !record) {
+            if (count == capacity) {
+                capacity = capacity ? capacity * 2 : 256;
+                GameRecord *grown = realloc(games, capacity * sizeof(GameRecord));
+                if (!grown) {
+                    status = EXIT_FAILURE;
+                    break;
+                }
+                games = grown;
+            }
+            record = &games[count++];
+            memset(record, 0, sizeof(GameRecord));
+        }
+        if (record && applyGameLogEntry(record, &entry) < 0) status = EXIT_FAILURE;
+    }
+    if (status != EXIT_SUCCESS) {
+        fprintf(stderr, "Out of memory\n");
+    } else if (game_id < 0) {
+        for (size_t g = 0; g < count; g++) printRecord(&games[g]);
+        printf("%zu games\n", count);
+    } else {
+        GameRecord *record = findGame(games, count, (uint32_t) game_id);
+        if (record) {
+            status = replay(record, ply) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+        } else {
+            fprintf(stderr, "No game %ld in %s\n", game_id, path);
+            status = EXIT_FAILURE;
+        }
+    }
+    for (size_t g = 0; g < count; g++) freeGameRecord(&games[g]);
+    free(games);
+    free(data);
+    return status;
+}
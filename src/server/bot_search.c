@@ -0,0 +1,123 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "../common/rules.h"
+#include "bot_search.h"
+
+typedef struct QueuedJob {
+    BotSearchJob job;
+    struct QueuedJob *next;
+} QueuedJob;
+
+static BotMoveFound move_found = NULL;
+static size_t table_entries = 0;
+static pthread_mutex_t search_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t search_cond = PTHREAD_COND_INITIALIZER;
+static QueuedJob *head = NULL;
+static QueuedJob *tail = NULL;
+static pthread_t *threads = NULL;
+static int nb_of_threads = 0;
+static int stopping = 0;
+
+static int search_move(AiSearch *search, const BotSearchJob *job) {
+    int player = (job->tours % 2 == 0) ? 1 : 2;
+    int move = -1;
+    if (search) {
+        AiPosition position = aiPositionOfGame(&job->game, job->tours);
+        AiResult result = aiBestMove(search, &position, &job->limits);
+        move = result.move;
+        printf("Game %d: bot plays %d (depth %d, value %d, %ld nodes)\n", job->game_id, result.move, result.depth,
+               result.value, result.nodes);
+    }
+    if (!isLegalMove(&job->game, player, move)) {
+        // without its tables, or after a wrong answer of the search, the bot still plays: its first legal move
+        unsigned int legal = legalMoves(&job->game, player);
+        move = legal ? __builtin_ctz(legal) + 1 : -1;
+        fprintf(stderr, "Game %d: no move from the bot search, it plays %d\n", job->game_id, move);
+    }
+    return move;
+}
+
+static void *search_loop(void *arg) {
+    (void) arg;
+    // one table per thread, kept from a move to the next
+    AiSearch *search = aiCreate(table_entries);
+    if (!search) fprintf(stderr, "Could not allocate the bot search tables\n");
+    while (1) {
+        pthread_mutex_lock(&search_mutex);
+        while (head == NULL && !stopping) {
+            pthread_cond_wait(&search_cond, &search_mutex);
+        }
+        if (head == NULL) {
+            pthread_mutex_unlock(&search_mutex);
+            break;
+        }
+        QueuedJob *queued = head;
+        head = queued->next;
+        if (!head) tail = NULL;
+        pthread_mutex_unlock(&search_mutex);
+
+        move_found(&queued->job, search_move(search, &queued->job));
+        free(queued);
+    }
+    aiDestroy(search);
+    return NULL;
+}
+
+int bot_search_init(int nb_threads, size_t tt_entries, BotMoveFound found) {
+    move_found = found;
+    table_entries = tt_entries;
+    if (nb_threads <= 0) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        nb_threads = cores > 0 ? (int) cores : 1;
+    }
+    threads = calloc(nb_threads, sizeof(pthread_t));
+    if (!threads) return -1;
+    for (int t = 0; t < nb_threads; t++) {
+        if (pthread_create(&threads[t], NULL, search_loop, NULL) != 0) {
+            perror("pthread_create bot search");
+            return -1;
+        }
+        nb_of_threads++;
+    }
+    printf("Bot search started with %d threads\n", nb_threads);
+    return 0;
+}
+
+int bot_search_post(const BotSearchJob *job) {
+    QueuedJob *queued = malloc(sizeof(QueuedJob));
+    if (!queued) return -1;
+    queued->job = *job;
+    queued->next = NULL;
+
+    pthread_mutex_lock(&search_mutex);
+    if (stopping) {
+        pthread_mutex_unlock(&search_mutex);
+        free(queued);
+        return -1;
+    }
+    if (tail) {
+        tail->next = queued;
+    } else {
+        head = queued;
+    }
+    tail = queued;
+    pthread_cond_signal(&search_cond);
+    pthread_mutex_unlock(&search_mutex);
+    return 0;
+}
+
+void bot_search_stop(void) {
+    pthread_mutex_lock(&search_mutex);
+    stopping = 1;
+    pthread_cond_broadcast(&search_cond);
+    pthread_mutex_unlock(&search_mutex);
+    for (int t = 0; t < nb_of_threads; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    free(threads);
+    threads = NULL;
+    nb_of_threads = 0;
+}
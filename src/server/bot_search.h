@@ -0,0 +1,32 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "../common/ai.h"
+#include "../common/model.h"
+
+/*
+ * Searches of the bot, run on their own threads so that a game worker never waits for them.
+ * The worker hands over a copy of the position and goes on with the events of its other games; the move found is
+ * handed to the callback, which posts it back to the game as a PLAY_MADE of the bot.
+ * Any search thread takes the next job: a game waits for its bot move, so it never has two searches queued.
+ */
+
+typedef struct BotSearchJob {
+    int game_id;
+    int32_t bot; // handle of the client slot of the bot, the move comes from it
+    Game game; // position to play in, copied: the game itself stays with its worker
+    int tours; // moves played, as the server counts them
+    AiLimits limits;
+} BotSearchJob;
+
+// Called on a search thread with the move found, always legal in the position of @job
+typedef void (*BotMoveFound)(const BotSearchJob *job, int move);
+
+// Start @nb_threads search threads (one per online core if @nb_threads <= 0), each with a table of @tt_entries
+int bot_search_init(int nb_threads, size_t tt_entries, BotMoveFound found);
+
+// Queue a search, @job is copied. Returns -1 if out of memory or stopped. The side to move must have a legal move.
+int bot_search_post(const BotSearchJob *job);
+
+// Let the threads run the searches already queued, handing their moves to the callback, then stop them and wait for them
+void bot_search_stop(void);
@@ -0,0 +1,104 @@
+#include <stdlib.h>
+#include "client_index.h"
+
+#define USER_INDEX_MIN_CAPACITY 16
+
+// Fibonacci hashing: spreads consecutive and random ids alike over the buckets
+static size_t bucket_of(const UserIndex *index, int32_t user_id) {
+    return (size_t) (((uint32_t) user_id * 2654435769u) & (index->capacity - 1));
+}
+
+static int allocate(UserIndex *index, size_t capacity) {
+    index->keys = calloc(capacity, sizeof(int32_t));
+    index->slots = malloc(capacity * sizeof(int));
+    if (!index->keys || !index->slots) {
+        free(index->keys);
+        free(index->slots);
+        return -1;
+    }
+    index->capacity = capacity;
+    index->count = 0;
+    return 0;
+}
+
+int user_index_init(UserIndex *index, size_t expected) {
+    size_t capacity = USER_INDEX_MIN_CAPACITY;
+    while (capacity < expected * 2) capacity *= 2;
+    return allocate(index, capacity);
+}
+
+void user_index_free(UserIndex *index) {
+    free(index->keys);
+    free(index->slots);
+    index->keys = NULL;
+    index->slots = NULL;
+    index->capacity = 0;
+    index->count = 0;
+}
+
+static void insert(UserIndex *index, int32_t user_id, int slot) {
+    size_t b = bucket_of(index, user_id);
+    while (index->keys[b] != 0 && index->keys[b] != user_id) {
+        b = (b + 1) & (index->capacity - 1);
+    }
+    if (index->keys[b] == 0) index->count++;
+    index->keys[b] = user_id;
+    index->slots[b] = slot;
+}
+
+static int grow(UserIndex *index) {
+    UserIndex old = *index;
+    if (allocate(index, old.capacity * 2) < 0) {
+        *index = old;
+        return -1;
+    }
+    for (size_t b = 0; b < old.capacity; b++) {
+        if (old.keys[b] != 0) insert(index, old.keys[b], old.slots[b]);
+    }
+    free(old.keys);
+    free(old.slots);
+    return 0;
+}
+
+int user_index_put(UserIndex *index, int32_t user_id, int slot) {
+    if ((index->count + 1) * 2 > index->capacity && grow(index) < 0) return -1;
+    insert(index, user_id, slot);
+    return 0;
+}
+
+int user_index_get(const UserIndex *index, int32_t user_id) {
+    if (user_id == 0) return -1;
+    size_t b = bucket_of(index, user_id);
+    while (index->keys[b] != 0) {
+        if (index->keys[b] == user_id) return index->slots[b];
+        b = (b + 1) & (index->capacity - 1);
+    }
+    return -1;
+}
+
+void user_index_remove(UserIndex *index, int32_t user_id, int slot) {
+    if (user_id == 0) return;
+    size_t mask = index->capacity - 1;
+    size_t b = bucket_of(index, user_id);
+    while (index->keys[b] != user_id) {
+        if (index->keys[b] == 0) return;
+        b = (b + 1) & mask;
+    }
+    if (index->slots[b] != slot) return;
+
+    // backward shift deletion: move up the following entries that would not be found anymore, no tombstones needed
+    size_t hole = b;
+    size_t next = (hole + 1) & mask;
+    while (index->keys[next] != 0) {
+        size_t home = bucket_of(index, index->keys[next]);
+        // the entry can fill the hole if its home bucket is not in (hole, next]
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            index->keys[hole] = index->keys[next];
+            index->slots[hole] = index->slots[next];
+            hole = next;
+        }
+        next = (next + 1) & mask;
+    }
+    index->keys[hole] = 0;
+    index->count--;
+}
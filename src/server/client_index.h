@@ -0,0 +1,28 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * O(1) lookup of the connection slot of a client: open-addressing hash map (linear probing) from user_id to slot,
+ * kept at most half full. Not thread-safe: the server protects it with a rwlock.
+ */
+
+typedef struct UserIndex {
+    int32_t *keys; // 0 marks an empty bucket (user ids are never 0)
+    int *slots;
+    size_t capacity; // power of two
+    size_t count;
+} UserIndex;
+
+int user_index_init(UserIndex *index, size_t expected);
+
+void user_index_free(UserIndex *index);
+
+// Map @user_id to @slot, replacing any previous mapping. Returns -1 if the table could not grow.
+int user_index_put(UserIndex *index, int32_t user_id, int slot);
+
+// Returns the slot of @user_id, -1 if it is unknown
+int user_index_get(const UserIndex *index, int32_t user_id);
+
+// Remove @user_id if it is mapped to @slot
+void user_index_remove(UserIndex *index, int32_t user_id, int slot);
@@ -0,0 +1,101 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "fanout.h"
+
+typedef struct FanoutJob {
+    OutFrame *frames[FANOUT_VERSIONS];
+    struct FanoutJob *next;
+    int count;
+    int32_t handles[];
+} FanoutJob;
+
+static FanoutDeliver deliver_frame = NULL;
+static pthread_t fanout_thread;
+static pthread_mutex_t fanout_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t fanout_cond = PTHREAD_COND_INITIALIZER;
+static FanoutJob *head = NULL;
+static FanoutJob *tail = NULL;
+static int stopping = 0;
+
+static void release_frames(OutFrame *const *frames) {
+    for (int v = 0; v < FANOUT_VERSIONS; v++) {
+        out_frame_release(frames[v]);
+    }
+}
+
+static void *fanout_loop(void *arg) {
+    (void) arg;
+    while (1) {
+        pthread_mutex_lock(&fanout_mutex);
+        while (head == NULL && !stopping) {
+            pthread_cond_wait(&fanout_cond, &fanout_mutex);
+        }
+        if (head == NULL) {
+            pthread_mutex_unlock(&fanout_mutex);
+            break;
+        }
+        // take the whole queue at once to lock only once per batch
+        FanoutJob *job = head;
+        head = tail = NULL;
+        pthread_mutex_unlock(&fanout_mutex);
+
+        while (job) {
+            FanoutJob *next = job->next;
+            for (int k = 0; k < job->count; k++) {
+                deliver_frame(job->handles[k], job->frames);
+            }
+            release_frames(job->frames);
+            free(job);
+            job = next;
+        }
+    }
+    return NULL;
+}
+
+int fanout_init(FanoutDeliver deliver) {
+    deliver_frame = deliver;
+    if (pthread_create(&fanout_thread, NULL, fanout_loop, NULL) != 0) {
+        perror("pthread_create fanout");
+        return -1;
+    }
+    return 0;
+}
+
+void fanout_post(OutFrame *frames[FANOUT_VERSIONS], const int32_t *handles, int count) {
+    FanoutJob *job = malloc(sizeof(FanoutJob) + (size_t) count * sizeof(int32_t));
+    if (!job) {
+        release_frames(frames);
+        return;
+    }
+    memcpy(job->frames, frames, sizeof(job->frames));
+    memcpy(job->handles, handles, (size_t) count * sizeof(int32_t));
+    job->count = count;
+    job->next = NULL;
+
+    pthread_mutex_lock(&fanout_mutex);
+    if (stopping) {
+        pthread_mutex_unlock(&fanout_mutex);
+        release_frames(job->frames);
+        free(job);
+        return;
+    }
+    if (tail) {
+        tail->next = job;
+    } else {
+        head = job;
+    }
+    tail = job;
+    pthread_cond_signal(&fanout_cond);
+    pthread_mutex_unlock(&fanout_mutex);
+}
+
+void fanout_stop(void) {
+    pthread_mutex_lock(&fanout_mutex);
+    stopping = 1;
+    pthread_cond_signal(&fanout_cond);
+    pthread_mutex_unlock(&fanout_mutex);
+    pthread_join(fanout_thread, NULL);
+}
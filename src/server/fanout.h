@@ -0,0 +1,26 @@
+#pragma once
+#include "outbound.h"
+
+/*
+ * Spectator fan-out.
+ * A game worker encodes a message for the watchers of its game once per protocol version, then hands the frames and
+ * a copy of the watcher list over to the fan-out thread, which queues a reference to the right frame on the outbound
+ * queue of every watcher. The players' next turn never waits for the spectators, and a slow spectator only fills its
+ * own queue (it is disconnected past its high-water mark like any client).
+ * Jobs run in the order they were posted, so every watcher receives the messages of a game in order.
+ */
+
+#define FANOUT_VERSIONS 2 // one frame per protocol version, PROTOCOL_V1 first
+
+// Queue the frame of @frames matching the protocol version of the client @handle (slab handle, possibly stale by now),
+// taking a reference to it
+typedef void (*FanoutDeliver)(int32_t handle, OutFrame *const *frames);
+
+// Start the fan-out thread. Returns 0 on success.
+int fanout_init(FanoutDeliver deliver);
+
+// Deliver @frames to the @count clients of @handles (copied). The fan-out takes over the caller's references to the frames.
+void fanout_post(OutFrame *frames[FANOUT_VERSIONS], const int32_t *handles, int count);
+
+// Deliver the jobs already posted, then stop the fan-out thread and wait for it. Later jobs are dropped.
+void fanout_stop(void);
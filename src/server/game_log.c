@@ -0,0 +1,298 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "game_log.h"
+
+#define GAME_LOG_FILE "games.log"
+
+static int write_all(int fd, const uint8_t *data, size_t size) {
+    while (size > 0) {
+        ssize_t n = write(fd, data, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        data += n;
+        size -= (size_t) n;
+    }
+    return 0;
+}
+
+// Whole content of @path, NULL with errno ENOENT when it does not exist
+static uint8_t *read_file(const char *path, size_t *size) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat st;
+    uint8_t *data = NULL;
+    if (fstat(fd, &st) == 0 && (data = malloc(st.st_size ? (size_t) st.st_size : 1))) {
+        size_t done = 0;
+        while (done < (size_t) st.st_size) {
+            ssize_t n = read(fd, data + done, (size_t) st.st_size - done);
+            if (n <= 0) break;
+            done += (size_t) n;
+        }
+        *size = done;
+    }
+    close(fd);
+    return data;
+}
+
+// Find the next game id in the existing log and cut off a torn entry, or create the log
+static int load(GameLog *log, const char *path) {
+    size_t size = 0;
+    uint8_t *data = read_file(path, &size);
+    if (!data) {
+        if (errno != ENOENT) {
+            perror(path);
+            return -1;
+        }
+        log->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+        uint8_t header[GAME_LOG_HEADER_SIZE];
+        writeGameLogHeader(header);
+        if (log->fd < 0 || write_all(log->fd, header, sizeof(header)) < 0 || fsync(log->fd) < 0) {
+            perror(path);
+            return -1;
+        }
+        log->log_bytes = GAME_LOG_HEADER_SIZE;
+        return 0;
+    }
+    if (checkGameLogHeader(data, size) < 0) {
+        fprintf(stderr, "Game log: %s is not a game log\n", path);
+        free(data);
+        return -1;
+    }
+    size_t pos = GAME_LOG_HEADER_SIZE;
+    while (pos < size) {
+        GameLogEntry entry;
+        long n = decodeGameLogEntry(data + pos, size - pos, &entry);
+        if (n < 0) {
+            fprintf(stderr, "Game log: entry at offset %zu unreadable, the end of the log is dropped\n", pos);
+            break;
+        }
+        if (entry.game_id >= log->next_id) log->next_id = entry.game_id + 1;
+        if (entry.kind == GAME_LOG_START) log->count++;
+        pos += (size_t) n;
+    }
+    free(data);
+    log->log_bytes = pos;
+    log->fd = open(path, O_WRONLY | O_APPEND);
+    if (log->fd < 0 || (pos < size && ftruncate(log->fd, (off_t) pos) < 0)) {
+        perror(path);
+        return -1;
+    }
+    return 0;
+}
+
+// Write and sync @entries after the first @log_bytes of the log; on failure what was written of them is cut off
+static int commit_entries(int fd, size_t log_bytes, const uint8_t *entries, size_t size) {
+    if (write_all(fd, entries, size) == 0 && fdatasync(fd) == 0) return 0;
+    perror("Game log: " GAME_LOG_FILE);
+    if (ftruncate(fd, (off_t) log_bytes) < 0) perror("Game log: " GAME_LOG_FILE);
+    return -1;
+}
+
+// Put the entries of a failed pass back in front of the ones queued since. Called with the mutex held.
+static void requeue_entries(GameLog *log, const uint8_t *entries, size_t size) {
+    if (log->pending_len + size > log->pending_capacity) {
+        size_t capacity = log->pending_len + size + 1024 * GAME_LOG_ENTRY_MAX_SIZE;
+        uint8_t *pending = realloc(log->pending, capacity);
+        if (!pending) {
+            fprintf(stderr, "Game log: %zu bytes of entries lost, out of memory\n", size);
+            return;
+        }
+        log->pending = pending;
+        log->pending_capacity = capacity;
+    }
+    memmove(log->pending + size, log->pending, log->pending_len);
+    memcpy(log->pending, entries, size);
+    log->pending_len += size;
+}
+
+// Encode @entry at the end of the pending records. Called with the mutex held, returns -1 if out of memory.
+static int queue_entry(GameLog *log, const GameLogEntry *entry) {
+    if (log->pending_len + GAME_LOG_ENTRY_MAX_SIZE > log->pending_capacity) {
+        size_t capacity = log->pending_capacity ? log->pending_capacity * 2 : 1024 * GAME_LOG_ENTRY_MAX_SIZE;
+        uint8_t *pending = realloc(log->pending, capacity);
+        if (!pending) {
+            fprintf(stderr, "Game log: entry of game %u not kept, out of memory\n", entry->game_id);
+            return -1;
+        }
+        log->pending = pending;
+        log->pending_capacity = capacity;
+    }
+    log->pending_len += encodeGameLogEntry(entry, log->pending + log->pending_len);
+    return 0;
+}
+
+// Queue the moves gathered for @run, which starts over empty. Called with the mutex held.
+static void queue_run(GameLog *log, GameLogEntry *run) {
+    if (run->nb_moves == 0) return;
+    queue_entry(log, run);
+    run->ply += run->nb_moves;
+    run->nb_moves = 0;
+}
+
+// Queue the moves of every game before a pass of the writer. Called with the mutex held.
+static void queue_runs(GameLog *log) {
+    for (size_t r = 0; r < log->nb_runs; r++) {
+        queue_run(log, &log->runs[r]);
+        user_index_remove(&log->runs_by_game, (int32_t) log->runs[r].game_id, (int) r);
+    }
+    log->nb_runs = 0;
+}
+
+static void *run_writer(void *arg) {
+    GameLog *log = arg;
+    pthread_mutex_lock(&log->mutex);
+    while (1) {
+        if (!log->closing) {
+            // the entries queued during the interval are written together
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_nsec += GAME_LOG_WRITE_INTERVAL_MS * 1000000L;
+            deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+            deadline.tv_nsec %= 1000000000L;
+            pthread_cond_timedwait(&log->wake, &log->mutex, &deadline);
+        }
+        queue_runs(log);
+        int failed = 0;
+        if (log->pending_len > 0) {
+            // the game workers fill the other buffer while this one is written
+            uint8_t *records = log->pending;
+            size_t size = log->pending_len, capacity = log->pending_capacity;
+            log->pending = log->spare;
+            log->pending_capacity = log->spare_capacity;
+            log->pending_len = 0;
+            log->spare = records;
+            log->spare_capacity = capacity;
+            size_t log_bytes = log->log_bytes;
+            pthread_mutex_unlock(&log->mutex);
+            failed = commit_entries(log->fd, log_bytes, records, size) < 0;
+            pthread_mutex_lock(&log->mutex);
+            if (failed) {
+                requeue_entries(log, records, size);
+            } else {
+                log->log_bytes += size;
+            }
+        }
+        if (log->closing && (log->pending_len == 0 || failed)) {
+            if (failed) fprintf(stderr, "Game log: %zu bytes of entries could not be written\n", log->pending_len);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&log->mutex);
+    return NULL;
+}
+
+int game_log_open(GameLog *log, const char *dir) {
+    memset(log, 0, sizeof(GameLog));
+    log->fd = -1;
+    log->next_id = 1;
+    pthread_mutex_init(&log->mutex, NULL);
+    pthread_cond_init(&log->wake, NULL);
+    if (!dir) return 0;
+    if (user_index_init(&log->runs_by_game, 64) < 0) return -1;
+
+    char path[PATH_MAX];
+    if (mkdir(dir, 0755) < 0 && errno != EEXIST) {
+        perror(dir);
+        return -1;
+    }
+    snprintf(path, sizeof(path), "%s/%s", dir, GAME_LOG_FILE);
+    if (load(log, path) < 0) return -1;
+    if (pthread_create(&log->writer, NULL, run_writer, log) != 0) return -1;
+    log->has_writer = 1;
+    return 0;
+}
+
+void game_log_close(GameLog *log) {
+    pthread_mutex_lock(&log->mutex);
+    log->closing = 1;
+    pthread_cond_signal(&log->wake);
+    pthread_mutex_unlock(&log->mutex);
+    if (log->has_writer) pthread_join(log->writer, NULL);
+    if (log->fd >= 0) close(log->fd);
+    free(log->pending);
+    free(log->spare);
+    free(log->runs);
+    user_index_free(&log->runs_by_game);
+    pthread_mutex_destroy(&log->mutex);
+    pthread_cond_destroy(&log->wake);
+}
+
+// Queue @entry, a GAME_LOG_START gets the next game id. Returns the game id, 0 if the entry is not kept.
+static uint32_t append_entry(GameLog *log, GameLogEntry *entry) {
+    pthread_mutex_lock(&log->mutex);
+    if (entry->kind == GAME_LOG_START) {
+        entry->game_id = log->next_id;
+    } else {
+        // the moves of the game go before its end
+        int r = user_index_get(&log->runs_by_game, (int32_t) entry->game_id);
+        if (r >= 0) queue_run(log, &log->runs[r]);
+    }
+    if (queue_entry(log, entry) < 0) {
+        pthread_mutex_unlock(&log->mutex);
+        return 0;
+    }
+    if (entry->kind == GAME_LOG_START) {
+        log->next_id++;
+        log->count++;
+    }
+    pthread_mutex_unlock(&log->mutex);
+    return entry->game_id;
+}
+
+// Run of the moves of @game_id since the last pass, created empty from @ply. Called with the mutex held.
+static GameLogEntry *find_run(GameLog *log, uint32_t game_id, uint32_t ply) {
+    int r = user_index_get(&log->runs_by_game, (int32_t) game_id);
+    if (r >= 0) return &log->runs[r];
+    if (log->nb_runs == log->runs_capacity) {
+        size_t capacity = log->runs_capacity ? log->runs_capacity * 2 : 64;
+        GameLogEntry *runs = realloc(log->runs, capacity * sizeof(GameLogEntry));
+        if (!runs) return NULL;
+        log->runs = runs;
+        log->runs_capacity = capacity;
+    }
+    if (user_index_put(&log->runs_by_game, (int32_t) game_id, (int) log->nb_runs) < 0) return NULL;
+    GameLogEntry *run = &log->runs[log->nb_runs++];
+    memset(run, 0, sizeof(GameLogEntry));
+    run->kind = GAME_LOG_MOVES;
+    run->game_id = game_id;
+    run->ply = ply;
+    return run;
+}
+
+uint32_t game_log_start(GameLog *log, int32_t player1_id, int32_t player2_id, uint64_t start_time) {
+    if (log->fd < 0) return 0;
+    GameLogEntry entry = {.kind = GAME_LOG_START, .player1_id = player1_id, .player2_id = player2_id,
+                          .start_time = start_time};
+    return append_entry(log, &entry);
+}
+
+void game_log_move(GameLog *log, uint32_t game_id, uint32_t ply, int move) {
+    if (log->fd < 0 || game_id == 0) return;
+    pthread_mutex_lock(&log->mutex);
+    GameLogEntry *run = find_run(log, game_id, ply);
+    if (!run) {
+        pthread_mutex_unlock(&log->mutex);
+        fprintf(stderr, "Game log: move %u of game %u not kept, out of memory\n", ply, game_id);
+        return;
+    }
+    // a run holds consecutive moves only
+    if (run->nb_moves == GAME_LOG_MAX_MOVES || run->ply + run->nb_moves != ply) queue_run(log, run);
+    if (run->nb_moves == 0) run->ply = ply;
+    run->moves[run->nb_moves++] = (uint8_t) move;
+    pthread_mutex_unlock(&log->mutex);
+}
+
+void game_log_end(GameLog *log, uint32_t game_id, uint32_t duration, int winner, int abandoned, uint32_t plies) {
+    if (log->fd < 0 || game_id == 0) return;
+    GameLogEntry entry = {.kind = GAME_LOG_END, .game_id = game_id, .duration = duration, .winner = (uint8_t) winner,
+                          .abandoned = (uint8_t) abandoned, .plies = plies};
+    append_entry(log, &entry);
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "../common/game_record.h"
+#include "client_index.h"
+
+/*
+ * Every game, appended to games.log in the data directory while it is played (format in game_record.h).
+ * The game workers only queue the encoded entries, when a game starts and when it ends; the moves are gathered by
+ * game and become one GAME_LOG_MOVES per game and per pass of the writer thread. The writer appends and syncs
+ * everything queued since its previous pass at once, so the moves of all the games played during an interval cost one
+ * write and one fdatasync, and a crash loses at most the moves of the last interval.
+ * A failed pass is cut off the file and its entries are written again by the next one.
+ * At startup the log is scanned for the next game id, an entry torn by a crash is cut off.
+ *
+ * Thread-safe: the calls are serialized by the log mutex.
+ */
+
+#define GAME_LOG_WRITE_INTERVAL_MS 20
+
+typedef struct GameLog {
+    pthread_mutex_t mutex;
+    int fd; // -1 when the games are not kept
+    size_t log_bytes; // size of the file up to the last entry written and synced
+    uint32_t next_id;
+    size_t count; // games started in the log
+    uint8_t *pending; // records queued since the last write
+    size_t pending_len;
+    size_t pending_capacity;
+    uint8_t *spare; // buffer the writer writes while the next records go to pending
+    size_t spare_capacity;
+    GameLogEntry *runs; // moves played since the last pass, a GAME_LOG_MOVES per game not encoded yet
+    size_t nb_runs;
+    size_t runs_capacity;
+    UserIndex runs_by_game; // game id -> its run
+    int closing;
+    pthread_cond_t wake;
+    pthread_t writer;
+    int has_writer;
+} GameLog;
+
+// Open the log of @dir (created if needed), or keep no game at all when @dir is NULL. Returns -1 on failure.
+int game_log_open(GameLog *log, const char *dir);
+
+// Write what was queued, stop the writer and release everything
+void game_log_close(GameLog *log);
+
+// Give a game the next id and queue its start. Returns the id, 0 when the games are not kept.
+uint32_t game_log_start(GameLog *log, int32_t player1_id, int32_t player2_id, uint64_t start_time);
+
+// Add move @move (1-6) played at ply @ply to the run of the game @game_id (nothing is kept for the id 0)
+void game_log_move(GameLog *log, uint32_t game_id, uint32_t ply, int move);
+
+// Queue the end of the game @game_id after @plies moves, @winner is 1 or 2, 0 for a draw
+void game_log_end(GameLog *log, uint32_t game_id, uint32_t duration, int winner, int abandoned, uint32_t plies);
@@ -0,0 +1,112 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "leaderboard.h"
+
+static Ranking *source = NULL;
+static pthread_mutex_t *source_mutex = NULL;
+static int refresh_interval_ms = 0;
+
+static pthread_t leaderboard_thread;
+static pthread_mutex_t leaderboard_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t leaderboard_cond;
+static int changed = 0;
+static int stopping = 0;
+
+static uint64_t built_version = 0; // version of the last snapshot built, by the thread
+static RankingSnapshot *handed_over = NULL; // built, not yet picked up by the reactor (exchanged atomically)
+static RankingSnapshot *current = NULL; // picked up, owned by the reactor
+
+// Snapshot of the ranking, NULL if it did not change since the last one or if out of memory
+static RankingSnapshot *build_snapshot(int force) {
+    pthread_mutex_lock(source_mutex);
+    uint64_t version = source->version;
+    size_t count = source->size;
+    // only the copy is made under the lock, the game workers do not wait for the sort
+    PlayerRanking *players = force || version != built_version ? ranking_copy(source) : NULL;
+    pthread_mutex_unlock(source_mutex);
+    if (!players) return NULL;
+    RankingSnapshot *snapshot = ranking_snapshot_create(players, count, version);
+    if (snapshot) built_version = version;
+    return snapshot;
+}
+
+static void hand_over(RankingSnapshot *snapshot) {
+    // a snapshot the reactor did not pick up is replaced by the newer one
+    ranking_snapshot_free(__atomic_exchange_n(&handed_over, snapshot, __ATOMIC_ACQ_REL));
+}
+
+static void *leaderboard_loop(void *arg) {
+    (void) arg;
+    pthread_mutex_lock(&leaderboard_mutex);
+    while (1) {
+        while (!changed && !stopping) {
+            pthread_cond_wait(&leaderboard_cond, &leaderboard_mutex);
+        }
+        if (stopping) break;
+        changed = 0;
+        pthread_mutex_unlock(&leaderboard_mutex);
+
+        RankingSnapshot *snapshot = build_snapshot(0);
+        if (snapshot) hand_over(snapshot);
+
+        // the changes made meanwhile wait for the next snapshot
+        struct timespec until;
+        clock_gettime(CLOCK_MONOTONIC, &until);
+        until.tv_nsec += (long) refresh_interval_ms * 1000000L;
+        until.tv_sec += until.tv_nsec / 1000000000L;
+        until.tv_nsec %= 1000000000L;
+        pthread_mutex_lock(&leaderboard_mutex);
+        while (!stopping) {
+            if (pthread_cond_timedwait(&leaderboard_cond, &leaderboard_mutex, &until) != 0) break;
+        }
+    }
+    pthread_mutex_unlock(&leaderboard_mutex);
+    return NULL;
+}
+
+int leaderboard_init(Ranking *ranking, pthread_mutex_t *mutex, int refresh_ms) {
+    source = ranking;
+    source_mutex = mutex;
+    refresh_interval_ms = refresh_ms;
+    current = build_snapshot(1);
+
+    pthread_condattr_t attributes;
+    pthread_condattr_init(&attributes);
+    pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+    pthread_cond_init(&leaderboard_cond, &attributes);
+    pthread_condattr_destroy(&attributes);
+    if (pthread_create(&leaderboard_thread, NULL, leaderboard_loop, NULL) != 0) {
+        perror("pthread_create leaderboard");
+        return -1;
+    }
+    return 0;
+}
+
+void leaderboard_changed(void) {
+    pthread_mutex_lock(&leaderboard_mutex);
+    changed = 1;
+    pthread_cond_signal(&leaderboard_cond);
+    pthread_mutex_unlock(&leaderboard_mutex);
+}
+
+const RankingSnapshot *leaderboard_current(void) {
+    RankingSnapshot *snapshot = __atomic_exchange_n(&handed_over, NULL, __ATOMIC_ACQ_REL);
+    if (snapshot) {
+        ranking_snapshot_free(current);
+        current = snapshot;
+    }
+    return current;
+}
+
+void leaderboard_stop(void) {
+    pthread_mutex_lock(&leaderboard_mutex);
+    stopping = 1;
+    pthread_cond_signal(&leaderboard_cond);
+    pthread_mutex_unlock(&leaderboard_mutex);
+    pthread_join(leaderboard_thread, NULL);
+    ranking_snapshot_free(__atomic_exchange_n(&handed_over, NULL, __ATOMIC_ACQ_REL));
+    ranking_snapshot_free(current);
+    current = NULL;
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <pthread.h>
+#include "ranking.h"
+
+/*
+ * Leaderboard snapshots, built on their own thread so that the reactor never sorts nor renders the ranking.
+ * The game workers call leaderboard_changed() after updating the ranking; the thread then copies the ranking under its
+ * mutex, builds the snapshot and hands it over to the reactor, at most once every @refresh_ms.
+ * The reactor picks up the last snapshot handed over in leaderboard_current(): a CONSULT_RANKING costs a page copy.
+ */
+
+// Build the first snapshot of @ranking (guarded by @mutex) right away, then start the thread. Returns 0 on success.
+int leaderboard_init(Ranking *ranking, pthread_mutex_t *mutex, int refresh_ms);
+
+// The ranking changed: a new snapshot will be built
+void leaderboard_changed(void);
+
+// Most recent snapshot, NULL if none could be built. Reactor thread only: valid until its next call.
+const RankingSnapshot *leaderboard_current(void);
+
+// Stop the thread, wait for it and free the snapshots
+void leaderboard_stop(void);
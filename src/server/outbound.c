@@ -0,0 +1,166 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include "outbound.h"
+
+#define OUT_QUEUE_MAX_IOV 64
+
+OutFrame *out_frame_new(size_t size) {
+    OutFrame *frame = malloc(sizeof(OutFrame) + size);
+    if (frame) {
+        frame->size = size;
+        frame->refs = 1;
+    }
+    return frame;
+}
+
+void out_frame_retain(OutFrame *frame) {
+    __atomic_add_fetch(&frame->refs, 1, __ATOMIC_RELAXED);
+}
+
+void out_frame_release(OutFrame *frame) {
+    if (frame && __atomic_sub_fetch(&frame->refs, 1, __ATOMIC_ACQ_REL) == 0) free(frame);
+}
+
+void out_queue_init(OutQueue *q) {
+    pthread_mutex_init(&q->lock, NULL);
+    q->fd = -1;
+    q->frames = NULL;
+    q->capacity = 0;
+    q->head = q->count = 0;
+    q->head_offset = 0;
+    q->bytes = 0;
+    q->max_bytes = DEFAULT_MAX_OUTBOUND_BYTES;
+    q->shut = 0;
+}
+
+void out_queue_open(OutQueue *q, int fd, size_t max_bytes) {
+    pthread_mutex_lock(&q->lock);
+    q->fd = fd;
+    q->max_bytes = max_bytes;
+    q->shut = 0;
+    pthread_mutex_unlock(&q->lock);
+}
+
+static void drop_frames(OutQueue *q) {
+    for (size_t i = 0; i < q->count; i++) {
+        out_frame_release(q->frames[(q->head + i) % q->capacity]);
+    }
+    q->head = q->count = 0;
+    q->head_offset = 0;
+    q->bytes = 0;
+}
+
+void out_queue_close(OutQueue *q) {
+    pthread_mutex_lock(&q->lock);
+    drop_frames(q);
+    q->fd = -1;
+    pthread_mutex_unlock(&q->lock);
+}
+
+// caller holds the lock
+static void shut_down(OutQueue *q) {
+    q->shut = 1;
+    drop_frames(q);
+    shutdown(q->fd, SHUT_RDWR);
+}
+
+static int push_frame(OutQueue *q, OutFrame *frame) {
+    if (q->count == q->capacity) {
+        size_t new_capacity = q->capacity ? q->capacity * 2 : 8;
+        OutFrame **frames = malloc(new_capacity * sizeof(OutFrame *));
+        if (!frames) return -1;
+        for (size_t i = 0; i < q->count; i++) {
+            frames[i] = q->frames[(q->head + i) % q->capacity];
+        }
+        free(q->frames);
+        q->frames = frames;
+        q->capacity = new_capacity;
+        q->head = 0;
+    }
+    q->frames[(q->head + q->count) % q->capacity] = frame;
+    q->count++;
+    q->bytes += frame->size;
+    return 0;
+}
+
+// caller holds the lock
+static int flush_locked(OutQueue *q) {
+    while (q->count > 0) {
+        struct iovec iov[OUT_QUEUE_MAX_IOV];
+        int nb_iov = 0;
+        for (size_t i = 0; i < q->count && nb_iov < OUT_QUEUE_MAX_IOV; i++) {
+            OutFrame *frame = q->frames[(q->head + i) % q->capacity];
+            size_t offset = (i == 0) ? q->head_offset : 0;
+            iov[nb_iov].iov_base = frame->data + offset;
+            iov[nb_iov].iov_len = frame->size - offset;
+            nb_iov++;
+        }
+
+        struct msghdr msg = {0};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = nb_iov;
+        ssize_t sent = sendmsg(q->fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+            return -1;
+        }
+
+        // release the frames that are completely sent
+        q->bytes -= sent;
+        size_t left = (size_t) sent;
+        while (left > 0) {
+            OutFrame *frame = q->frames[q->head];
+            size_t remaining = frame->size - q->head_offset;
+            if (left < remaining) {
+                q->head_offset += left;
+                break;
+            }
+            left -= remaining;
+            out_frame_release(frame);
+            q->head = (q->head + 1) % q->capacity;
+            q->count--;
+            q->head_offset = 0;
+        }
+    }
+    return 1;
+}
+
+int out_queue_send(OutQueue *q, int fd, OutFrame *frame) {
+    pthread_mutex_lock(&q->lock);
+    if (q->fd != fd || q->fd == -1 || q->shut) {
+        // the connection was closed (and the fd maybe reused) since the caller looked it up
+        pthread_mutex_unlock(&q->lock);
+        out_frame_release(frame);
+        return -1;
+    }
+    if (q->bytes + frame->size > q->max_bytes) {
+        printf("Client fd %d is too slow (%zu bytes pending), disconnecting it\n", q->fd, q->bytes);
+        // the reactor sees the shutdown as a disconnection and cleans the client up
+        shut_down(q);
+        pthread_mutex_unlock(&q->lock);
+        out_frame_release(frame);
+        return -1;
+    }
+    if (push_frame(q, frame) < 0) {
+        pthread_mutex_unlock(&q->lock);
+        out_frame_release(frame);
+        return -1;
+    }
+    // if older frames are still waiting, the socket is full: the reactor flushes when it becomes writable
+    if (q->count == 1 && flush_locked(q) < 0) {
+        shut_down(q);
+    }
+    pthread_mutex_unlock(&q->lock);
+    return 0;
+}
+
+int out_queue_flush(OutQueue *q) {
+    pthread_mutex_lock(&q->lock);
+    int ret = (q->fd == -1 || q->shut) ? -1 : flush_locked(q);
+    pthread_mutex_unlock(&q->lock);
+    return ret;
+}
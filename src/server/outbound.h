@@ -0,0 +1,59 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+/*
+ * Per-connection outbound queue.
+ * Messages are framed (header + payload) into a single OutFrame when queued, and the queue is flushed with one
+ * sendmsg() over as many frames as possible. Nothing ever blocks: what the socket does not accept stays queued until
+ * the reactor reports the socket as writable again.
+ */
+
+#define DEFAULT_MAX_OUTBOUND_BYTES (256 * 1024)
+
+// Frames are reference-counted, so one encoded message can be queued on many connections (spectators)
+typedef struct OutFrame {
+    size_t size;
+    int refs;
+    uint8_t data[];
+} OutFrame;
+
+typedef struct OutQueue {
+    pthread_mutex_t lock;
+    int fd; // -1 when the connection is closed
+    OutFrame **frames; // ring buffer of queued frames
+    size_t capacity;
+    size_t head;
+    size_t count;
+    size_t head_offset; // bytes of the first frame already sent
+    size_t bytes; // bytes waiting to be sent
+    size_t max_bytes; // high-water mark, the connection is shut down when it is exceeded
+    int shut; // set once the connection has been shut down, nothing is queued anymore
+} OutQueue;
+
+// Allocate a frame holding @size bytes, with one reference
+OutFrame *out_frame_new(size_t size);
+
+// Take one more reference to @frame, for one more queue
+void out_frame_retain(OutFrame *frame);
+
+// Drop a reference to @frame, which is freed with the last one
+void out_frame_release(OutFrame *frame);
+
+void out_queue_init(OutQueue *q);
+
+// Attach the queue to a newly accepted socket
+void out_queue_open(OutQueue *q, int fd, size_t max_bytes);
+
+// Drop every pending frame and detach the queue from its socket
+void out_queue_close(OutQueue *q);
+
+/*
+ * Queue a frame for the connection @fd and try to send it right away. The queue takes over one reference to the frame.
+ * Returns 0 if the frame was queued, -1 if the connection is closed or too far behind (it is then shut down).
+ */
+int out_queue_send(OutQueue *q, int fd, OutFrame *frame);
+
+// Send as much as possible. Returns 1 if the queue is empty, 0 if the socket is full, -1 on error.
+int out_queue_flush(OutQueue *q);
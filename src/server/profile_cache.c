@@ -0,0 +1,93 @@
+#include <stdlib.h>
+#include <string.h>
+#include "profile_cache.h"
+
+#define PROFILE_CACHE_MIN_CAPACITY 64
+
+int profile_cache_init(ProfileCache *cache, size_t expected) {
+    memset(cache, 0, sizeof(ProfileCache));
+    cache->capacity = expected > PROFILE_CACHE_MIN_CAPACITY ? expected : PROFILE_CACHE_MIN_CAPACITY;
+    cache->profiles = malloc(cache->capacity * sizeof(CachedProfile));
+    if (!cache->profiles || user_index_init(&cache->by_id, cache->capacity) < 0) {
+        free(cache->profiles);
+        return -1;
+    }
+    pthread_mutex_init(&cache->mutex, NULL);
+    return 0;
+}
+
+// Index of the profile of @user_id, created empty if needed. -1 if out of memory.
+static int profile_of(ProfileCache *cache, int32_t user_id) {
+    int index = user_index_get(&cache->by_id, user_id);
+    if (index != -1) return index;
+    if (cache->count == cache->capacity) {
+        CachedProfile *profiles = realloc(cache->profiles, cache->capacity * 2 * sizeof(CachedProfile));
+        if (!profiles) return -1;
+        cache->profiles = profiles;
+        cache->capacity *= 2;
+    }
+    index = (int) cache->count;
+    if (user_index_put(&cache->by_id, user_id, index) < 0) return -1;
+    memset(&cache->profiles[index], 0, sizeof(CachedProfile));
+    cache->count++;
+    return index;
+}
+
+static int slot_of(uint8_t version) {
+    return version <= 1 ? 0 : version - 1 < PROFILE_CACHE_VERSIONS ? version - 1 : PROFILE_CACHE_VERSIONS - 1;
+}
+
+long profile_cache_get(ProfileCache *cache, int32_t user_id, uint8_t version, uint8_t *payload, size_t capacity,
+                       uint32_t *stamp) {
+    long size = -1;
+    pthread_mutex_lock(&cache->mutex);
+    int index = user_index_get(&cache->by_id, user_id);
+    *stamp = 0;
+    if (index != -1) {
+        CachedProfile *profile = &cache->profiles[index];
+        int slot = slot_of(version);
+        *stamp = profile->stamp;
+        if (profile->payloads[slot] && profile->sizes[slot] <= capacity) {
+            memcpy(payload, profile->payloads[slot], profile->sizes[slot]);
+            size = (long) profile->sizes[slot];
+        }
+    }
+    if (size < 0) cache->misses++;
+    else cache->hits++;
+    pthread_mutex_unlock(&cache->mutex);
+    return size;
+}
+
+void profile_cache_put(ProfileCache *cache, int32_t user_id, uint8_t version, const uint8_t *payload, size_t size,
+                       uint32_t stamp) {
+    uint8_t *copy = malloc(size ? size : 1);
+    if (!copy) return;
+    memcpy(copy, payload, size);
+    pthread_mutex_lock(&cache->mutex);
+    int index = profile_of(cache, user_id);
+    if (index != -1 && cache->profiles[index].stamp == stamp) {
+        CachedProfile *profile = &cache->profiles[index];
+        int slot = slot_of(version);
+        free(profile->payloads[slot]);
+        profile->payloads[slot] = copy;
+        profile->sizes[slot] = size;
+        copy = NULL;
+    }
+    pthread_mutex_unlock(&cache->mutex);
+    // encoded from data older than the last invalidation
+    free(copy);
+}
+
+void profile_cache_invalidate(ProfileCache *cache, int32_t user_id) {
+    pthread_mutex_lock(&cache->mutex);
+    int index = profile_of(cache, user_id);
+    if (index != -1) {
+        CachedProfile *profile = &cache->profiles[index];
+        profile->stamp++;
+        for (int slot = 0; slot < PROFILE_CACHE_VERSIONS; slot++) {
+            free(profile->payloads[slot]);
+            profile->payloads[slot] = NULL;
+        }
+    }
+    pthread_mutex_unlock(&cache->mutex);
+}
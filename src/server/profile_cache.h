@@ -0,0 +1,48 @@
+#pragma once
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "client_index.h"
+
+/*
+ * RECEIVE_USER_PROFILE payloads of the users, encoded once per protocol version and copied as they are into the
+ * answers of CONSULT_USER_PROFILE. A profile is invalidated when its bio or statistics change, then encoded again
+ * from the user store by the next request.
+ *
+ * Every invalidation bumps the stamp of the user: a payload encoded from data read before an invalidation is
+ * refused by profile_cache_put, so a profile can never go back to stale. Thread-safe.
+ */
+
+#define PROFILE_CACHE_VERSIONS 2 // PROTOCOL_V1 and PROTOCOL_V2
+
+typedef struct CachedProfile {
+    uint32_t stamp; // invalidations so far
+    uint8_t *payloads[PROFILE_CACHE_VERSIONS]; // NULL when not encoded yet
+    size_t sizes[PROFILE_CACHE_VERSIONS];
+} CachedProfile;
+
+typedef struct ProfileCache {
+    pthread_mutex_t mutex;
+    CachedProfile *profiles;
+    size_t count;
+    size_t capacity;
+    UserIndex by_id; // user id -> index in profiles
+    uint64_t hits;
+    uint64_t misses;
+} ProfileCache;
+
+int profile_cache_init(ProfileCache *cache, size_t expected);
+
+/*
+ * Copy the payload of @user_id in protocol @version to @payload (@capacity bytes). Returns its size, or -1 when it is
+ * not cached: *stamp is then the value to give to profile_cache_put once the payload is encoded.
+ */
+long profile_cache_get(ProfileCache *cache, int32_t user_id, uint8_t version, uint8_t *payload, size_t capacity,
+                       uint32_t *stamp);
+
+// Keep the payload encoded after a miss with @stamp, unless the profile was invalidated since
+void profile_cache_put(ProfileCache *cache, int32_t user_id, uint8_t version, const uint8_t *payload, size_t size,
+                       uint32_t stamp);
+
+// Drop the payloads of @user_id, to call after every change of its profile
+void profile_cache_invalidate(ProfileCache *cache, int32_t user_id);
@@ -0,0 +1,159 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ranking.h"
+
+#define RANKING_MIN_CAPACITY 64
+#define RANKING_LINE_SIZE 64
+
+int ranking_init(Ranking *ranking, size_t expected) {
+    size_t capacity = expected > RANKING_MIN_CAPACITY ? expected : RANKING_MIN_CAPACITY;
+    ranking->heap = malloc(capacity * sizeof(PlayerRanking));
+    if (!ranking->heap || user_index_init(&ranking->positions, capacity) < 0) {
+        free(ranking->heap);
+        ranking->heap = NULL;
+        return -1;
+    }
+    ranking->size = 0;
+    ranking->capacity = capacity;
+    ranking->version = 0;
+    return 0;
+}
+
+// Puts @entry at @position and keeps the index in sync
+static void place(Ranking *ranking, size_t position, PlayerRanking entry) {
+    ranking->heap[position] = entry;
+    user_index_put(&ranking->positions, entry.user_id, (int) position);
+}
+
+static void sift_up(Ranking *ranking, size_t position) {
+    PlayerRanking entry = ranking->heap[position];
+    while (position > 0) {
+        size_t parent = (position - 1) / 2;
+        if (ranking->heap[parent].wins >= entry.wins) break;
+        place(ranking, position, ranking->heap[parent]);
+        position = parent;
+    }
+    place(ranking, position, entry);
+}
+
+int ranking_add(Ranking *ranking, int32_t user_id) {
+    if (user_index_get(&ranking->positions, user_id) != -1) return 0;
+    if (ranking->size == ranking->capacity) {
+        PlayerRanking *heap = realloc(ranking->heap, ranking->capacity * 2 * sizeof(PlayerRanking));
+        if (!heap) return -1;
+        ranking->heap = heap;
+        ranking->capacity *= 2;
+    }
+    PlayerRanking entry = {user_id, 0, 0};
+    if (user_index_put(&ranking->positions, user_id, (int) ranking->size) < 0) return -1;
+    ranking->heap[ranking->size] = entry;
+    ranking->size++;
+    ranking->version++;
+    // no win yet: it already stands at its place, below everyone
+    return 0;
+}
+
+int ranking_record_result(Ranking *ranking, int32_t user_id, int won) {
+    if (ranking_add(ranking, user_id) < 0) return -1;
+    size_t position = (size_t) user_index_get(&ranking->positions, user_id);
+    ranking->heap[position].games++;
+    ranking->version++;
+    // wins only ever increase, the player can only move up
+    if (won) {
+        ranking->heap[position].wins++;
+        sift_up(ranking, position);
+    }
+    return 0;
+}
+
+int ranking_set(Ranking *ranking, int32_t user_id, int wins, int games) {
+    if (ranking_add(ranking, user_id) < 0) return -1;
+    size_t position = (size_t) user_index_get(&ranking->positions, user_id);
+    PlayerRanking *entry = &ranking->heap[position];
+    int more_wins = wins > entry->wins;
+    entry->wins = wins;
+    entry->games = games;
+    ranking->version++;
+    if (more_wins) sift_up(ranking, position);
+    return 0;
+}
+
+const PlayerRanking *ranking_get(const Ranking *ranking, int32_t user_id) {
+    int position = user_index_get(&ranking->positions, user_id);
+    return position == -1 ? NULL : &ranking->heap[position];
+}
+
+// ---------------------- SNAPSHOTS ---------------------- //
+PlayerRanking *ranking_copy(const Ranking *ranking) {
+    PlayerRanking *players = malloc((ranking->size ? ranking->size : 1) * sizeof(PlayerRanking));
+    if (players) memcpy(players, ranking->heap, ranking->size * sizeof(PlayerRanking));
+    return players;
+}
+
+static int compare_players(const void *a, const void *b) {
+    const PlayerRanking *x = a, *y = b;
+    if (x->wins != y->wins) return y->wins - x->wins;
+    if (x->games != y->games) return x->games - y->games;
+    return (x->user_id > y->user_id) - (x->user_id < y->user_id);
+}
+
+void ranking_snapshot_free(RankingSnapshot *snapshot) {
+    if (!snapshot) return;
+    free(snapshot->players);
+    free(snapshot->ranks);
+    free(snapshot->text);
+    free(snapshot->line_starts);
+    user_index_free(&snapshot->places);
+    free(snapshot);
+}
+
+RankingSnapshot *ranking_snapshot_create(PlayerRanking *players, size_t count, uint64_t version) {
+    RankingSnapshot *snapshot = calloc(1, sizeof(RankingSnapshot));
+    if (!snapshot) {
+        free(players);
+        return NULL;
+    }
+    snapshot->version = version;
+    snapshot->count = count;
+    snapshot->players = players;
+    qsort(players, count, sizeof(PlayerRanking), compare_players);
+    snapshot->ranks = malloc((count ? count : 1) * sizeof(int));
+    snapshot->text = malloc((count ? count : 1) * RANKING_LINE_SIZE);
+    snapshot->line_starts = malloc((count + 1) * sizeof(size_t));
+    if (!snapshot->ranks || !snapshot->text || !snapshot->line_starts || user_index_init(&snapshot->places, count) < 0) {
+        ranking_snapshot_free(snapshot);
+        return NULL;
+    }
+    size_t len = 0;
+    for (size_t k = 0; k < count; k++) {
+        snapshot->ranks[k] = k > 0 && players[k].wins == players[k - 1].wins ? snapshot->ranks[k - 1] : (int) k + 1;
+        snapshot->line_starts[k] = len;
+        // snprintf writes its '\0' past the line, the next line overwrites it
+        int n = snprintf(snapshot->text + len, RANKING_LINE_SIZE, "%d - joueur id %d - victoires : %d / %d parties\n",
+                         snapshot->ranks[k], players[k].user_id, players[k].wins, players[k].games);
+        len += n < RANKING_LINE_SIZE ? (size_t) n : RANKING_LINE_SIZE - 1;
+        user_index_put(&snapshot->places, players[k].user_id, (int) k);
+    }
+    snapshot->line_starts[count] = len;
+    return snapshot;
+}
+
+int ranking_snapshot_rank(const RankingSnapshot *snapshot, int32_t user_id) {
+    int place = user_index_get(&snapshot->places, user_id);
+    return place == -1 ? 0 : snapshot->ranks[place];
+}
+
+size_t ranking_snapshot_page(const RankingSnapshot *snapshot, size_t first, size_t max_lines, char *buffer, size_t size) {
+    size_t last = first;
+    if (first < snapshot->count) {
+        size_t end = first + max_lines < snapshot->count ? first + max_lines : snapshot->count;
+        // whole lines only, and room for the '\0'
+        last = end;
+        while (last > first && snapshot->line_starts[last] - snapshot->line_starts[first] >= size) last--;
+    }
+    size_t len = last > first ? snapshot->line_starts[last] - snapshot->line_starts[first] : 0;
+    if (len) memcpy(buffer, snapshot->text + snapshot->line_starts[first], len);
+    if (size) buffer[len] = '\0';
+    return last - first;
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "client_index.h"
+
+/*
+ * Leaderboard of the players by number of wins: a binary max-heap on the wins, plus a UserIndex from user_id to the
+ * position of the player in the heap, so recording a result is a hash lookup and a sift of O(log n) swaps.
+ * The heap grows with the number of players. Not thread-safe: the server serializes the calls with a mutex.
+ */
+
+typedef struct PlayerRanking {
+    int32_t user_id;
+    int wins;
+    int games;
+} PlayerRanking;
+
+typedef struct Ranking {
+    PlayerRanking *heap; // heap[0] has the most wins
+    size_t size;
+    size_t capacity;
+    UserIndex positions; // user_id -> index in heap
+    uint64_t version; // changes with every update, to know when a snapshot is out of date
+} Ranking;
+
+int ranking_init(Ranking *ranking, size_t expected);
+
+// Add @user_id with no game played, unless it is already ranked. Returns -1 if the ranking could not grow.
+int ranking_add(Ranking *ranking, int32_t user_id);
+
+// Count a finished game of @user_id, won or not (lost or draw). The player is added if needed. Returns -1 on failure.
+int ranking_record_result(Ranking *ranking, int32_t user_id, int won);
+
+// Set the record of @user_id, kept from a previous run (wins never decrease afterwards). Returns -1 on failure.
+int ranking_set(Ranking *ranking, int32_t user_id, int wins, int games);
+
+// Returns the entry of @user_id, NULL if it is not ranked. Valid until the next call that changes the ranking.
+const PlayerRanking *ranking_get(const Ranking *ranking, int32_t user_id);
+
+/*
+ * Leaderboard frozen at a version of the ranking, built once and then only read: the players sorted by wins (then
+ * fewer games, then id), with their lines of text rendered back to back so that a page of the leaderboard is one
+ * memcpy, and a UserIndex from user_id to place for the rank of a player.
+ * Players with the same number of wins share the same rank.
+ */
+typedef struct RankingSnapshot {
+    uint64_t version;
+    size_t count;
+    PlayerRanking *players; // best first
+    int *ranks; // rank of players[k], from 1
+    char *text; // one line per player, in order, not '\0'-terminated
+    size_t *line_starts; // count + 1 offsets in text, line k is [line_starts[k], line_starts[k + 1])
+    UserIndex places; // user_id -> index in players
+} RankingSnapshot;
+
+// Copy of the players of @ranking, in heap order, to build a snapshot from. Returns NULL if out of memory.
+PlayerRanking *ranking_copy(const Ranking *ranking);
+
+// Build the snapshot of @count players (taken over and sorted) at @version. Returns NULL if out of memory.
+RankingSnapshot *ranking_snapshot_create(PlayerRanking *players, size_t count, uint64_t version);
+
+void ranking_snapshot_free(RankingSnapshot *snapshot);
+
+// Rank of @user_id in the snapshot, 0 if it is not ranked
+int ranking_snapshot_rank(const RankingSnapshot *snapshot, int32_t user_id);
+
+/*
+ * Copy the lines of the players from @first (0 for the best) on, at most @max_lines of them and as many as fit with a
+ * '\0' in @buffer of @size bytes. Returns the number of lines copied.
+ */
+size_t ranking_snapshot_page(const RankingSnapshot *snapshot, size_t first, size_t max_lines, char *buffer, size_t size);
@@ -0,0 +1,74 @@
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "reactor.h"
+
+static int epoll_fd = -1;
+static int running = 0;
+
+int reactor_init(void) {
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) {
+        perror("epoll_create1");
+        return -1;
+    }
+    return 0;
+}
+
+static int reactor_ctl(int op, int fd, uint32_t events, void *ctx) {
+    struct epoll_event ev = {0};
+    ev.events = events | EPOLLET;
+    ev.data.ptr = ctx;
+    if (epoll_ctl(epoll_fd, op, fd, &ev) < 0) {
+        perror("epoll_ctl");
+        return -1;
+    }
+    return 0;
+}
+
+int reactor_add(int fd, uint32_t events, void *ctx) {
+    return reactor_ctl(EPOLL_CTL_ADD, fd, events, ctx);
+}
+
+int reactor_modify(int fd, uint32_t events, void *ctx) {
+    return reactor_ctl(EPOLL_CTL_MOD, fd, events, ctx);
+}
+
+int reactor_remove(int fd) {
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL) < 0 && errno != EBADF && errno != ENOENT) {
+        perror("epoll_ctl del");
+        return -1;
+    }
+    return 0;
+}
+
+int reactor_run(ReactorHandler handler) {
+    struct epoll_event events[REACTOR_MAX_EVENTS];
+    running = 1;
+    while (running) {
+        int n = epoll_wait(epoll_fd, events, REACTOR_MAX_EVENTS, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait");
+            return -1;
+        }
+        for (int i = 0; i < n; i++) {
+            handler(events[i].data.ptr, events[i].events);
+        }
+    }
+    return 0;
+}
+
+void reactor_stop(void) {
+    running = 0;
+}
+
+int set_non_blocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+        perror("fcntl O_NONBLOCK");
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <stdint.h>
+#include <sys/epoll.h>
+
+/*
+ * Edge-triggered epoll reactor.
+ * Every registered fd carries an opaque context pointer that is handed back to the handler with the ready events,
+ * so dispatch cost only depends on the number of ready fds, not on the number of connected clients.
+ */
+
+#define REACTOR_MAX_EVENTS 256
+
+typedef void (*ReactorHandler)(void *ctx, uint32_t events);
+
+// Create the epoll instance. Returns 0 on success, -1 on error.
+int reactor_init(void);
+
+// Register a fd in edge-triggered mode (EPOLLET is always added to @events)
+int reactor_add(int fd, uint32_t events, void *ctx);
+
+// Change the events a fd is waiting for. Also re-arms the fd: if it is already ready, a new edge is reported.
+int reactor_modify(int fd, uint32_t events, void *ctx);
+
+// Unregister a fd (closing the fd also unregisters it)
+int reactor_remove(int fd);
+
+// Wait for events and call @handler for each ready fd, until reactor_stop(). Returns -1 if epoll_wait fails.
+int reactor_run(ReactorHandler handler);
+
+// Make reactor_run() return once the events already received are handled. Called from a handler.
+void reactor_stop(void);
+
+// Put a fd in non-blocking mode
+int set_non_blocking(int fd);
@@ -0,0 +1,107 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "scheduler.h"
+
+typedef struct Task {
+    TaskFunction run;
+    void *arg;
+    struct Task *next;
+} Task;
+
+typedef struct {
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    Task *head;
+    Task *tail;
+    int stopping;
+} Worker;
+
+static Worker *workers = NULL;
+static int nb_of_workers = 0;
+
+static void *worker_loop(void *arg) {
+    Worker *w = arg;
+    while (1) {
+        pthread_mutex_lock(&w->mutex);
+        while (w->head == NULL && !w->stopping) {
+            pthread_cond_wait(&w->cond, &w->mutex);
+        }
+        if (w->head == NULL) {
+            pthread_mutex_unlock(&w->mutex);
+            break;
+        }
+        // take the whole queue at once to lock only once per batch
+        Task *task = w->head;
+        w->head = w->tail = NULL;
+        pthread_mutex_unlock(&w->mutex);
+
+        while (task) {
+            Task *next = task->next;
+            task->run(task->arg);
+            free(task);
+            task = next;
+        }
+    }
+    return NULL;
+}
+
+int scheduler_init(int nb_workers) {
+    if (nb_workers <= 0) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        nb_workers = cores > 0 ? (int) cores : 1;
+    }
+    workers = calloc(nb_workers, sizeof(Worker));
+    if (!workers) return -1;
+
+    for (int i = 0; i < nb_workers; i++) {
+        pthread_mutex_init(&workers[i].mutex, NULL);
+        pthread_cond_init(&workers[i].cond, NULL);
+        if (pthread_create(&workers[i].thread, NULL, worker_loop, &workers[i]) != 0) {
+            perror("pthread_create worker");
+            return -1;
+        }
+        nb_of_workers++;
+    }
+    printf("Game scheduler started with %d workers\n", nb_of_workers);
+    return 0;
+}
+
+int scheduler_workers(void) {
+    return nb_of_workers;
+}
+
+int scheduler_post(unsigned int key, TaskFunction run, void *arg) {
+    Task *task = malloc(sizeof(Task));
+    if (!task) return -1;
+    task->run = run;
+    task->arg = arg;
+    task->next = NULL;
+
+    Worker *w = &workers[key % nb_of_workers];
+    pthread_mutex_lock(&w->mutex);
+    if (w->tail) {
+        w->tail->next = task;
+    } else {
+        w->head = task;
+    }
+    w->tail = task;
+    pthread_cond_signal(&w->cond);
+    pthread_mutex_unlock(&w->mutex);
+    return 0;
+}
+
+void scheduler_stop(void) {
+    for (int i = 0; i < nb_of_workers; i++) {
+        pthread_mutex_lock(&workers[i].mutex);
+        workers[i].stopping = 1;
+        pthread_cond_signal(&workers[i].cond);
+        pthread_mutex_unlock(&workers[i].mutex);
+    }
+    for (int i = 0; i < nb_of_workers; i++) {
+        pthread_join(workers[i].thread, NULL);
+    }
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+/*
+ * Fixed pool of worker threads, each one owning a FIFO of tasks.
+ * Tasks posted with the same key always run on the same worker, in the order they were posted,
+ * so every event of a given game is serialized without any per-game thread.
+ */
+
+typedef void (*TaskFunction)(void *arg);
+
+// Start @nb_workers threads (one per online core if @nb_workers <= 0). Returns 0 on success.
+int scheduler_init(int nb_workers);
+
+// Number of running workers
+int scheduler_workers(void);
+
+// Queue @run(@arg) on the worker selected by @key. Returns -1 if out of memory, @run is then never called.
+int scheduler_post(unsigned int key, TaskFunction run, void *arg);
+
+// Let every worker run the tasks already queued (and the ones they queue themselves), then stop it and wait for it
+void scheduler_stop(void);
@@ -1,544 +1,1546 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdarg.h>
 #include <string.h>
+#include <errno.h>
 #include <pthread.h>
+#include <signal.h>
+#include <sys/signalfd.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
-#include <sys/select.h>
+#include <netinet/tcp.h>
+#include <time.h>
 #include <unistd.h>
 #include "../common/api.h"
 #include "../common/utils.h"
+#include "../common/framing.h"
+#include "../common/rules.h"
+#include "../common/ai.h"
+#include "../common/tablebase.h"
+#include "../common/book.h"
+#include "reactor.h"
+#include "scheduler.h"
+#include "outbound.h"
+#include "server.h"
+#include "client_index.h"
+#include "ranking.h"
+#include "leaderboard.h"
+#include "user_store.h"
+#include "profile_cache.h"
+#include "game_log.h"
+#include "fanout.h"
+#include "bot_search.h"
+#include "slab.h"
 
 #define PORT 8080
-#define MAX_CLIENTS 10
+#define BOT_USER_ID 100000 // reserved in the user store, which skips it when numbering the users
+#define BOT_USERNAME "awalbot"
+#define BOT_TT_ENTRIES (1 << 16) // per bot search thread
 #define USERNAME_SIZE 32
-#define MAX_GAMES 20
+#define MAX_PENDING_CHALLENGES 32 // challenges a client can have waiting for its answer
+#define RANKING_PAGE_SIZE 10 // lines of a CONSULT_RANKING answer, when the client does not ask for a number
+#define RANKING_MAX_PAGE_SIZE 16 // what fits in a text field
+#define RANKING_REFRESH_MS 100 // a ranking snapshot is rebuilt at most this often
 
 
-//#########   RANKINGG ##############
 typedef struct {
-    int id;
-    int wins;
-} PlayerRanking;
+    int slot; // index of the client in the connection table
+    int32_t handle; // slab handle of the slot: names the client for the other threads, see acquire_client()
+    int is_bot; // the computer player: no socket (fd -1), never in game, plays any number of games at once
+    int fd;
+    int user_id;
+    char username[USERNAME_SIZE + 1];
+    int active;
+    int nb_of_pending_challenges;
+    int pending_challenges_capacity;
+    int32_t *pending_challenges; // handles of the challengers
+    uint32_t events; // epoll events the socket is registered for
+    int game_id; // game played by the client, 0 in the lobby. Cleared by the game worker: see client_game_id()
+    int watching_game_id; // game watched by the client, 0 if none. Cleared by the game worker: see client_watching_game_id()
+    uint8_t version; // protocol version negotiated at CONNECT
+    FrameBuffer in; // received bytes not yet dispatched
+    OutQueue out; // messages waiting for the socket to be writable
+} Client;
 
-typedef struct {
-    Player *data;
-    int size;
-    int capacity;
-} MaxHeap;
+// Connection table, grown by chunks up to server_config.max_clients: a Client never moves while it is connected
+static Slab client_slab;
+static ServerConfig server_config;
 
-MaxHeap *create_heap(int capacity) {
-    MaxHeap *h = malloc(sizeof(MaxHeap));
-    h->data = malloc(capacity * sizeof(Player));
-    h->size = 0;
-    h->capacity = capacity;
-    return h;
+static inline Client *client_at(int i) {
+    return slab_at(&client_slab, i);
 }
 
-void swap(PlayerRanking *a, PlayerRanking *b) {
-    PlayerRanking tmp = *a;
-    *a = *b;
-    *b = tmp;
+// Number of slots to scan to visit every connected client
+static inline int client_slots(void) {
+    return (int) slab_capacity(&client_slab);
 }
 
-void heapify_up(MaxHeap *h, int i) {
-    while (i > 0) {
-        int parent = (i - 1) / 2;
-        if (h->data[i].wins <= h->data[parent].wins) break;
-        swap(&h->data[i], &h->data[parent]);
-        i = parent;
-    }
+/*
+ * The game worker sends the players back to the lobby when their game ends, while the reactor reads game_id to route
+ * their requests: it only goes through these atomics.
+ */
+static inline int client_game_id(const Client *client) {
+    return __atomic_load_n(&client->game_id, __ATOMIC_ACQUIRE);
 }
 
-void heapify_down(MaxHeap *h, int i) {
-    while (1) {
-        int left = i * 2 + 1;
-        int right = i * 2 + 2;
-        int largest = i;
+static inline void set_client_game_id(Client *client, int game_id) {
+    __atomic_store_n(&client->game_id, game_id, __ATOMIC_RELEASE);
+}
+
+// Same for watching_game_id, which the game worker clears when it cannot add the watcher
+static inline int client_watching_game_id(const Client *client) {
+    return __atomic_load_n(&client->watching_game_id, __ATOMIC_ACQUIRE);
+}
 
-        if (left < h->size && h->data[left].wins > h->data[largest].wins)
-            largest = left;
-        if (right < h->size && h->data[right].wins > h->data[largest].wins)
-            largest = right;
+static inline void set_client_watching_game_id(Client *client, int game_id) {
+    __atomic_store_n(&client->watching_game_id, game_id, __ATOMIC_RELEASE);
+}
 
-        if (largest == i) break;
+// The out queue is used by the other threads, it lives as long as its slot
+static void init_client_slot(void *entry) {
+    out_queue_init(&((Client *) entry)->out);
+}
 
-        swap(&h->data[i], &h->data[largest]);
-        i = largest;
-    }
+/*
+ * Index of the connected clients by user id, written by the reactor thread on CONNECT and disconnection,
+ * and read from every thread. The reactor finds the client of a socket in its epoll data.
+ */
+static UserIndex slots_by_user_id;
+static pthread_rwlock_t index_lock = PTHREAD_RWLOCK_INITIALIZER;
+
+// Slot of the connected client with this user_id, -1 if there is none
+int find_client_index_by_user_id(int user_id) {
+    pthread_rwlock_rdlock(&index_lock);
+    int idx = user_index_get(&slots_by_user_id, user_id);
+    pthread_rwlock_unlock(&index_lock);
+    if (idx == -1 || !client_at(idx)->active || client_at(idx)->user_id != user_id) return -1;
+    return idx;
 }
 
-void heap_insert(MaxHeap *h, PlayerRanking p) {
-    if (h->size == h->capacity) return;
-    h->data[h->size] = p;
-    heapify_up(h, h->size);
-    h->size++;
+void remove_client_by_index(int idx) {
+    if (idx < 0 || idx >= client_slots()) return;
+
+    // only the reactor thread adds and removes clients, the other threads go through acquire_client()
+    if (!client_at(idx)->active) return;
+
+    // unindexed and its handle made stale before the fd is closed and can be reused by a new connection
+    pthread_rwlock_wrlock(&index_lock);
+    user_index_remove(&slots_by_user_id, client_at(idx)->user_id, idx);
+    out_queue_close(&client_at(idx)->out);
+    close(client_at(idx)->fd);
+    client_at(idx)->active = 0;
+    client_at(idx)->fd = -1;
+    slab_free(&client_slab, client_at(idx)->handle);
+    pthread_rwlock_unlock(&index_lock);
+
+    frame_buffer_free(&client_at(idx)->in);
+    free(client_at(idx)->pending_challenges);
+    client_at(idx)->pending_challenges = NULL;
+    client_at(idx)->pending_challenges_capacity = 0;
+    client_at(idx)->nb_of_pending_challenges = 0;
+    set_client_game_id(client_at(idx), 0);
 }
 
-void heap_update_wins(MaxHeap *h, int player_id) {
-    for (int i = 0; i < h->size; i++) {
-        if (h->data[i].id == player_id) {
-            h->data[i].wins++;
-            heapify_up(h, i);
-            heapify_down(h, i);
-            return;
-        }
+/*
+ * The game workers and the fan-out thread name a client by its handle: its fd can be closed, then reused by a new
+ * connection, at any time, while a stale handle is detected. The reactor removes the clients under the write lock,
+ * so the returned client stays connected until release_client(). NULL if the client is gone.
+ */
+static Client *acquire_client(int32_t handle) {
+    pthread_rwlock_rdlock(&index_lock);
+    Client *client = slab_get(&client_slab, handle);
+    if (client && client->active) return client;
+    pthread_rwlock_unlock(&index_lock);
+    return NULL;
+}
+
+static void release_client(void) {
+    pthread_rwlock_unlock(&index_lock);
+}
+
+// Handle of the connected client with this user_id, -1 if there is none
+static int32_t find_client_handle_by_user_id(int user_id) {
+    pthread_rwlock_rdlock(&index_lock);
+    int idx = user_index_get(&slots_by_user_id, user_id);
+    int32_t handle = idx != -1 && client_at(idx)->active ? client_at(idx)->handle : -1;
+    pthread_rwlock_unlock(&index_lock);
+    return handle;
+}
+
+void set_client_in_lobby(int32_t handle) {
+    Client *client = acquire_client(handle);
+    if (!client) return;
+    set_client_game_id(client, 0);
+    release_client();
+}
+
+/*
+ * Frames the message (CallType, payload size, payload) and queues it on the client's outbound queue.
+ * Never blocks: returns 0 if the client is gone or too far behind, the payload size otherwise.
+ */
+static OutFrame *frame_payload(CallType calltype, const uint8_t *payload, size_t payload_size) {
+    OutFrame *frame = out_frame_new(FRAME_HEADER_SIZE + payload_size);
+    if (!frame) return NULL;
+    frame_write_header(frame->data, calltype, (uint32_t) payload_size);
+    memcpy(frame->data + FRAME_HEADER_SIZE, payload, payload_size);
+    return frame;
+}
+
+size_t send_payload(CallType calltype, uint8_t *payload, size_t payload_size, int32_t handle) {
+    OutFrame *frame = frame_payload(calltype, payload, payload_size);
+    if (!frame) return 0;
+
+    Client *client = acquire_client(handle);
+    if (!client) {
+        out_frame_release(frame);
+        return 0;
     }
+    int queued = out_queue_send(&client->out, client->fd, frame);
+    release_client();
+    return queued < 0 ? 0 : payload_size;
 }
 
-Player heap_extract_max(MaxHeap *h) {
-    Player max = h->data[0];
-    h->data[0] = h->data[h->size - 1];
-    h->size--;
-    heapify_down(h, 0);
-    return max;
+// Frame of the message in protocol @version, NULL if it could not be encoded
+static OutFrame *frame_message(CallType calltype, const Message *message, int version) {
+    uint8_t payload[MAX_MESSAGE_SIZE];
+    int size = encode_Message(calltype, 0, version, message, payload, sizeof(payload));
+    if (size < 0) {
+        printf("Could not encode CallType %d\n", calltype);
+        return NULL;
+    }
+    return frame_payload(calltype, payload, (size_t) size);
 }
 
-char *print_ranking(MaxHeap *h) {
-    int rank = 1;
-    char buffer[1024] = {0};
-    while (h->size > 0) {
-        Player p = heap_extract_max(h);
-        char line[64];
-        line = snprintf(line, sizeof(line), "%der - joueur id %d - victoires : %d\n", rank, p.id, p.wins);
-        // we add the line to the buffer
-        strcat(buffer, line);
-        rank++;
+/*
+ * Encodes the message in the protocol version of the client, then queues it.
+ * Returns 0 if it could not be sent, the payload size otherwise.
+ */
+size_t send_message(CallType calltype, const Message *message, int32_t handle) {
+    Client *client = acquire_client(handle);
+    if (!client) return 0;
+    OutFrame *frame = frame_message(calltype, message, client->version);
+    if (!frame) {
+        release_client();
+        return 0;
     }
-    return strdup(buffer);
+    size_t payload_size = frame->size - FRAME_HEADER_SIZE;
+    int queued = out_queue_send(&client->out, client->fd, frame);
+    release_client();
+    return queued < 0 ? 0 : payload_size;
 }
 
-//##################
+// Sends a message made of one integer
+size_t send_int_message(CallType calltype, int value, int32_t handle) {
+    Message message;
+    message.ints[0] = value;
+    return send_message(calltype, &message, handle);
+}
 
+size_t send_error(CallType calltype, const char *error_msg, int32_t handle) {
+    Message message;
+    // the CallType that failed, then the explanation
+    message.ints[0] = calltype;
+    snprintf(message.text, sizeof(message.text), "%s", error_msg);
+    return send_message(ERROR, &message, handle);
+}
+
+
+// ---------------------- GAME LOGIC ---------------------- //
+/*
+ * A game is a state machine: it never blocks and only reacts to GameEvents.
+ * All the events of a game are posted to the same scheduler worker (selected by the game id),
+ * so the moves of a game are serialized while thousands of games share a few threads.
+ * The instance needs no lock of its own: only that worker writes it, games_mutex only guards the game table.
+ */
 typedef struct {
-    int fd;
-    int user_id;
-    char username[USERNAME_SIZE + 1];
-    int active;
-    int in_game;
-    int nb_of_pending_challenges;
-    int *pending_challenge_from_user_fd;
-} Client;
+    Game *game;
+    int running;
+    int game_id; // slab handle, names the game inside the server
+    int number; // shown to the users (LIST_ONGOING_GAMES, WATCH_GAME), see find_game_id_by_number()
+    uint8_t tours;
+    int move_made;
+    int plies; // moves played, each one logged as soon as it is played
+    uint32_t log_id; // of the game in the game log, 0 when the games are not kept
+    time_t started;
+    int32_t *watchers_handle; // clients watching the game
+    int *watchers_user_id;
+    int num_watchers;
+    int watchers_capacity;
+    OutFrame *snapshot; // GAME_SNAPSHOT of the current position, built for the first watcher joining after a move
+} GameInstance;
 
-Client clients[MAX_CLIENTS];
+typedef enum {
+    GAME_EVENT_START,
+    GAME_EVENT_CALL, // a call sent by one of the players
+    GAME_EVENT_DISCONNECT, // one of the players closed its connection
+    GAME_EVENT_ADD_WATCHER,
+    GAME_EVENT_REMOVE_WATCHER
+} GameEventType;
 
-pthread_mutex_t clients_mutex = PTHREAD_MUTEX_INITIALIZER;
+typedef struct {
+    GameEventType type;
+    int game_id;
+    int32_t client; // handle of the client that triggered the event, -1 for the server
+    int user_id;
+    CallType call_type;
+    Message *message; // decoded call of a GAME_EVENT_CALL, NULL otherwise
+} GameEvent;
+
+// Game table: the id of a game is its slab handle, so the id of a finished game is never mistaken for a new one
+static Slab game_slab;
+static pthread_mutex_t games_mutex = PTHREAD_MUTEX_INITIALIZER;
+/*
+ * The users name a game by a short number instead, drawn from a counter so that the number of a finished game is not
+ * given to the next one, and mapped to the id of the running game (same open-addressing map as the user index).
+ */
+static UserIndex games_by_number;
+static int next_game_number = 1;
+
+// The instance is complete before the lobby can list it
+GameInstance *alloc_game(Game *game) {
+    GameInstance *g = NULL;
+    pthread_mutex_lock(&games_mutex);
+    int32_t game_id = slab_alloc(&game_slab, (void **) &g);
+    if (game_id != -1 && user_index_put(&games_by_number, next_game_number, game_id) < 0) {
+        slab_free(&game_slab, game_id);
+        game_id = -1;
+    }
+    if (game_id != -1) {
+        memset(g, 0, sizeof(GameInstance));
+        g->game_id = game_id;
+        g->number = next_game_number;
+        next_game_number = next_game_number == INT32_MAX ? 1 : next_game_number + 1;
+        g->game = game;
+        g->started = time(NULL);
+        g->running = 1;
+        g->tours = 0;
+        g->move_made = -1;
+        g->watchers_handle = NULL; // grown when watchers join
+        g->watchers_user_id = NULL;
+        g->watchers_capacity = 0;
+        g->num_watchers = 0;
+    }
+    pthread_mutex_unlock(&games_mutex);
+    return game_id != -1 ? g : NULL;
+}
 
-int find_client_index_by_fd(int fd) {
-    for (int i = 0; i < MAX_CLIENTS; ++i) {
-        if (clients[i].active && clients[i].fd == fd) return i;
+void free_game(GameInstance *g) {
+    if (!g) {
+        return;
     }
-    return -1;
+    pthread_mutex_lock(&games_mutex);
+    out_frame_release(g->snapshot);
+    g->snapshot = NULL;
+    free(g->watchers_handle);
+    free(g->watchers_user_id);
+    free(g->game);
+    g->game = NULL;
+    user_index_remove(&games_by_number, g->number, g->game_id);
+    slab_free(&game_slab, g->game_id);
+    pthread_mutex_unlock(&games_mutex);
 }
 
-void remove_client_by_index(int idx) {
-    if (idx < 0 || idx >= MAX_CLIENTS) return;
+// Only the worker owning the game frees it, so the returned instance stays valid while this worker uses it.
+// Returns NULL for the id of a finished game.
+static GameInstance *find_game_by_id(int game_id) {
+    pthread_mutex_lock(&games_mutex);
+    GameInstance *found = slab_get(&game_slab, game_id);
+    pthread_mutex_unlock(&games_mutex);
+    return found;
+}
 
-    pthread_mutex_lock(&clients_mutex);
+// Id of the running game shown to the users as @number, -1 if there is none
+static int find_game_id_by_number(int number) {
+    if (number <= 0) return -1;
+    pthread_mutex_lock(&games_mutex);
+    int game_id = user_index_get(&games_by_number, number);
+    pthread_mutex_unlock(&games_mutex);
+    return game_id;
+}
 
-    if (!clients[idx].active) {
-        pthread_mutex_unlock(&clients_mutex);
-        return;
+
+// Wins of every player, updated by the game workers when a game ends
+static Ranking ranking;
+static pthread_mutex_t ranking_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Accounts of the players (id, bio, statistics), kept across restarts when the server has a data directory
+static UserStore users;
+// Encoded profiles of the users, answering CONSULT_USER_PROFILE
+static ProfileCache profiles;
+// Games, logged move by move when the server has a data directory
+static GameLog game_log;
+
+static void record_result(int user_id, int won, int score) {
+    pthread_mutex_lock(&ranking_mutex);
+    if (ranking_record_result(&ranking, user_id, won) < 0) {
+        fprintf(stderr, "Could not record the result of user %d in the ranking\n", user_id);
+    }
+    pthread_mutex_unlock(&ranking_mutex);
+    leaderboard_changed();
+    // the bot has no account
+    if (user_id != BOT_USER_ID && user_store_record_game(&users, user_id, won, score) == 0) {
+        profile_cache_invalidate(&profiles, user_id);
     }
+}
+
+/*
+ * Every way a game ends goes through it, @winner is 1 or 2, 0 for a draw.
+ * @abandoned when the loser left the game.
+ */
+static void record_game_results(GameInstance *g, int winner, int abandoned) {
+    record_result(g->game->player1.user_id, winner == 1, g->game->player1.score);
+    record_result(g->game->player2.user_id, winner == 2, g->game->player2.score);
+
+    game_log_end(&game_log, g->log_id, (uint32_t) (time(NULL) - g->started), winner, abandoned, (uint32_t) g->plies);
+}
+
+static void rank_stored_user(const StoredUser *user, void *arg) {
+    ranking_set(arg, user->id, user->total_wins, user->total_games);
+}
 
-    close(clients[idx].fd);
+static void process_game_event(void *arg);
 
-    if (clients[idx].pending_challenge_from_user_fd) {
-        free(clients[idx].pending_challenge_from_user_fd);
-        clients[idx].pending_challenge_from_user_fd = NULL;
+// The event takes ownership of @message, which is freed as well when the event cannot be posted (out of memory: -1)
+int post_game_event(int game_id, GameEventType type, int32_t client, int user_id, CallType call_type,
+                    Message *message) {
+    GameEvent *e = malloc(sizeof(GameEvent));
+    if (!e) {
+        free(message);
+        fprintf(stderr, "Event %d of game %d dropped, out of memory\n", type, game_id);
+        return -1;
     }
+    e->type = type;
+    e->game_id = game_id;
+    e->client = client;
+    e->user_id = user_id;
+    e->call_type = call_type;
+    e->message = message;
+    if (scheduler_post((unsigned int) game_id, process_game_event, e) < 0) {
+        free(message);
+        free(e);
+        fprintf(stderr, "Event %d of game %d dropped, out of memory\n", type, game_id);
+        return -1;
+    }
+    return 0;
+}
 
-    clients[idx].active = 0;
-    clients[idx].in_game = 0;
-    clients[idx].nb_of_pending_challenges = 0;
-    clients[idx].fd = -1;
+// Called by the fan-out thread for every watcher
+static void deliver_to_watcher(int32_t handle, OutFrame *const *frames) {
+    Client *client = acquire_client(handle);
+    if (!client) return;
+    OutFrame *frame = frames[client->version == PROTOCOL_V1 ? 0 : 1];
+    if (frame) {
+        out_frame_retain(frame);
+        out_queue_send(&client->out, client->fd, frame);
+    }
+    release_client();
+}
 
-    pthread_mutex_unlock(&clients_mutex);
+// The message is encoded once per protocol version, the fan-out thread queues it for every watcher
+static void notify_watchers(GameInstance *g, CallType type, int value) {
+    if (g->num_watchers == 0) return;
+    Message message;
+    memset(&message, 0, sizeof(message));
+    message.ints[0] = value;
+    OutFrame *frames[FANOUT_VERSIONS] = {frame_message(type, &message, PROTOCOL_V1),
+                                         frame_message(type, &message, PROTOCOL_V2)};
+    fanout_post(frames, g->watchers_handle, g->num_watchers);
+    printf("Sent %s to %d watchers of game %d\n", describe_CallType(type)->name, g->num_watchers, g->game_id);
 }
 
-size_t send_payload(CallType calltype, uint8_t *payload, size_t payload_size, int fd) {
-    send(fd, &calltype, sizeof(CallType), 0);
-    send(fd, &payload_size, sizeof(uint32_t), 0);
-    return send(fd, payload, payload_size, 0);
+// Both players go back to the lobby and the game instance is released
+static void end_game(GameInstance *g) {
+    g->running = 0;
+    set_client_in_lobby(g->game->player1.handle);
+    set_client_in_lobby(g->game->player2.handle);
+    free_game(g);
 }
 
-size_t send_error(CallType calltype, const char *error_msg, int fd) {
-    size_t msg_len = strlen(error_msg) + 1;
-    size_t total_size = sizeof(CallType) + msg_len;
+// Opening book mapped at startup, read by the game workers without any lock (the mapping is read-only)
+static Book book;
 
-    uint8_t buffer[total_size];
+static void on_player_disconnected(GameInstance *g, int user_id);
 
-    // Copie du calltype d’origine
-    memcpy(buffer, &calltype, sizeof(CallType));
+// The bot cannot play on: it leaves the game, which ends for its opponent like any abandon
+static void bot_leaves_game(GameInstance *g, const char *reason) {
+    fprintf(stderr, "Game %d: the bot gives up (%s)\n", g->game_id, reason);
+    on_player_disconnected(g, BOT_USER_ID);
+}
 
-    // Copie du message d’erreur juste après
-    memcpy(buffer + sizeof(CallType), error_msg, msg_len);
+// The move of the bot reaches its game like the one of any player, as a PLAY_MADE from its client slot
+static int post_bot_move(int game_id, int32_t bot, int bot_move) {
+    Message *move = malloc(sizeof(Message));
+    if (!move) return -1;
+    move->ints[0] = bot_move;
+    return post_game_event(game_id, GAME_EVENT_CALL, bot, BOT_USER_ID, PLAY_MADE, move);
+}
 
-    return send_payload(ERROR, buffer, total_size, fd);
+// Runs on a bot search thread; if the game ended meanwhile, its worker drops the move (stale game handle)
+static void on_bot_move_found(const BotSearchJob *job, int move) {
+    if (post_bot_move(job->game_id, job->bot, move) < 0) {
+        fprintf(stderr, "Game %d: the move of the bot is lost, out of memory\n", job->game_id);
+    }
 }
 
+/*
+ * The bot plays from the book on the worker of the game, a lookup being cheap. Otherwise the worker hands the position
+ * to a bot search thread and goes on with its other games; the move found comes back as a PLAY_MADE of the bot.
+ */
+static void play_bot_move(GameInstance *g) {
+    int bot_player = (g->tours % 2 == 0) ? 1 : 2;
+    if (!legalMoves(g->game, bot_player)) {
+        bot_leaves_game(g, "no legal move");
+        return;
+    }
+    Player bot = (g->tours % 2 == 0) ? g->game->player1 : g->game->player2;
+    AiPosition position = aiPositionOfGame(g->game, g->tours);
+    BookEntry entry;
+    if (bookLookup(&book, aiHash(&position), &entry) == 0 && isLegalMove(g->game, bot_player, entry.move)) {
+        // an entry of a corrupted or mismatched book is not trusted, the bot searches instead
+        printf("Game %d: bot plays %d from the book (depth %d, value %d)\n", g->game_id, entry.move, entry.depth, entry.value);
+        if (post_bot_move(g->game_id, bot.handle, entry.move) < 0) bot_leaves_game(g, "out of memory");
+        return;
+    }
+    BotSearchJob job = {
+        .game_id = g->game_id,
+        .bot = bot.handle,
+        .game = *g->game,
+        .tours = g->tours,
+        .limits = {server_config.bot_max_nodes, server_config.bot_max_time_ms, 0}
+    };
+    // refused when out of memory, or once the server shuts down
+    if (bot_search_post(&job) < 0) bot_leaves_game(g, "its search could not be queued");
+}
 
-// ---------------------- GAME LOGIC ---------------------- //
-typedef struct {
-    Game *game;
-    int running;
-    int game_id;
-    pthread_t thread;
-    pthread_mutex_t mutex;
-    int *watchers_fd;
-    int *watchers_user_id;
-    int num_watchers;
-} GameInstance;
+// Sends YOUR_TURN (with the last move) to the player who has to play, and the last move to the watchers
+static void send_turn(GameInstance *g) {
+    Player current_player = (g->tours % 2 == 0) ? g->game->player1 : g->game->player2;
+    if (current_player.user_id == BOT_USER_ID) {
+        notify_watchers(g, PLAY_MADE_WATCHER, g->move_made);
+        play_bot_move(g);
+        return;
+    }
+    if (send_int_message(YOUR_TURN, g->move_made, current_player.handle) <= 0) {
+        // the reactor will notice the disconnection and post a GAME_EVENT_DISCONNECT
+        printf("Could not send YOUR_TURN to player %d for game %d\n", current_player.user_id, g->game_id);
+        return;
+    }
+    printf("Sent YOUR_TURN to player %d for game %d\n", current_player.user_id, g->game_id);
+    // also send to watchers
+    notify_watchers(g, PLAY_MADE_WATCHER, g->move_made);
+}
 
-static GameInstance *games[MAX_GAMES] = {0};
-static int next_game_id = 1;
-
-GameInstance *alloc_game(void) {
-    for (int i = 0; i < MAX_GAMES; ++i) {
-        if (games[i] == NULL) {
-            GameInstance *g = calloc(1, sizeof(GameInstance));
-            g->game_id = next_game_id++;
-            pthread_mutex_init(&g->mutex, NULL);
-            g->running = 1;
-            g->watchers_fd = malloc((MAX_CLIENTS - 2) * sizeof(int)); // max watchers is total clients minus 2 players
-            g->watchers_user_id = malloc((MAX_CLIENTS - 2) * sizeof(int)); // max watchers is total clients minus 2 players
-            g->num_watchers = 0;
-            games[i] = g;
-            return g;
-        }
+static void on_player_disconnected(GameInstance *g, int user_id) {
+    int32_t opponent = (user_id == g->game->player1.user_id) ? g->game->player2.handle : g->game->player1.handle;
+    printf("Player %d disconnected, ending game %d\n", user_id, g->game_id);
+
+    GAME_OVER_REASON gameOverReason = OPPONENT_DISCONNECTED;
+    send_int_message(GAME_OVER, gameOverReason, opponent);
+    // notify watchers
+    notify_watchers(g, GAME_OVER_WATCHER, gameOverReason);
+    // the game counts as lost by the player who left
+    record_game_results(g, user_id == g->game->player1.user_id ? 2 : 1, 1);
+    end_game(g);
+}
+
+static void on_game_chat(GameInstance *g, GameEvent *e) {
+    Message *message = e->message;
+    message->text[MAX_CHAT_MESSAGE_SIZE - 1] = '\0';
+    printf("Game %d chat from player %d: %s\n", g->game_id, e->user_id, message->text);
+
+    // Forward to opponent
+    int32_t opponent = (e->client == g->game->player1.handle) ? g->game->player2.handle : g->game->player1.handle;
+    int sender_id = e->user_id;
+
+    // Find sender username
+    memset(message->username, 0, sizeof(message->username));
+    Client *sender = acquire_client(e->client);
+    if (sender) {
+        strncpy(message->username, sender->username, USERNAME_SIZE);
+        release_client();
     }
-    return NULL;
+
+    // the received message is forwarded with the sender
+    message->ints[0] = sender_id;
+    send_message(RECEIVE_GAME_CHAT, message, opponent);
 }
 
-void free_game(GameInstance *g) {
-    if (!g) {
+static void on_allow_watcher(GameInstance *g, GameEvent *e) {
+    int watcher_user_id = e->message->ints[0];
+    int answer = e->message->ints[1];
+    // then fetch the watcher, which must be in the lobby
+    Client *watcher = acquire_client(find_client_handle_by_user_id(watcher_user_id));
+    int32_t watcher_handle = -1;
+    if (watcher) {
+        if (client_game_id(watcher) == 0) watcher_handle = watcher->handle;
+        release_client();
+    }
+    if (watcher_handle == -1) {
+        printf("Watcher %d not found or is in game\n", watcher_user_id);
         return;
     }
-    for (int i = 0; i < MAX_GAMES; ++i) {
-        if (games[i] == g) {
-            games[i] = NULL;
+    // then checks if he had previously been accepted by the other player
+    for (int i = 0; i < g->num_watchers; i++) {
+        if (g->watchers_user_id[i] == watcher_user_id) {
+            printf("Watcher %d was already accepted to watch game %d\n", watcher_user_id, g->game_id);
             break;
         }
     }
-    pthread_mutex_destroy(&g->mutex);
-    free(g);
+    printf("Game %d player %d answered %d to watcher %d\n", g->game_id, e->user_id, answer, watcher_user_id);
+    // we send him the answer
+    send_int_message(WATCH_GAME_ANSWER, answer, watcher_handle);
 }
 
+// Applies the move of the current player, then either ends the game or gives the turn to the other player
+static void on_play_made(GameInstance *g, GameEvent *e) {
+    Player current_player = (g->tours % 2 == 0) ? g->game->player1 : g->game->player2;
+    if (e->client != current_player.handle) {
+        printf("Game %d: player %d played out of turn. Ignored.\n", g->game_id, e->user_id);
+        return;
+    }
+    int move = e->message->ints[0];
+    int player = (g->tours % 2 == 0) ? 1 : 2;
+    printf("Game %d received move %d from player %d\n", g->game_id, move, current_player.user_id);
+
+    // the move is validated before touching the board, the player keeps the turn and can play again
+    int points = playMove(g->game, player, move);
+    if (points < 0) {
+        printf("Game %d: illegal move %d from player %d. Rejected.\n", g->game_id, move, e->user_id);
+        if (e->user_id == BOT_USER_ID) {
+            // the bot has no connection to receive the error, nor another move to offer
+            bot_leaves_game(g, "illegal move");
+            return;
+        }
+        send_error(PLAY_MADE, "Illegal move: pick a non-empty pit, that feeds your opponent if their row is empty.", e->client);
+        return;
+    }
+    g->move_made = move;
+    // logged right away, a game cut short by a crash keeps its moves
+    game_log_move(&game_log, g->log_id, (uint32_t) g->plies++, move);
+    // the next watcher to join gets the new position
+    out_frame_release(g->snapshot);
+    g->snapshot = NULL;
+    if (player == 1) {
+        g->game->player1.score += points;
+    } else {
+        g->game->player2.score += points;
+    }
+    printf("SCORE : Player 1: %d | Player 2: %d  (game %d)\n", g->game->player1.score, g->game->player2.score, g->game_id);
+
+    // then checks for win conditions
+    GAME_OVER_REASON win = WIN;
+    GAME_OVER_REASON lose = LOSE;
+    PackedBoard board = packBoard(g->game->board);
+    int winner = gameWinner(&board, g->game->player1.score, g->game->player2.score);
+    if (winner == 1) {
+        printf("\n---------------- PLAYER 1 WON !!! --------------\n");
+        send_int_message(GAME_OVER, win, g->game->player1.handle);
+        send_int_message(GAME_OVER, lose, g->game->player2.handle);
+        // also notify watchers
+        notify_watchers(g, GAME_OVER_WATCHER, win);
+        record_game_results(g, 1, 0);
+        end_game(g);
+        return;
+    }
+    if (winner == 2) {
+        printf("\n---------------- PLAYER 2 WON !!! --------------\n");
+        send_int_message(GAME_OVER, lose, g->game->player1.handle);
+        send_int_message(GAME_OVER, win, g->game->player2.handle);
+        record_game_results(g, 2, 0);
+        // also notify watchers
+        notify_watchers(g, GAME_OVER_WATCHER, lose);
+        end_game(g);
+        return;
+    }
 
-// ranking heap
-MaxHeap *h = NULL;
+    g->tours++;
+    if (g->tours > MAX_ROUNDS) {
+        GAME_OVER_REASON gameOverReason = DRAW;
+        send_int_message(GAME_OVER, gameOverReason, g->game->player1.handle);
+        send_int_message(GAME_OVER, gameOverReason, g->game->player2.handle);
+        // also notify watchers
+        notify_watchers(g, GAME_OVER_WATCHER, gameOverReason);
+        printf("Game %d ended in a draw due to max rounds reached\n", g->game_id);
+        record_game_results(g, 0, 0);
+        end_game(g);
+        return;
+    }
+    send_turn(g);
+}
 
-void *game_thread(void *arg) {
-    GameInstance *g = arg;
+// Move of the opening book for the player whose turn it is, 0 when the position is not in the book
+static void on_suggest_move(GameInstance *g, GameEvent *e) {
+    Player current_player = (g->tours % 2 == 0) ? g->game->player1 : g->game->player2;
+    if (e->client != current_player.handle) {
+        send_error(SUGGEST_MOVE, "Moves are only suggested on your turn.", e->client);
+        return;
+    }
+    AiPosition position = aiPositionOfGame(g->game, g->tours);
+    BookEntry entry;
+    Message answer;
+    answer.ints[0] = 0;
+    answer.ints[1] = 0;
+    int player = (g->tours % 2 == 0) ? 1 : 2;
+    if (bookLookup(&book, aiHash(&position), &entry) == 0 && isLegalMove(g->game, player, entry.move)) {
+        answer.ints[0] = entry.move;
+        answer.ints[1] = entry.value;
+    }
+    send_message(SUGGEST_MOVE, &answer, e->client);
+}
 
-    uint8_t tours = 0;
-    size_t n;
-    int move_made = -1;
-    while (g->running && tours <= MAX_ROUNDS) {
-        Player current_player = (tours % 2 == 0) ? g->game->player1 : g->game->player2;
-        uint8_t *payload = malloc(sizeof(uint32_t));
-        write_int32_le(payload, 0, move_made);
-        n = send_payload(YOUR_TURN, payload, sizeof(move_made), current_player.fd);
-        printf("Sent YOUR_TURN to player fd %d for game %d\n", current_player.fd, g->game_id);
-        // also send to watchers
-        for (int w = 0; w < g->num_watchers; ++w) {
-            int watcher_fd = g->watchers_fd[w];
-            n = send_payload(PLAY_MADE_WATCHER, payload, sizeof(move_made), watcher_fd);
-            printf("Sent PLAY_MADE_WATCHER to watcher fd %d for game %d\n", watcher_fd, g->game_id);
+/*
+ * A new watcher gets the whole position in one message, then the moves like the other watchers.
+ * It goes through the fan-out thread as well, so it always arrives before the moves that follow it.
+ * PROTOCOL_V1 clients predate GAME_SNAPSHOT and only get the moves.
+ */
+static void send_snapshot(GameInstance *g, int32_t handle) {
+    if (!g->snapshot) {
+        Message message;
+        memset(&message, 0, sizeof(message));
+        for (int i = 0; i < 12; i++) {
+            message.board[i] = (uint8_t) g->game->board[i];
         }
+        message.ints[0] = g->game->player1.score;
+        message.ints[1] = g->game->player2.score;
+        message.ints[2] = g->tours; // moves played, player 1 plays when it is even
+        g->snapshot = frame_message(GAME_SNAPSHOT, &message, PROTOCOL_V2);
+        if (!g->snapshot) return;
+    }
+    out_frame_retain(g->snapshot);
+    OutFrame *frames[FANOUT_VERSIONS] = {NULL, g->snapshot};
+    fanout_post(frames, &handle, 1);
+}
 
-        free(payload);
-
-        if (n <= 0) {
-            printf("Player fd %d disconnected, ending game %d\n", current_player.fd, g->game_id);
-            int idx = find_client_index_by_fd(current_player.fd);
-            if (idx != -1) remove_client_by_index(idx);
-
-            int opponent_fd = (tours % 2 == 0) ? g->game->player2.fd : g->game->player1.fd;
-            int opp_idx = find_client_index_by_fd(opponent_fd);
-            if (opp_idx != -1) {
-                pthread_mutex_lock(&clients_mutex);
-                clients[opp_idx].in_game = 0;
-                pthread_mutex_unlock(&clients_mutex);
-
-                CallType go = GAME_OVER;
-                GAME_OVER_REASON gameOverReason = OPPONENT_DISCONNECTED;
-                send_payload(go, &gameOverReason, sizeof(gameOverReason), opponent_fd);
-                //send(opponent_fd, &go, sizeof(go), 0);
+static void add_watcher(GameInstance *g, int32_t handle, int user_id) {
+    if (g->num_watchers == g->watchers_capacity) {
+        int capacity = g->watchers_capacity ? g->watchers_capacity * 2 : 4;
+        int32_t *watchers_handle = realloc(g->watchers_handle, capacity * sizeof(int32_t));
+        if (watchers_handle) g->watchers_handle = watchers_handle;
+        int *watchers_user_id = realloc(g->watchers_user_id, capacity * sizeof(int));
+        if (watchers_user_id) g->watchers_user_id = watchers_user_id;
+        if (!watchers_handle || !watchers_user_id) {
+            printf("Could not add watcher %d to game %d: out of memory\n", user_id, g->game_id);
+            Client *client = acquire_client(handle);
+            if (client) {
+                // unless the client went on to watch another game meanwhile
+                int watched = g->game_id;
+                __atomic_compare_exchange_n(&client->watching_game_id, &watched, 0, 0, __ATOMIC_RELEASE,
+                                            __ATOMIC_RELAXED);
+                release_client();
             }
-            break;
+            send_error(WATCH_GAME, "Could not watch the game, the server is out of memory.", handle);
+            return;
         }
+        g->watchers_capacity = capacity;
+    }
+    g->watchers_user_id[g->num_watchers] = user_id;
+    g->watchers_handle[g->num_watchers] = handle;
+    g->num_watchers++;
+    send_snapshot(g, handle);
+}
 
-        // THEN WAIT FOR A MOVE FROM THAT PLAYER
-        CallType incoming;
-        n = recv(current_player.fd, &incoming, sizeof(incoming), 0);
-        if (n <= 0) {
-            printf("Player fd %d disconnected, ending game %d\n", current_player.fd, g->game_id);
-            int idx = find_client_index_by_fd(current_player.fd);
-            if (idx != -1) remove_client_by_index(idx);
-            int opponent_fd = (tours % 2 == 0) ? g->game->player2.fd : g->game->player1.fd;
-            int opp_idx = find_client_index_by_fd(opponent_fd);
-            if (opp_idx != -1) {
-                pthread_mutex_lock(&clients_mutex);
-                clients[opp_idx].in_game = 0;
-                pthread_mutex_unlock(&clients_mutex);
-
-                CallType go = GAME_OVER;
-                GAME_OVER_REASON gameOverReason = OPPONENT_DISCONNECTED;
-                send_payload(go, &gameOverReason, sizeof(gameOverReason), opponent_fd);
-                /*send(opponent_fd, &go, sizeof(go), 0);
-                send(opponent_fd, &gameOverReason, sizeof(gameOverReason), 0);*/
-
-                // notify watchers
-                for (int w = 0; w < g->num_watchers; ++w) {
-                    int watcher_fd = g->watchers_fd[w];
-                    send_payload(GAME_OVER_WATCHER, &gameOverReason, sizeof(gameOverReason), watcher_fd);
-                    printf("Sent GAME_OVER_WATCHER to watcher fd %d for game %d\n", watcher_fd, g->game_id);
-                }
+static void remove_watcher(GameInstance *g, int32_t handle, int user_id) {
+    for (int w = 0; w < g->num_watchers; w++) {
+        if (g->watchers_handle[w] == handle) {
+            // shift left
+            for (int k = w; k < g->num_watchers - 1; k++) {
+                g->watchers_handle[k] = g->watchers_handle[k + 1];
+                g->watchers_user_id[k] = g->watchers_user_id[k + 1];
             }
+            g->num_watchers--;
+            printf("Watcher %d exited watching game %d\n", user_id, g->game_id);
+            return;
+        }
+    }
+    printf("Watcher %d was not found in watchers of game %d\n", user_id, g->game_id);
+}
+
+// Handlers of the calls of the players during a game, indexed by CallType. They run on the worker owning the game.
+typedef void (*GameCallHandler)(GameInstance *g, GameEvent *e);
+
+static const GameCallHandler game_handlers[NB_CALL_TYPES] = {
+    [PLAY_MADE] = on_play_made,
+    [SEND_GAME_CHAT] = on_game_chat,
+    [ALLOW_WATCHER] = on_allow_watcher,
+    [SUGGEST_MOVE] = on_suggest_move,
+};
+
+/*
+ * Runs on the worker owning the game.
+ * Events posted after the end of the game find no instance and are dropped.
+ */
+static void process_game_event(void *arg) {
+    GameEvent *e = arg;
+    GameInstance *g = find_game_by_id(e->game_id);
+    if (g == NULL || !g->running) {
+        free(e->message);
+        free(e);
+        return;
+    }
+
+    switch (e->type) {
+        case GAME_EVENT_START:
+            // every entry of a game is queued by its worker, so they reach the log in order
+            g->log_id = game_log_start(&game_log, g->game->player1.user_id, g->game->player2.user_id,
+                                       (uint64_t) g->started);
+            send_turn(g);
             break;
+        case GAME_EVENT_CALL:
+            // only CallTypes with a game handler are forwarded
+            game_handlers[e->call_type](g, e);
+            break;
+        case GAME_EVENT_DISCONNECT:
+            on_player_disconnected(g, e->user_id);
+            break;
+        case GAME_EVENT_ADD_WATCHER:
+            add_watcher(g, e->client, e->user_id);
+            break;
+        case GAME_EVENT_REMOVE_WATCHER:
+            remove_watcher(g, e->client, e->user_id);
+            break;
+    }
+    free(e->message);
+    free(e);
+}
+
+// ---------------------- GAME LOGIC ---------------------- //
+
+
+// Decodes a request in the protocol version of the client. Malformed requests are logged and ignored.
+static int decode_request(int i, const Frame *frame, Message *message) {
+    if (decode_Message(frame->type, 1, client_at(i)->version, frame->payload, frame->payload_size, message) == 0) return 1;
+    printf("Malformed request %d from %s (id=%d): %u bytes payload. Ignored.\n", frame->type, client_at(i)->username,
+           client_at(i)->user_id, frame->payload_size);
+    return 0;
+}
+
+// Appends a formatted line to a list of MESSAGE_TEXT_SIZE bytes. Returns 0 (and appends nothing) when it is full.
+static int append_line(char *buffer, size_t *len, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(buffer + *len, MESSAGE_TEXT_SIZE - *len, format, args);
+    va_end(args);
+    if (n < 0 || (size_t) n >= MESSAGE_TEXT_SIZE - *len) {
+        buffer[*len] = '\0';
+        return 0;
+    }
+    *len += n;
+    return 1;
+}
+
+// Index of @challenger in the pending challenges of @client, -1 if it has not challenged the client
+static int find_pending_challenge(const Client *client, int32_t challenger) {
+    for (int k = 0; k < client->nb_of_pending_challenges; k++) {
+        if (client->pending_challenges[k] == challenger) return k;
+    }
+    return -1;
+}
+
+static void remove_pending_challenge(Client *client, int k) {
+    client->pending_challenges[k] = client->pending_challenges[--client->nb_of_pending_challenges];
+}
+
+/*
+ * Records a challenge of @challenger to @client, which can be answered once.
+ * Returns 1 if the challenger had already challenged the client, -1 if the challenge cannot be kept, 0 otherwise.
+ */
+static int add_pending_challenge(Client *client, int32_t challenger) {
+    if (find_pending_challenge(client, challenger) != -1) return 1;
+    if (client->nb_of_pending_challenges == MAX_PENDING_CHALLENGES) {
+        // the challengers who disconnected since make room
+        for (int k = client->nb_of_pending_challenges - 1; k >= 0; k--) {
+            if (!slab_get(&client_slab, client->pending_challenges[k])) remove_pending_challenge(client, k);
         }
+        if (client->nb_of_pending_challenges == MAX_PENDING_CHALLENGES) return -1;
+    }
+    if (client->nb_of_pending_challenges == client->pending_challenges_capacity) {
+        int capacity = client->pending_challenges_capacity ? client->pending_challenges_capacity * 2 : 4;
+        int32_t *challengers = realloc(client->pending_challenges, capacity * sizeof(int32_t));
+        if (!challengers) return -1;
+        client->pending_challenges = challengers;
+        client->pending_challenges_capacity = capacity;
+    }
+    client->pending_challenges[client->nb_of_pending_challenges++] = challenger;
+    return 0;
+}
 
-        if (incoming == SEND_GAME_CHAT) {
-            // Handle chat message
-            char message[MAX_CHAT_MESSAGE_SIZE] = {0};
-            n = recv(current_player.fd, message, MAX_CHAT_MESSAGE_SIZE, 0);
-            if (n <= 0) {
-                perror("recv chat message");
-                break;
-            }
+static void on_connect(int i, Message *m) {
+    char *username = m->username;
+    // the most recent version both sides speak
+    client_at(i)->version = m->version < PROTOCOL_V1 ? PROTOCOL_V1 : m->version > PROTOCOL_VERSION ? PROTOCOL_VERSION : m->version;
+    // a returning user gets back its id, bio and statistics
+    User user;
+    char bio[BIO_SIZE + 1];
+    int created = user_store_login(&users, username, &user, bio);
+    if (created < 0) {
+        send_error(CONNECT, "Your account could not be loaded.", client_at(i)->handle);
+        return;
+    }
+    pthread_rwlock_wrlock(&index_lock);
+    int other = user_index_get(&slots_by_user_id, user.id);
+    if (other != -1 && other != i) {
+        pthread_rwlock_unlock(&index_lock);
+        printf("User %s (%d) is already connected, socket %d refused\n", username, user.id, client_at(i)->fd);
+        send_error(CONNECT, "This user is already connected.", client_at(i)->handle);
+        return;
+    }
+    if (client_at(i)->user_id != 0) user_index_remove(&slots_by_user_id, client_at(i)->user_id, i);
+    client_at(i)->user_id = user.id;
+    user_index_put(&slots_by_user_id, user.id, i);
+    pthread_rwlock_unlock(&index_lock);
+    printf("%s connected: %s (%d) - socket %d - protocol v%d\n", created ? "New user" : "User", username, user.id,
+           client_at(i)->fd, client_at(i)->version);
+    strncpy(client_at(i)->username, username, USERNAME_SIZE);
+    pthread_mutex_lock(&ranking_mutex);
+    ranking_add(&ranking, client_at(i)->user_id);
+    pthread_mutex_unlock(&ranking_mutex);
+    leaderboard_changed();
+
+    Message confirm;
+    confirm.version = client_at(i)->version;
+    confirm.user = user;
+    send_message(CONNECT_CONFIRM, &confirm, client_at(i)->handle);
+}
 
-            printf("Game %d chat from player fd %d: %s\n", g->game_id, current_player.fd, message);
+// Starts the game between the clients @i and @target, in a random order
+static void start_game(int i, int target) {
+    // randomly decide who starts
+    srand((unsigned int) time(NULL));
+    int starter = rand() % 2; // 0 or 1
+    Player player1, player2;
+    if (starter) {
+        player1 = newPlayer(client_at(i)->user_id, client_at(i)->handle);
+        player2 = newPlayer(client_at(target)->user_id, client_at(target)->handle);
+    } else {
+        player1 = newPlayer(client_at(target)->user_id, client_at(target)->handle);
+        player2 = newPlayer(client_at(i)->user_id, client_at(i)->handle);
+    }
 
-            // Forward to opponent
-            Player opponent = (tours % 2 == 0) ? g->game->player2 : g->game->player1;
-            int sender_id = current_player.user_id;
+    // Create game instance
+    Game *game = newGame(&player1, &player2);
 
-            // Find sender username
-            char sender_username[USERNAME_SIZE + 1] = {0};
-            int sender_idx = find_client_index_by_fd(current_player.fd);
-            if (sender_idx != -1) {
-                pthread_mutex_lock(&clients_mutex);
-                strncpy(sender_username, clients[sender_idx].username, USERNAME_SIZE);
-                pthread_mutex_unlock(&clients_mutex);
-            }
+    // Then the game is handed over to the scheduler, which runs all its events on the same worker
+    GameInstance *g = game ? alloc_game(game) : NULL;
+    if (!g) {
+        // the clients are told before they wait for a CHALLENGE_START
+        fprintf(stderr, "No game slot available\n");
+        free(game);
+        send_error(CHALLENGE, "The game could not be started, the server is full.", client_at(i)->handle);
+        send_error(CHALLENGE, "The game could not be started, the server is full.", client_at(target)->handle);
+        return;
+    }
 
-            CallType out = RECEIVE_GAME_CHAT;
-            uint8_t buffer[sizeof(int) + USERNAME_SIZE + 1 + MAX_CHAT_MESSAGE_SIZE];
-            memcpy(buffer, &sender_id, sizeof(int));
-            memcpy(buffer + sizeof(int), sender_username, USERNAME_SIZE + 1);
-            memcpy(buffer + sizeof(int) + USERNAME_SIZE + 1, message, MAX_CHAT_MESSAGE_SIZE);
-
-            send_payload(out, buffer, sizeof(buffer), opponent.fd);
-
-            // Wait for PLAY_MADE again (chat doesn't count as a turn)
-            n = recv(current_player.fd, &incoming, sizeof(incoming), 0);
-            if (n <= 0) {
-                printf("Player fd %d disconnected after chat, ending game %d\n", current_player.fd, g->game_id);
-                int idx = find_client_index_by_fd(current_player.fd);
-                if (idx != -1) remove_client_by_index(idx);
-                int opponent_fd = (tours % 2 == 0) ? g->game->player2.fd : g->game->player1.fd;
-                int opp_idx = find_client_index_by_fd(opponent_fd);
-                if (opp_idx != -1) {
-                    pthread_mutex_lock(&clients_mutex);
-                    clients[opp_idx].in_game = 0;
-                    pthread_mutex_unlock(&clients_mutex);
-
-                    CallType go = GAME_OVER;
-                    GAME_OVER_REASON gameOverReason = OPPONENT_DISCONNECTED;
-                    send_payload(go, &gameOverReason, sizeof(gameOverReason), opponent_fd);
-                }
-                break;
-            }
+    // notify both clients that the challenge is starting now, with the name of their opponent
+    Message start;
+    memcpy(start.username, client_at(target)->username, USERNAME_SIZE + 1);
+    send_message(CHALLENGE_START, &start, client_at(i)->handle);
+    memcpy(start.username, client_at(i)->username, USERNAME_SIZE + 1);
+    send_message(CHALLENGE_START, &start, client_at(target)->handle);
+
+    // both clients are in the game before its first event can end it (the bot is never in game)
+    if (!client_at(i)->is_bot) set_client_game_id(client_at(i), g->game_id);
+    if (!client_at(target)->is_bot) set_client_game_id(client_at(target), g->game_id);
+    if (post_game_event(g->game_id, GAME_EVENT_START, -1, 0, 0, NULL) < 0) {
+        // no worker knows the game yet, it is dropped right away
+        set_client_game_id(client_at(i), 0);
+        set_client_game_id(client_at(target), 0);
+        send_error(CHALLENGE, "The game could not be started.", client_at(i)->handle);
+        send_error(CHALLENGE, "The game could not be started.", client_at(target)->handle);
+        free_game(g);
+        return;
+    }
+    printf("Game %d (id %d) created between %d and %d\n", g->number, g->game_id, g->game->player1.user_id,
+           g->game->player2.user_id);
+}
+
+static void on_challenge(int i, Message *m) {
+    CallType call_type = CHALLENGE;
+    int opponent_user_id = m->ints[0];
+    if (opponent_user_id == client_at(i)->user_id) {
+        printf("User %s (id=%d) attempted to challenge themselves. Ignored.\n",
+               client_at(i)->username, client_at(i)->user_id);
+        char error_msg[] = "You cannot challenge yourself.";
+        send_error(call_type, error_msg, client_at(i)->handle);
+        return;
+    }
+    // Find target client by user_id and send challenge
+    int target = find_client_index_by_user_id(opponent_user_id);
+    if (target != -1) {
+        // if a player is found, send challenge request except if he is already in a game
+        if (client_game_id(client_at(target))) {
+            printf("User %s (id=%d) attempted to challenge user %s (id=%d) who is already in a game. Ignored.\n",
+                   client_at(i)->username, client_at(i)->user_id, client_at(target)->username, client_at(target)->user_id);
+            char error_msg[] = "The player challenged is currently in a game.";
+            send_error(call_type, error_msg, client_at(i)->handle);
+            return;
         }
+        if (client_at(target)->is_bot) {
+            // the bot accepts every challenge right away
+            Message reply;
+            reply.ints[0] = BOT_USER_ID;
+            reply.ints[1] = 1;
+            send_message(CHALLENGE_REQUEST_ANSWER, &reply, client_at(i)->handle);
+            printf("Challenge of %s(id=%d) accepted by the bot\n", client_at(i)->username, client_at(i)->user_id);
+            start_game(target, i);
+            return;
+        }
+        int pending = add_pending_challenge(client_at(target), client_at(i)->handle);
+        if (pending != 0) {
+            send_error(call_type, pending > 0 ? "You already challenged this player, wait for the answer."
+                                              : "The player challenged has too many pending challenges.",
+                       client_at(i)->handle);
+            return;
+        }
+        printf("User %s (id=%d) has %d pending challenges.\n", client_at(target)->username, client_at(target)->user_id,
+               client_at(target)->nb_of_pending_challenges);
+        // the challenged user receives the id and username of the challenger
+        Message challenge;
+        challenge.ints[0] = client_at(i)->user_id;
+        memcpy(challenge.username, client_at(i)->username, USERNAME_SIZE + 1);
+        send_message(CHALLENGE, &challenge, client_at(target)->handle);
+        printf("Challenge initialized by de %s(id=%d) to %s(id=%d) | socket %d to bind\n",
+               client_at(i)->username, client_at(i)->user_id, client_at(target)->username, client_at(target)->user_id, client_at(target)->fd);
+    } else {
+        printf("Utilisateur %d introuvable pour challenge.\n", opponent_user_id);
+        char error_msg[] = "User not found or not online.";
+        int previous_call = CHALLENGE;
+        send_error(previous_call, error_msg, client_at(i)->handle);
+    }
+}
 
-        if (incoming == PLAY_MADE) {
-            // recv the move
-            n = recv(current_player.fd, &move_made, sizeof(move_made), 0);
-            printf("Game %d received move %d from player fd %d\n", g->game_id, move_made, current_player.fd);
-            if (n <= 0) {
-                perror("recv move");
-                break;
-            }
+static void on_challenge_request_answer(int i, Message *m) {
+    int request_user_id = m->ints[0];
+    int answer = m->ints[1];
+    // Find target client by user_id and send answer
+    int target = find_client_index_by_user_id(request_user_id);
+    if (target != -1) {
+        // only a challenge received can be answered, and only once
+        int pending = find_pending_challenge(client_at(i), client_at(target)->handle);
+        if (pending == -1) {
+            printf("User %s (id=%d) answered a challenge of %d that it did not receive. Ignored.\n",
+                   client_at(i)->username, client_at(i)->user_id, request_user_id);
+            send_error(CHALLENGE_REQUEST_ANSWER, "This player has not challenged you.", client_at(i)->handle);
+            return;
+        }
+        remove_pending_challenge(client_at(i), pending);
+        // if the player that initiated the challenge is playing a game now, we cannot send the answer and have to notify the challenged that the challenge he accepted no longer exists.
+        if (client_game_id(client_at(target))) {
+            char error_msg[] = "The player who challenged you is now in a game.";
+            int previous_call = CHALLENGE_REQUEST_ANSWER;
+            send_error(previous_call, error_msg, client_at(i)->handle);
+            return;
         }
 
-        if (incoming == ALLOW_WATCHER) {
-            int watcher_user_id;
-            if (recv(current_player.fd, &watcher_user_id, sizeof(int), 0) <= 0) {
-                perror("allow watcher autorisation");
-                break;
-            }
-            // then fetch watcher fd
-            int watcher_fd = -1;
-            for (int j = 0; j < MAX_CLIENTS; j++) {
-                if (clients[j].active && clients[j].user_id == watcher_user_id && !clients[j].in_game) {
-                    watcher_fd = clients[j].fd;
-                    break;
-                }
-            }
-            if (watcher_fd == -1) {
-                printf("Watcher %d not found or is in game\n", watcher_user_id);
-                break;
-            }
-            // we need to find the game of the player who answered
-
-            // then checks if he accepted or had previously been accepted by the other player
-            for (int i = 0; i < g->num_watchers; i++) {
-                if (g->watchers_fd[i] == watcher_user_id) {
-                    printf("Watcher %d was already accepted to watch game %d\n", watcher_user_id, g->game_id);
-                    break;
-                }
-            }
-            // then sends him the answer
-            int answer;
-            if (recv(current_player.fd, &answer, sizeof(int), 0) <= 0) {
-                perror("recv watcher answer");
-                break;
+        // send answer to selected challenger: the user_id of the challenged and the answer
+        Message reply;
+        reply.ints[0] = client_at(i)->user_id;
+        reply.ints[1] = answer;
+        send_message(CHALLENGE_REQUEST_ANSWER, &reply, client_at(target)->handle);
+        if (answer == 1) {
+            // challenge accepted -> notify awaiting challengers that were not selected (the rest of the list)
+            for (int k = 0; k < client_at(i)->nb_of_pending_challenges; k++) {
+                int32_t to_notify = client_at(i)->pending_challenges[k];
+                // the user_id of the challenged and the refusal
+                Message refusal;
+                refusal.ints[0] = client_at(i)->user_id;
+                refusal.ints[1] = 0;
+                send_message(CHALLENGE_REQUEST_ANSWER, &refusal, to_notify);
+                printf("Notified client %d that challenge to %s(id=%d) was refused due to another acceptance.\n",
+                       to_notify, client_at(i)->username, client_at(i)->user_id);
             }
-            printf("Game %d player fd %d answered %d to watcher %d\n", g->game_id, current_player.fd, answer, watcher_user_id);
-            CallType out = WATCH_GAME_ANSWER;
-            // we send him the answer
-            send_payload(out, &answer, sizeof(int), watcher_fd);
-            continue;
+            client_at(i)->nb_of_pending_challenges = 0;
+            printf("Challenge accepted by %s(id=%d) to %s(id=%d) | socket %d to bind\n",
+                   client_at(i)->username, client_at(i)->user_id, client_at(target)->username, client_at(target)->user_id, client_at(target)->fd);
+            start_game(i, target);
         }
+    } else {
+        printf("Utilisateur %d introuvable pour challenge.\n", request_user_id);
+        char error_msg[] = "User not found or not online.";
+        int previous_call = CHALLENGE_REQUEST_ANSWER;
+        send_error(previous_call, error_msg, client_at(i)->handle);
+    }
+}
 
-        // then process the move to update to board and scores
-        if (tours % 2 == 0) {
-            // if the first player played
-            int position_of_last_put_seed = moveSeeds(g->game, move_made - 1);
-            g->game->player1.score += collectSeedsAndCountPoints(g->game, position_of_last_put_seed, 1);
-            printf("SCORE : Player 1: %d | Player 2: %d  (game %d)\n", g->game->player1.score, g->game->player2.score, g->game_id);
-        } else {
-            // the second player made the last move
-            int position_of_last_put_seed = moveSeeds(g->game, move_made + 5);
-            g->game->player2.score += collectSeedsAndCountPoints(g->game, position_of_last_put_seed, 2);
-            printf("SCORE : Player 1: %d | Player 2: %d  (game %d)\n", g->game->player1.score, g->game->player2.score, g->game_id);
+static void on_list_users(int i, Message *m) {
+    Message list;
+    char *user_list_buffer = list.text;
+    user_list_buffer[0] = '\0';
+    size_t len = 0;
+    int client_count = 0;
+    for (int u = 0; u < client_slots(); u++) {
+        if (client_at(u)->active && client_at(u)->user_id != 0 && client_at(u)->fd != client_at(i)->fd) {
+            // the list stops at the size of a message
+            if (!append_line(user_list_buffer, &len, "%s (id = %d)%s\n", client_at(u)->username, client_at(u)->user_id,
+                             client_game_id(client_at(u)) ? " [IN GAME]" : "")) break;
+            client_count++;
         }
+    }
+    printf("Sending user list to %s (id=%d)\n", client_at(i)->username, client_at(i)->user_id);
+    if (client_count == 0) {
+        append_line(user_list_buffer, &len, "No other users online.\n");
+    }
+    send_message(LIST_USERS, &list, client_at(i)->handle);
+}
 
-        // then checks for win conditions
-        if (g->game->player1.score == WINNING_SCORE || playerSeedsLeft(g->game, 2) < 6) {
-            printf("\n---------------- PLAYER 1 WON !!! --------------\n");
-            CallType go = GAME_OVER;
-            CallType goWatcher = GAME_OVER_WATCHER;
-            GAME_OVER_REASON win = WIN;
-            GAME_OVER_REASON lose = LOSE;
-            send_payload(go, &win, sizeof(win), g->game->player1.fd);
-            send_payload(go, &lose, sizeof(lose), g->game->player2.fd);
-            // also notify watchers
-            for (int w = 0; w < g->num_watchers; ++w) {
-                int watcher_fd = g->watchers_fd[w];
-                send_payload(goWatcher, &win, sizeof(win), watcher_fd);
-                printf("Sent GAME_OVER_WATCHER to watcher fd %d for game %d\n", watcher_fd, g->game_id);
-            }
+static void on_list_ongoing_games(int i, Message *m) {
+    Message list;
+    char *games_list_buffer = list.text;
+    games_list_buffer[0] = '\0';
+    size_t len = 0;
+    int games_count = 0;
+    pthread_mutex_lock(&games_mutex);
+    for (size_t u = 0; u < slab_capacity(&game_slab); u++) {
+        GameInstance *g = slab_at(&game_slab, u);
+        if (slab_handle_at(&game_slab, u) != -1 && g->game != NULL) {
+            if (!append_line(games_list_buffer, &len, "Game %d: %d VS %d | %d - %d\n",
+                             g->number,
+                             g->game->player1.user_id,
+                             g->game->player2.user_id,
+                             g->game->player1.score,
+                             g->game->player2.score)) break;
+            games_count++;
+        }
+    }
+    pthread_mutex_unlock(&games_mutex);
+    printf("Sending games list to %s (id=%d)\n", client_at(i)->username, client_at(i)->user_id);
+    if (games_count == 0) {
+        append_line(games_list_buffer, &len, "No games are being played\n");
+    }
+    send_message(LIST_ONGOING_GAMES, &list, client_at(i)->handle);
+}
 
-            /*send(g->game->player1.fd, &go, sizeof(go), 0);
-            send(g->game->player1.fd, &win, sizeof(win), 0);
-            send(g->game->player2.fd, &go, sizeof(go), 0);
-            send(g->game->player2.fd, &lose, sizeof(lose), 0);*/
-            heap_update_wins(h, g->game->player1.user_id);
-
-            int idx1 = find_client_index_by_fd(g->game->player1.fd);
-            int idx2 = find_client_index_by_fd(g->game->player2.fd);
-            if (idx1 != -1) {
-                pthread_mutex_lock(&clients_mutex);
-                clients[idx1].in_game = 0;
-                pthread_mutex_unlock(&clients_mutex);
-            }
-            if (idx2 != -1) {
-                pthread_mutex_lock(&clients_mutex);
-                clients[idx2].in_game = 0;
-                pthread_mutex_unlock(&clients_mutex);
-            }
+static void on_exit_watch(int i, Message *m) {
+    CallType call_type = USER_WANTS_TO_EXIT_WATCH;
+    // we need to delete the user from the game he is watching
+    int game_id = find_game_id_by_number(m->ints[0]);
+    if (game_id == -1 || find_game_by_id(game_id) == NULL) {
+        printf("Game %d not found for watcher exit\n", m->ints[0]);
+        return;
+    }
+    // the watcher is removed by the worker running the game
+    if (post_game_event(game_id, GAME_EVENT_REMOVE_WATCHER, client_at(i)->handle, client_at(i)->user_id,
+                        call_type, NULL) < 0) {
+        send_error(call_type, "Could not stop watching the game, try again.", client_at(i)->handle);
+        return;
+    }
+    set_client_watching_game_id(client_at(i), 0);
+    printf("Watcher %s (id=%d) exits watching game %d\n", client_at(i)->username, client_at(i)->user_id, m->ints[0]);
+}
 
-            break;
-        }
-        if (g->game->player2.score == WINNING_SCORE || playerSeedsLeft(g->game, 1) < 6) {
-            printf("\n---------------- PLAYER 2 WON !!! --------------\n");
+static User bot_profile(void) {
+    User bot = {.id = BOT_USER_ID, .bio = "Computer opponent: challenge it to play right away."};
+    strncpy(bot.username, BOT_USERNAME, USERNAME_SIZE);
+    return bot;
+}
 
-            CallType go = GAME_OVER;
-            CallType goWatcher = GAME_OVER_WATCHER;
+// The bot is a client of its own, without connection, so that it is listed, challenged and consulted like the others
+static void register_bot(void) {
+    Client *bot;
+    int32_t handle = slab_alloc(&client_slab, (void **) &bot);
+    if (handle == -1) return;
+    int slot = slab_index_of(handle);
+    bot->slot = slot;
+    bot->handle = handle;
+    bot->is_bot = 1;
+    bot->fd = -1;
+    bot->user_id = BOT_USER_ID;
+    strncpy(bot->username, BOT_USERNAME, USERNAME_SIZE);
+    bot->active = 1;
+    bot->version = PROTOCOL_VERSION;
+    user_index_put(&slots_by_user_id, BOT_USER_ID, slot);
+    printf("Bot %s (id=%d) ready, budget %ld nodes / %d ms per move\n", BOT_USERNAME, BOT_USER_ID,
+           server_config.bot_max_nodes, server_config.bot_max_time_ms);
+}
 
-            GAME_OVER_REASON win = WIN;
-            GAME_OVER_REASON lose = LOSE;
-            send_payload(go, &lose, sizeof(lose), g->game->player1.fd);
-            send_payload(go, &win, sizeof(win), g->game->player2.fd);
+/*
+ * The profile of any user of the store, online or not, answered by the server itself: the payload is encoded once
+ * per protocol version and kept until the bio or the statistics of the user change.
+ */
+static int send_profile(int i, int user_id) {
+    uint8_t payload[MAX_MESSAGE_SIZE];
+    uint8_t version = client_at(i)->version;
+    uint32_t stamp;
+    long size = profile_cache_get(&profiles, user_id, version, payload, sizeof(payload), &stamp);
+    if (size < 0) {
+        Message profile;
+        if (user_store_get(&users, user_id, &profile.user, profile.bio) < 0) return -1;
+        int encoded = encode_Message(RECEIVE_USER_PROFILE, 0, version, &profile, payload, sizeof(payload));
+        if (encoded < 0) return -1;
+        size = encoded;
+        profile_cache_put(&profiles, user_id, version, payload, (size_t) size, stamp);
+    }
+    send_payload(RECEIVE_USER_PROFILE, payload, (size_t) size, client_at(i)->handle);
+    return 0;
+}
 
-            heap_update_wins(h, g->game->player2.user_id);
+static void on_consult_user_profile(int i, Message *m) {
+    int requested_user_id = m->ints[0];
+    if (requested_user_id == client_at(i)->user_id) {
+        printf("User %s (id = %d) attempted to request their own profile. Ignored.\n",
+               client_at(i)->username, client_at(i)->user_id);
+        char error_msg[] = "To view your own profile, press 1.";
+        int previous_call = CONSULT_USER_PROFILE;
 
+        send_error(previous_call, error_msg, client_at(i)->handle);
+        return;
+    }
+    int target = find_client_index_by_user_id(requested_user_id);
+    if (target != -1 && client_at(target)->is_bot) {
+        Message profile;
+        profile.user = bot_profile();
+        send_message(RECEIVE_USER_PROFILE, &profile, client_at(i)->handle);
+    } else if (send_profile(i, requested_user_id) < 0) {
+        printf("Utilisateur %d does not exist -> cannot send his profile\n", requested_user_id);
+        char error_msg[] = "User not found.";
+        int previous_call = CONSULT_USER_PROFILE;
+        send_error(previous_call, error_msg, client_at(i)->handle);
+    }
+}
 
-            // also notify watchers
-            for (int w = 0; w < g->num_watchers; ++w) {
-                int watcher_fd = g->watchers_fd[w];
-                send_payload(goWatcher, &lose, sizeof(win), watcher_fd);
-                printf("Sent GAME_OVER_WATCHER to watcher fd %d for game %d\n", watcher_fd, g->game_id);
-            }
-            /*send(g->game->player1.fd, &go, sizeof(go), 0);
-            send(g->game->player1.fd, &lose, sizeof(lose), 0);
-            send(g->game->player2.fd, &go, sizeof(go), 0);
-            send(g->game->player2.fd, &win, sizeof(win), 0);*/
+static void on_does_user_exist(int i, Message *m) {
+    int requested_user_id = m->ints[0];
+    int exists = 0;
+    if (requested_user_id == client_at(i)->user_id) {
+        printf("User %s (id = %d) attempted to request add themselves as friend. Ignored.\n",
+               client_at(i)->username, client_at(i)->user_id);
+        char error_msg[] = "You cannot add yourself as friend";
+        int previous_call = DOES_USER_EXIST;
 
-            break;
-        }
+        send_error(previous_call, error_msg, client_at(i)->handle);
+        return;
+    }
+    // online or not: the bot has no entry in the store, every other user has one
+    User user;
+    char bio[BIO_SIZE + 1];
+    exists = find_client_index_by_user_id(requested_user_id) != -1
+             || user_store_get(&users, requested_user_id, &user, bio) == 0;
+    printf("User existence check for id=%d by %s(id=%d): %s\n", requested_user_id, client_at(i)->username, client_at(i)->user_id,
+           exists ? "EXISTS" : "DOES NOT EXIST");
+    send_int_message(DOES_USER_EXIST, exists, client_at(i)->handle);
+}
+
+// A client sends its profile when its bio changes, the server keeps it
+static void on_sent_user_profile(int i, Message *m) {
+    if (user_store_set_bio(&users, client_at(i)->user_id, m->user.bio ? m->user.bio : "") < 0) return;
+    profile_cache_invalidate(&profiles, client_at(i)->user_id);
+    printf("Bio of %s (id=%d) updated\n", client_at(i)->username, client_at(i)->user_id);
+}
 
-        tours++;
+static void on_watch_game(int i, Message *m) {
+    CallType call_type = WATCH_GAME;
+    int game_id = find_game_id_by_number(m->ints[0]);
+    // first we need to check if the game exists
+    if (game_id == -1 || find_game_by_id(game_id) == NULL) {
+        printf("Client %d requested to watch non-existing game %d\n", client_at(i)->user_id, m->ints[0]);
+        char error_msg[] = "The requested game does not exist.";
+        send_error(call_type, error_msg, client_at(i)->handle);
+        return;
+    }
+    // then fetch players in the game and asks them to allow or not
+    // for now we do not handle multiple watchers or refusals, we just let the client watch directly
+    // so the worker running the game stores it in the game instance (set first: the worker clears it on failure)
+    int watched = client_watching_game_id(client_at(i));
+    set_client_watching_game_id(client_at(i), game_id);
+    if (post_game_event(game_id, GAME_EVENT_ADD_WATCHER, client_at(i)->handle, client_at(i)->user_id,
+                        call_type, NULL) < 0) {
+        set_client_watching_game_id(client_at(i), watched);
+        send_error(call_type, "Could not watch the game, try again.", client_at(i)->handle);
     }
+}
+
+static void on_lobby_chat(int i, Message *m) {
+    m->text[MAX_CHAT_MESSAGE_SIZE - 1] = '\0';
+    printf("Lobby chat from %s (id=%d): %s\n", client_at(i)->username, client_at(i)->user_id, m->text);
+
+    // Broadcast to all clients not in game (except sender), with the sender
+    m->ints[0] = client_at(i)->user_id;
+    memcpy(m->username, client_at(i)->username, USERNAME_SIZE + 1);
 
-    // we end the game by freeing the game instance but before that we need to set the clients as not in game anymore
-    int idx1 = find_client_index_by_fd(g->game->player1.fd);
-    int idx2 = find_client_index_by_fd(g->game->player2.fd);
-    if (idx1 != -1) {
-        pthread_mutex_lock(&clients_mutex);
-        clients[idx1].in_game = 0;
-        pthread_mutex_unlock(&clients_mutex);
+    for (int j = 0; j < client_slots(); j++) {
+        if (client_at(j)->active && client_at(j)->fd != client_at(i)->fd && !client_game_id(client_at(j))) {
+            send_message(RECEIVE_LOBBY_CHAT, m, client_at(j)->handle);
+        }
     }
-    if (idx2 != -1) {
-        pthread_mutex_lock(&clients_mutex);
-        clients[idx2].in_game = 0;
-        pthread_mutex_unlock(&clients_mutex);
+}
+
+// Endgame tablebase mapped at startup, read by the lobby without any lock (the mapping is read-only)
+static Tablebase tablebase;
+
+// Perfect answer for the endgame boards, only in the lobby: players cannot ask about their own game
+static void on_evaluate_position(int i, Message *m) {
+    int pits[12];
+    for (int p = 0; p < 12; p++) pits[p] = m->board[p];
+    PackedBoard board = packBoard(pits);
+    int value, best_move;
+    if (tablebaseEvaluate(&tablebase, &board, m->ints[0], &value, &best_move) < 0) {
+        char error_msg[ERROR_MESSAGE_SIZE];
+        if (!tablebase.values) snprintf(error_msg, sizeof(error_msg), "No endgame tablebase on this server.");
+        else snprintf(error_msg, sizeof(error_msg), "Only boards of at most %d seeds can be evaluated.", tablebase.max_seeds);
+        send_error(EVALUATE_POSITION, error_msg, client_at(i)->handle);
+        return;
     }
+    Message answer;
+    answer.ints[0] = value;
+    answer.ints[1] = best_move;
+    send_message(EVALUATE_POSITION, &answer, client_at(i)->handle);
+}
 
-    // envoyer un message aux deux joueurs pour indiquer la fin de la partie
+// A page of the leaderboard (ints: first rank from 0 and number of lines), with the rank of the requester
+static void on_consult_ranking(int i, Message *m) {
+    const RankingSnapshot *snapshot = leaderboard_current();
+    if (!snapshot) {
+        send_error(CONSULT_RANKING, "The ranking is not available.", client_at(i)->handle);
+        return;
+    }
+    size_t first = m->ints[0] > 0 ? (size_t) m->ints[0] : 0;
+    size_t lines = m->ints[1] > 0 ? (size_t) m->ints[1] : RANKING_PAGE_SIZE;
+    if (lines > RANKING_MAX_PAGE_SIZE) lines = RANKING_MAX_PAGE_SIZE;
+    Message answer;
+    answer.ints[0] = ranking_snapshot_rank(snapshot, client_at(i)->user_id);
+    answer.ints[1] = (int32_t) snapshot->count;
+    ranking_snapshot_page(snapshot, first, lines, answer.text, sizeof(answer.text));
+    send_message(CONSULT_RANKING, &answer, client_at(i)->handle);
+}
 
-    if (tours > MAX_ROUNDS) {
-        CallType go = GAME_OVER;
-        GAME_OVER_REASON gameOverReason = DRAW;
-        send_payload(go, &gameOverReason, sizeof(gameOverReason), g->game->player1.fd);
-        send_payload(go, &gameOverReason, sizeof(gameOverReason), g->game->player2.fd);
-        /*
-         *
-        send(g->game->player1.fd, &go, sizeof(go), 0);
-        send(g->game->player1.fd, &gameOverReason, sizeof(gameOverReason), 0);
-        send(g->game->player2.fd, &go, sizeof(go), 0);
-        send(g->game->player2.fd, &gameOverReason, sizeof(gameOverReason), 0);*/
-        CallType goWatcher = GAME_OVER_WATCHER;
-        // also notify watchers
-        for (int w = 0; w < g->num_watchers; ++w
-        ) {
-            int watcher_fd = g->watchers_fd[w];
-            send_payload(goWatcher, &gameOverReason, sizeof(gameOverReason), watcher_fd);
-            printf("Sent GAME_OVER_WATCHER to watcher fd %d for game %d\n", watcher_fd, g->game_id);
+/*
+ * Handlers of the requests of the clients in the lobby, indexed by CallType.
+ * A CallType without handler is ignored.
+ */
+typedef void (*LobbyHandler)(int i, Message *m);
+
+static const LobbyHandler lobby_handlers[NB_CALL_TYPES] = {
+    [CONNECT] = on_connect,
+    [CHALLENGE] = on_challenge,
+    [CHALLENGE_REQUEST_ANSWER] = on_challenge_request_answer,
+    [LIST_USERS] = on_list_users,
+    [LIST_ONGOING_GAMES] = on_list_ongoing_games,
+    [USER_WANTS_TO_EXIT_WATCH] = on_exit_watch,
+    [CONSULT_USER_PROFILE] = on_consult_user_profile,
+    [DOES_USER_EXIST] = on_does_user_exist,
+    [SENT_USER_PROFILE] = on_sent_user_profile,
+    [WATCH_GAME] = on_watch_game,
+    [CONSULT_RANKING] = on_consult_ranking,
+    [SEND_LOBBY_CHAT] = on_lobby_chat,
+    [EVALUATE_POSITION] = on_evaluate_position,
+};
+
+static int listener_fd = -1;
+// SIGINT and SIGTERM are read from it by the reactor, to stop the server between two events
+static int signal_fd = -1;
+
+// Accepts every pending connection (the listening socket is edge-triggered)
+static void accept_clients(void) {
+    while (1) {
+        int new_socket = accept(listener_fd, NULL, NULL);
+        if (new_socket < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) perror("accept failed");
+            return;
+        }
+        // the slots are allocated and freed under the write lock, so acquire_client() sees them consistently
+        pthread_rwlock_wrlock(&index_lock);
+        int32_t handle = slab_alloc(&client_slab, NULL);
+        pthread_rwlock_unlock(&index_lock);
+        if (handle == -1) {
+            printf("Server full, refusing connection on socket %d\n", new_socket);
+            close(new_socket);
+            continue;
+        }
+        int slot = slab_index_of(handle);
+        client_at(slot)->slot = slot;
+        client_at(slot)->handle = handle;
+        client_at(slot)->is_bot = 0;
+        client_at(slot)->fd = new_socket;
+        client_at(slot)->user_id = 0;
+        client_at(slot)->active = 1;
+        set_client_game_id(client_at(slot), 0);
+        set_client_watching_game_id(client_at(slot), 0);
+        client_at(slot)->version = PROTOCOL_V1; // until the client negotiates another one at CONNECT
+        client_at(slot)->nb_of_pending_challenges = 0;
+        // grown when challenges are received
+        client_at(slot)->pending_challenges = NULL;
+        client_at(slot)->pending_challenges_capacity = 0;
+        set_non_blocking(new_socket);
+        // the outbound queue already batches frames: Nagle would only hold the moves of the spectators, which never
+        // answer, until the delayed ACK (40 ms)
+        int nodelay = 1;
+        setsockopt(new_socket, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+        frame_buffer_init(&client_at(slot)->in);
+        // the clients released before the frames are still served, in PROTOCOL_V1
+        frame_buffer_accept_legacy(&client_at(slot)->in);
+        out_queue_open(&client_at(slot)->out, new_socket, server_config.max_outbound_bytes);
+        // EPOLLOUT is edge-triggered: it is only reported when a full socket becomes writable again
+        client_at(slot)->events = EPOLLIN | EPOLLOUT | EPOLLRDHUP;
+        if (reactor_add(new_socket, client_at(slot)->events, client_at(slot)) < 0) {
+            remove_client_by_index(slot);
         }
-        printf("Game %d ended in a draw due to max rounds reached\n", g->game_id);
     }
+}
 
-    free_game(g);
+// Closes the connection and lets the game (played or watched) know about it
+static void disconnect_client(int i) {
+    int32_t handle = client_at(i)->handle;
+    int fd = client_at(i)->fd;
+    int user_id = client_at(i)->user_id;
+    int game_id = client_game_id(client_at(i));
+    int watching_game_id = __atomic_exchange_n(&client_at(i)->watching_game_id, 0, __ATOMIC_ACQ_REL);
+    printf("Client fd %d disconnected (main loop)\n", fd);
+
+    remove_client_by_index(i);
+    if (game_id) {
+        post_game_event(game_id, GAME_EVENT_DISCONNECT, handle, user_id, 0, NULL);
+    }
+    if (watching_game_id) {
+        post_game_event(watching_game_id, GAME_EVENT_REMOVE_WATCHER, handle, user_id, 0, NULL);
+    }
+}
 
+/*
+ * Checks a request against the CallType table, decodes it, then runs its handler: the lobby handler, or for a player in
+ * a game, the game handler on the worker running the game. Nothing reaches a handler without being validated.
+ */
+static void dispatch_request(int i, const Frame *frame) {
+    const CallDescriptor *call = describe_CallType(frame->type);
+    if (!call || !(call->flags & CALL_TO_SERVER)) {
+        printf("Client fd %d sent unknown CallType %d. Ignored.\n", client_at(i)->fd, frame->type);
+        return;
+    }
 
-    return NULL;
+    int game_id = client_game_id(client_at(i));
+    if (game_id) {
+        if (!game_handlers[frame->type]) {
+            printf("Client fd %d sent %s during a game. Ignored.\n", client_at(i)->fd, call->name);
+            return;
+        }
+        // the message goes with the event to the worker
+        Message *message = malloc(sizeof(Message));
+        if (!message) return;
+        if (!decode_request(i, frame, message)) {
+            free(message);
+            return;
+        }
+        if (post_game_event(game_id, GAME_EVENT_CALL, client_at(i)->handle, client_at(i)->user_id, frame->type,
+                            message) < 0) {
+            send_error(frame->type, "The server is out of memory, try again.", client_at(i)->handle);
+        }
+        return;
+    }
+
+    if (!lobby_handlers[frame->type]) {
+        printf("Client fd %d sent %s outside of a game. Ignored.\n", client_at(i)->fd, call->name);
+        return;
+    }
+    Message message;
+    if (decode_request(i, frame, &message)) {
+        lobby_handlers[frame->type](i, &message);
+    }
 }
 
-// ---------------------- GAME LOGIC ---------------------- //
+/*
+ * Called by the reactor for every ready socket.
+ * Bytes are read until the socket is drained, as required by edge-triggered mode.
+ * Calls of players in a game are forwarded to the game scheduler, the others are handled by the lobby.
+ */
+static void on_server_event(void *ctx, uint32_t events) {
+    if (ctx == &listener_fd) {
+        accept_clients();
+        return;
+    }
+    if (ctx == &signal_fd) {
+        struct signalfd_siginfo info;
+        if (read(signal_fd, &info, sizeof(info)) == sizeof(info)) {
+            printf("Signal %u reçu, arrêt du serveur\n", info.ssi_signo);
+            reactor_stop();
+        }
+        return;
+    }
 
+    Client *client = ctx;
+    int i = client->slot;
+    if ((events & EPOLLOUT) && client->active && out_queue_flush(&client->out) < 0) {
+        disconnect_client(i);
+        return;
+    }
+    while (client->active) {
+        ssize_t n = frame_buffer_fill(&client->in, client->fd, MSG_DONTWAIT);
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            disconnect_client(i);
+            break;
+        }
+
+        // dispatch every complete frame, a single read can hold several of them
+        Frame frame;
+        int ret = 0;
+        while (client->active && (ret = frame_buffer_next(&client->in, &frame)) == 1) {
+            dispatch_request(i, &frame);
+        }
+        if (client->active && ret < 0) {
+            printf("Client fd %d sent an invalid frame\n", client->fd);
+            disconnect_client(i);
+        }
+    }
+}
+
+ServerConfig default_server_config(void) {
+    return (ServerConfig){
+        .port = PORT,
+        .max_clients = DEFAULT_MAX_CLIENTS,
+        .max_games = DEFAULT_MAX_GAMES,
+        .bot = 1,
+        .bot_max_nodes = 0,
+        .bot_max_time_ms = DEFAULT_BOT_TIME_MS,
+        .max_outbound_bytes = DEFAULT_MAX_OUTBOUND_BYTES,
+        .tablebase_path = NULL,
+        .book_path = NULL,
+        .data_dir = NULL
+    };
+}
 
-int start_server(void) {
+int start_server(const ServerConfig *config) {
     printf("🚀 Starting Awalnet server...\n");
     int server_fd;
     struct sockaddr_in address;
-    int addrlen = sizeof(address);
 
+    server_config = *config;
 
-    for (int i = 0; i < MAX_CLIENTS; i++) {
-        clients[i].active = 0;
+    // blocked before any thread starts so that every thread inherits the mask, the reactor reads them instead
+    sigset_t stop_signals;
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    sigaddset(&stop_signals, SIGTERM);
+    if (pthread_sigmask(SIG_BLOCK, &stop_signals, NULL) != 0
+        || (signal_fd = signalfd(-1, &stop_signals, SFD_NONBLOCK | SFD_CLOEXEC)) < 0) {
+        perror("signalfd");
+        exit(EXIT_FAILURE);
+    }
+
+    if (slab_init(&client_slab, sizeof(Client), server_config.max_clients, init_client_slot) < 0
+        || slab_init(&game_slab, sizeof(GameInstance), server_config.max_games, NULL) < 0
+        || user_index_init(&slots_by_user_id, SLAB_CHUNK_ENTRIES) < 0
+        || user_index_init(&games_by_number, SLAB_CHUNK_ENTRIES) < 0) {
+        perror("client tables");
+        exit(EXIT_FAILURE);
+    }
+    if (server_config.bot) register_bot();
+    if (server_config.tablebase_path) {
+        if (tablebaseOpen(&tablebase, server_config.tablebase_path) < 0) {
+            perror(server_config.tablebase_path);
+            printf("Endgame tablebase not loaded, EVALUATE_POSITION will be refused\n");
+        } else {
+            printf("Endgame tablebase %s mapped: %u positions up to %d seeds\n", server_config.tablebase_path,
+                   tablebase.entries, tablebase.max_seeds);
+        }
+    }
+    if (server_config.book_path) {
+        if (bookOpen(&book, server_config.book_path) < 0) {
+            perror(server_config.book_path);
+            printf("Opening book not loaded, SUGGEST_MOVE will suggest nothing\n");
+        } else {
+            printf("Opening book %s mapped: %u positions\n", server_config.book_path, book.count);
+        }
     }
 
     if ((server_fd = socket(AF_INET, SOCK_STREAM, 0)) == 0) {
@@ -548,585 +1550,76 @@ int start_server(void) {
 
     address.sin_family = AF_INET;
     address.sin_addr.s_addr = INADDR_ANY;
-    address.sin_port = htons(PORT);
+    address.sin_port = htons(server_config.port);
 
     if (bind(server_fd, (struct sockaddr *) &address, sizeof(address)) < 0) {
         perror("bind failed");
         exit(EXIT_FAILURE);
     }
 
-    if (listen(server_fd, 3) < 0) {
+    if (listen(server_fd, SOMAXCONN) < 0) {
         perror("listen failed");
         exit(EXIT_FAILURE);
     }
 
-    fd_set read_fds;
-    struct timeval timeout;
-    timeout.tv_sec = 1;
-    timeout.tv_usec = 0;
-
-    printf("✨ Server listening on port %d\n", PORT);
-    while (1) {
-        FD_ZERO(&read_fds);
-        FD_SET(server_fd, &read_fds);
-        int max_fd = server_fd;
-
-        for (int i = 0; i < MAX_CLIENTS; i++) {
-            if (clients[i].active) {
-                FD_SET(clients[i].fd, &read_fds);
-                if (clients[i].fd > max_fd) max_fd = clients[i].fd;
-            }
-        }
-
-
-        int activity = select(max_fd + 1, &read_fds, NULL, NULL, &timeout);
-        if (activity < 0) {
-            perror("select failed");
-            continue;
-        } else if (activity == 0) {
-            continue;
-        }
-
-        // new connection
-        if (FD_ISSET(server_fd, &read_fds)) {
-            int new_socket = accept(server_fd, (struct sockaddr *) &address, (socklen_t *) &addrlen);
-            if (new_socket < 0) {
-                perror("accept failed");
-                continue;
-            }
-            for (int i = 0; i < MAX_CLIENTS; i++) {
-                if (!clients[i].active) {
-                    clients[i].fd = new_socket;
-                    clients[i].active = 1;
-                    clients[i].in_game = 0;
-                    clients[i].nb_of_pending_challenges = 0;
-                    // we could optimize memory by reallocating when a new challenge is received (to nb_of_pending_challenges + 1) but flemme
-                    clients[i].pending_challenge_from_user_fd = malloc(sizeof(int) * (MAX_CLIENTS - 1));
-                    break;
-                }
-            }
-        }
+    if (user_store_open(&users, server_config.data_dir, BOT_USER_ID) < 0) {
+        fprintf(stderr, "Could not open the user store%s%s\n", server_config.data_dir ? " in " : "",
+                server_config.data_dir ? server_config.data_dir : "");
+        exit(EXIT_FAILURE);
+    }
+    if (server_config.data_dir) {
+        printf("User store %s loaded: %zu users\n", server_config.data_dir, users.count);
+    }
+    // the ranking starts from the statistics of the users
+    if (ranking_init(&ranking, users.count) < 0 || profile_cache_init(&profiles, users.count) < 0) {
+        fprintf(stderr, "Could not allocate the ranking and the profiles\n");
+        exit(EXIT_FAILURE);
+    }
+    user_store_for_each(&users, rank_stored_user, &ranking);
+    // the leaderboard is sorted and rendered on its own thread, the reactor only copies a page of it
+    if (leaderboard_init(&ranking, &ranking_mutex, RANKING_REFRESH_MS) < 0) {
+        exit(EXIT_FAILURE);
+    }
+    if (game_log_open(&game_log, server_config.data_dir) < 0) {
+        fprintf(stderr, "Could not open the game log in %s\n", server_config.data_dir);
+        exit(EXIT_FAILURE);
+    }
+    if (server_config.data_dir) {
+        printf("Game log %s/games.log loaded: %zu games\n", server_config.data_dir, game_log.count);
+    }
 
-        h = create_heap(100); // create a heap with capacity 100 for ranking
-        // Données clients
-        for (int i = 0; i < MAX_CLIENTS; i++) {
-            if (!clients[i].active) continue;
-            if (!FD_ISSET(clients[i].fd, &read_fds)) continue;
-            // if client is in game, handle game messages and ignore others
-            if (clients[i].in_game) continue;
-
-            CallType call_type;
-            ssize_t n = read(clients[i].fd, &call_type, sizeof(CallType));
-            if (n <= 0) {
-                printf("Client fd %d disconnected (main loop)\n", clients[i].fd);
-                remove_client_by_index(i);
-                continue;
-            }
+    // one game worker per core, and the thread that sends the moves to the spectators
+    if (scheduler_init(0) < 0 || fanout_init(deliver_to_watcher) < 0) {
+        exit(EXIT_FAILURE);
+    }
+    // and the threads searching the moves of the bot, one per core as well
+    if (server_config.bot && bot_search_init(0, BOT_TT_ENTRIES, on_bot_move_found) < 0) {
+        exit(EXIT_FAILURE);
+    }
 
-            switch (call_type) {
-                case CONNECT: {
-                    char username[USERNAME_SIZE + 1] = {0};
-                    if (read(clients[i].fd, username, USERNAME_SIZE + 1) <= 0) {
-                        close(clients[i].fd);
-                        clients[i].active = 0;
-                        break;
-                    }
-                    User user = newUser(username, "");
-                    printf("New user connected: %s (%d) - socket %d\n", username, user.id, clients[i].fd);
-                    clients[i].user_id = user.id;
-                    strncpy(clients[i].username, username, USERNAME_SIZE);
-                    heap_insert(h, (PlayerRanking ){clients[i].user_id, 0});
-
-                    uint8_t user_buffer[1024] = {0};
-                    serialize_User(&user, user_buffer);
-                    CallType out = CONNECT_CONFIRM;
-                    send_payload(out, user_buffer, sizeof(user_buffer), clients[i].fd);
-                    break;
-                }
-                case CHALLENGE: {
-                    CallType error = ERROR;
-                    int opponent_user_id = 0;
-                    if (read(clients[i].fd, &opponent_user_id, sizeof(int)) <= 0) {
-                        close(clients[i].fd);
-                        clients[i].active = 0;
-                        break;
-                    }
-                    if (opponent_user_id == clients[i].user_id) {
-                        printf("User %s (id=%d) attempted to challenge themselves. Ignored.\n",
-                               clients[i].username, clients[i].user_id);
-                        char error_msg[] = "You cannot challenge yourself.";
-                        send_error(call_type, error_msg, clients[i].fd);
-                        /*send(clients[i].fd, &error, sizeof(error), 0);
-                        send(clients[i].fd, &call_type, sizeof(call_type), 0);
-                        send(clients[i].fd, error_msg, sizeof(error_msg), 0);*/
-                        break;
-                    }
-                    // Find target client by user_id and send challenge
-                    int target = -1;
-                    for (int j = 0; j < MAX_CLIENTS; j++) {
-                        if (clients[j].active && clients[j].user_id == opponent_user_id) {
-                            target = j;
-                            break;
-                        }
-                    }
-                    if (target != -1) {
-                        // if a player is found, send challenge request except if he is already in a game
-                        if (clients[target].in_game) {
-                            printf("User %s (id=%d) attempted to challenge user %s (id=%d) who is already in a game. Ignored.\n",
-                                   clients[i].username, clients[i].user_id, clients[target].username, clients[target].user_id);
-                            char error_msg[] = "The player challenged is currently in a game.";
-                            send_error(call_type, error_msg, clients[i].fd);
-                            /*send(clients[i].fd, &error, sizeof(error), 0);
-                            send(clients[i].fd, &call_type, sizeof(call_type), 0);
-                            send(clients[i].fd, error_msg, sizeof(error_msg), 0);*/
-                            break;
-                        }
-                        CallType out = CHALLENGE;
-                        clients[target].pending_challenge_from_user_fd[clients[target].nb_of_pending_challenges] = clients[i].fd;
-                        clients[target].nb_of_pending_challenges++;
-                        printf("User %s (id=%d) has %d pending challenges.\n", clients[target].username, clients[target].user_id,
-                               clients[target].nb_of_pending_challenges);
-                        // we need to send the info in a buffer like this:
-                        uint8_t buffer[sizeof(int) + USERNAME_SIZE + 1];
-                        memcpy(buffer, &clients[i].user_id, sizeof(int));
-                        memcpy(buffer + sizeof(int), clients[i].username, USERNAME_SIZE + 1);
-                        send_payload(out, buffer, sizeof(buffer), clients[target].fd);
-                        /*send(clients[target].fd, &out, sizeof(out), 0);
-                        send(clients[target].fd, &clients[i].user_id, sizeof(int), 0);
-                        send(clients[target].fd, clients[i].username, USERNAME_SIZE + 1, 0);*/
-                        printf("Challenge initialized by de %s(id=%d) to %s(id=%d) | socket %d to bind\n",
-                               clients[i].username, clients[i].user_id, clients[target].username, clients[target].user_id, clients[target].fd);
-                    } else {
-                        printf("Utilisateur %d introuvable pour challenge.\n", opponent_user_id);
-                        char error_msg[] = "User not found or not online.";
-                        int previous_call = CHALLENGE;
-                        send_error(previous_call, error_msg, clients[i].fd);
-                        /*
-                        send(clients[i].fd, &error, sizeof(error), 0);
-                        send(clients[i].fd, &previous_call, sizeof (previous_call), 0);
-                        send(clients[i].fd, error_msg, sizeof(error_msg), 0);
-                        */
-                    }
-                    break;
-                }
-                case CHALLENGE_REQUEST_ANSWER: {
-                    CallType error = ERROR;
-                    int request_user_id = 0;
-                    if (read(clients[i].fd, &request_user_id, sizeof(int)) <= 0) {
-                        close(clients[i].fd);
-                        clients[i].active = 0;
-                        break;
-                    }
-
-                    int answer = -1;
-                    if (read(clients[i].fd, &answer, sizeof(answer)) <= 0) {
-                        close(clients[i].fd);
-                        clients[i].active = 0;
-                        break;
-                    }
-                    // Find target client by user_id and send answer
-                    int target = -1;
-                    for (int j = 0; j < MAX_CLIENTS; j++) {
-                        if (clients[j].active && clients[j].user_id == request_user_id) {
-                            target = j;
-                            break;
-                        }
-                    }
-                    if (target != -1) {
-                        // if the player that initiated the challenge is playing a game now, we cannot send the answer and have to notify the challenged that the challenge he accepted no longer exists.
-                        if (clients[target].in_game) {
-                            char error_msg[] = "The player who challenged you is now in a game.";
-                            int previous_call = CHALLENGE_REQUEST_ANSWER;
-                            send_error(previous_call, error_msg, clients[i].fd);
-                            /*
-                            send(clients[i].fd, &error, sizeof(error), 0);
-                            send(clients[i].fd, &previous_call, sizeof(previous_call), 0);
-                            send(clients[i].fd, error_msg, sizeof(error_msg), 0);
-                             */
-                            break;
-                        }
-
-                        CallType out = CHALLENGE_REQUEST_ANSWER;
-                        // send answer to selected challenger
-                        // store in a buffer the user_id of the challenged and the answer
-                        uint8_t buffer[sizeof(int) + sizeof(int)];
-                        memcpy(buffer, &clients[i].user_id, sizeof(int));
-                        memcpy(buffer + sizeof(int), &answer, sizeof(int));
-                        send_payload(out, buffer, sizeof(buffer), clients[target].fd);
-                        /*
-                        send(clients[target].fd, &out, sizeof(out), 0);
-                        send(clients[target].fd, &clients[i].user_id, sizeof(int), 0);
-                        send(clients[target].fd, &answer, sizeof(int), 0);
-                         */
-                        if (answer == 1) {
-                            // challenge accepted -> notify awaiting challengers that were not selected
-                            for (int k = 0; k < clients[i].nb_of_pending_challenges; k++) {
-                                if (clients[i].pending_challenge_from_user_fd[k] != clients[target].fd) {
-                                    int fd_to_notify = clients[i].pending_challenge_from_user_fd[k];
-                                    CallType notify = CHALLENGE_REQUEST_ANSWER;
-                                    int refused = 0;
-                                    // store in a buffer the user_id of the challenged and the refusal
-                                    uint8_t buffer2[sizeof(int) + sizeof(int)];
-                                    memcpy(buffer2, &clients[i].user_id, sizeof(int));
-                                    memcpy(buffer2 + sizeof(int), &refused, sizeof(int));
-                                    send_payload(notify, buffer2, sizeof(buffer2), fd_to_notify);
-                                    /*
-                                    send(fd_to_notify, &notify, sizeof(notify), 0);
-                                    send(fd_to_notify, &clients[i].user_id, sizeof(int), 0);
-                                    send(fd_to_notify, &refused, sizeof(int), 0);
-                                     */
-                                    printf("Notified fd %d that challenge to %s(id=%d) was refused due to another acceptance.\n",
-                                           fd_to_notify, clients[i].username, clients[i].user_id);
-                                }
-                            }
-                            clients[target].nb_of_pending_challenges = 0;
-                            printf("Challenge accepted by %s(id=%d) to %s(id=%d) | socket %d to bind\n",
-                                   clients[i].username, clients[i].user_id, clients[target].username, clients[target].user_id, clients[target].fd);
-                            CallType out = CHALLENGE_START;
-                            // notify both clients that the challenge is starting now
-                            send_payload(out, clients[target].username, sizeof(clients[target].username), clients[i].fd);
-
-                            /*send(clients[i].fd, &out, sizeof(out), 0);
-                            send(clients[i].fd, &clients[target].username, sizeof(clients[target].username), 0);
-                             */
-
-                            send_payload(out, clients[i].username, sizeof(clients[i].username), clients[target].fd);
-                            /*send(clients[target].fd, &out, sizeof(out), 0);
-                            send(clients[target].fd, &clients[i].username, sizeof(clients[i].username), 0);
-                             */
-
-                            // then mark both clients as in game
-                            clients[i].in_game = 1;
-                            clients[target].in_game = 1;
-
-                            // randomly decide who starts
-                            srand((unsigned int) time(NULL));
-                            int starter = rand() % 2; // 0 or 1
-                            Player player1, player2;
-                            if (starter) {
-                                player1 = newPlayer(clients[i].user_id, clients[i].fd);
-                                player2 = newPlayer(clients[target].user_id, clients[target].fd);
-                            } else {
-                                player1 = newPlayer(clients[target].user_id, clients[target].fd);
-                                player2 = newPlayer(clients[i].user_id, clients[i].fd);
-                            }
-
-                            // Create game instance
-                            Game *game = newGame(&player1, &player2);
-
-                            // Then create a thread to handle the game logic
-                            GameInstance *g = alloc_game();
-                            if (!g) {
-                                fprintf(stderr, "No game slot available\n");
-                                break;
-                            }
-                            g->game = game;
-
-
-                            // launch thread
-                            if (pthread_create(&g->thread, NULL, game_thread, g) != 0) {
-                                perror("pthread_create game_thread");
-                                clients[i].in_game = clients[target].in_game = 0;
-                                free_game(g);
-                                break;
-                            }
-
-                            printf("Game %d created between %d and %d (fds %d & %d)\n",
-                                   g->game_id, g->game->player1.user_id, g->game->player2.user_id, g->game->player1.fd, g->game->player2.fd);
-                        }
-                    } else {
-                        printf("Utilisateur %d introuvable pour challenge.\n", request_user_id);
-                        char error_msg[] = "User not found or not online.";
-                        int previous_call = CHALLENGE_REQUEST_ANSWER;
-                        send_error(previous_call, error_msg, clients[i].fd);
-                        /*
-                        send(clients[i].fd, &error, sizeof(error), 0);
-                        send(clients[i].fd, &previous_call, sizeof (previous_call), 0);
-                        send(clients[i].fd, error_msg, sizeof(error_msg), 0);
-                         */
-                    }
-                    break;
-                }
-                case LIST_USERS: {
-                    CallType out = LIST_USERS;
-                    char user_list_buffer[1024] = {0};
-                    int client_count = 0;
-                    for (int u = 0; u < MAX_CLIENTS; u++) {
-                        if (clients[u].active && clients[u].user_id != 0 && clients[u].fd != clients[i].fd) {
-                            strcat(user_list_buffer, clients[u].username);
-                            strcat(user_list_buffer, " (id = ");
-                            char id_str[12];
-                            sprintf(id_str, "%d", clients[u].user_id);
-                            strcat(user_list_buffer, id_str);
-                            strcat(user_list_buffer, ")");
-                            if (clients[u].in_game) {
-                                strcat(user_list_buffer, " [IN GAME]");
-                            }
-                            strcat(user_list_buffer, "\n");
-                            client_count++;
-                        }
-                    }
-                    printf("Sending user list to %s (id=%d)\n", clients[i].username, clients[i].user_id);
-                    if (client_count == 0) {
-                        strcat(user_list_buffer, "No other users online.\n");
-                    }
-                    send_payload(out, user_list_buffer, strlen(user_list_buffer) + 1, clients[i].fd);
-                    /*
-                    send(clients[i].fd, &out, sizeof(out), 0);
-                    send(clients[i].fd, user_list_buffer, strlen(user_list_buffer) + 1, 0);
-                     */
-                    break;
-                }
-                case LIST_ONGOING_GAMES: {
-                    CallType out = LIST_ONGOING_GAMES;
-                    char games_list_buffer[1024] = {0};
-                    int games_count = 0;
-                    for (int u = 0; u < next_game_id; u++) {
-                        if (games[u] != NULL) {
-                            char game_info[128];
-                            sprintf(game_info, "Game %d: %d VS %d | %d - %d\n",
-                                    games[u]->game_id,
-                                    games[u]->game->player1.user_id,
-                                    games[u]->game->player2.user_id,
-                                    games[u]->game->player1.score,
-                                    games[u]->game->player2.score);
-                            strcat(games_list_buffer, game_info);
-                            games_count++;
-                        }
-                    }
-                    printf("Sending games list to %s (id=%d)\n", clients[i].username, clients[i].user_id);
-                    if (games_count == 0) {
-                        strcat(games_list_buffer, "No games are being played\n");
-                    }
-                    send_payload(out, games_list_buffer, strlen(games_list_buffer) + 1, clients[i].fd);
-                    /*send(clients[i].fd, &out, sizeof(out), 0);
-                    send(clients[i].fd, games_list_buffer, strlen(games_list_buffer) + 1, 0);
-                     */
-                    break;
-                }
-
-
-                case USER_WANTS_TO_EXIT_WATCH : {
-                    // we need to delete the user from the game_id he is watching
-                    int game_id = 0;
-                    if (read(clients[i].fd, &game_id, sizeof(int)) <=
-                        0) {
-                        close(clients[i].fd);
-                        clients[i].active = 0;
-                        break;
-                    }
-                    GameInstance *g = games[game_id - 1];
-                    if (g == NULL) {
-                        printf("Game %d not found for watcher exit\n", game_id);
-                        break;
-                    }
-                    // we need to remove the watcher from the watchers_fd array
-                    int found = 0;
-                    for (int w = 0; w < g->num_watchers; w++) {
-                        if (g->watchers_fd[w] == clients[i].fd) {
-                            // shift left
-                            for (int k = w; k < g->num_watchers - 1; k++) {
-                                g->watchers_fd[k] = g->watchers_fd[k + 1];
-                            }
-                            g->num_watchers--;
-                            found = 1;
-                            printf("Watcher %s (id=%d) exited watching game %d\n", clients[i].username,
-                                   clients[i].user_id, game_id);
-                            break;
-                        }
-                    }
-                    if (!found) {
-                        printf("Watcher %s (id=%d) was not found in watchers of game %d\n", clients[i].username,
-                               clients[i].user_id, game_id);
-                    }
-
-                    break;
-                }
-
-
-                case CONSULT_USER_PROFILE: {
-                    CallType out = CONSULT_USER_PROFILE;
-                    int requested_user_id = 0;
-                    int exists = 0;
-                    if (read(clients[i].fd, &requested_user_id, sizeof(int)) <= 0) {
-                        close(clients[i].fd);
-                        clients[i].active = 0;
-                        break;
-                    }
-                    if (requested_user_id == clients[i].user_id) {
-                        printf("User %s (id = %d) attempted to request their own profile. Ignored.\n",
-                               clients[i].username, clients[i].user_id);
-                        char error_msg[] = "To view your own profile, press 1.";
-                        int previous_call = CONSULT_USER_PROFILE;
-
-                        send_error(previous_call, error_msg, clients[i].fd);
-                        /*
-                        send(clients[i].fd, &error, sizeof(error), 0);
-                        send(clients[i].fd, &previous_call, sizeof (previous_call), 0);
-                        send(clients[i].fd, error_msg, sizeof(error_msg), 0);
-                         */
-                        break;
-                    }
-                    // Find target client by user_id and send them the request to send their profile
-                    int target = -1;
-                    for (int j = 0; j < MAX_CLIENTS; j++) {
-                        if (clients[j].active && clients[j].user_id == requested_user_id) {
-                            target = j;
-                            exists = 1;
-                            break;
-                        }
-                    }
-                    if (target != -1) {
-                        send_payload(out, &clients[i].user_id, sizeof(int), clients[target].fd);
-
-                        /*
-                        send(clients[target].fd, &out, sizeof(out), 0);
-                        send(clients[target].fd, &clients[i].user_id, sizeof(int), 0);
-                         */
-                        printf("Request profile initialized by de %s(id=%d) to %s(id=%d) | socket %d to bind\n",
-                               clients[i].username, clients[i].user_id, clients[target].username, clients[target].user_id, clients[target].fd);
-                    } else {
-                        printf("Utilisateur %d does not exist -> cannot send his profile\n", requested_user_id);
-                        char error_msg[] = "User not found or not online.";
-                        int previous_call = CONSULT_USER_PROFILE;
-                        send_error(previous_call, error_msg, clients[i].fd);
-                        /*
-                        send(clients[i].fd, &error, sizeof(error), 0);
-                        send(clients[i].fd, &previous_call, sizeof (previous_call), 0);
-                        send(clients[i].fd, error_msg, sizeof(error_msg), 0);
-                         */
-                    }
-
-                    break;
-                }
-
-                case DOES_USER_EXIST: {
-                    CallType out = DOES_USER_EXIST;
-                    int requested_user_id = 0;
-                    int exists = 0;
-                    if (read(clients[i].fd, &requested_user_id, sizeof(int)) <= 0) {
-                        close(clients[i].fd);
-                        clients[i].active = 0;
-                        break;
-                    }
-                    if (requested_user_id == clients[i].user_id) {
-                        printf("User %s (id = %d) attempted to request add themselves as friend. Ignored.\n",
-                               clients[i].username, clients[i].user_id);
-                        char error_msg[] = "You cannot add yourself as friend";
-                        int previous_call = DOES_USER_EXIST;
-
-                        send_error(previous_call, error_msg, clients[i].fd);
-                        /*
-                        send(clients[i].fd, &error, sizeof(error), 0);
-                        send(clients[i].fd, &previous_call, sizeof (previous_call), 0);
-                        send(clients[i].fd, error_msg, sizeof(error_msg), 0);
-                         */
-                        break;
-                    }
-                    // Find target client by user_id and send them the request to send their profile
-                    int target = -1;
-                    for (int j = 0; j < MAX_CLIENTS; j++) {
-                        if (clients[j].active && clients[j].user_id == requested_user_id) {
-                            target = j;
-                            exists = 1;
-                            break;
-                        }
-                    }
-                    printf("User existence check for id=%d by %s(id=%d): %s\n", requested_user_id, clients[i].username, clients[i].user_id,
-                           exists ? "EXISTS" : "DOES NOT EXIST");
-                    send_payload(out, &exists, sizeof(int), clients[i].fd);
-                    break;
-                }
-                case SENT_USER_PROFILE: {
-                    CallType out = RECEIVE_USER_PROFILE;
-                    int request_user_id;
-                    if (recv(clients[i].fd, &request_user_id, sizeof(int), 0) <= 0) {
-                        close(clients[i].fd);
-                        clients[i].active = 0;
-                        break;
-                    }
-                    // we get the user_profile serialized
-                    uint8_t buffer[1024] = {0};
-                    if (recv(clients[i].fd, buffer, sizeof(buffer), 0) <= 0) {
-                        perror("recv failed");
-                        exit(EXIT_FAILURE);
-                    }
-
-
-                    // and then send it to the request_user_id
-                    int target = -1;
-                    for (int j = 0; j < MAX_CLIENTS; j++) {
-                        if (clients[j].active && clients[j].user_id == request_user_id) {
-                            target = j;
-                            break;
-                        }
-                    }
-                    printf("Sending %s's profile to %s\n", clients[i].username, clients[target].username);
-                    send_payload(out, buffer, sizeof(buffer), clients[target].fd);
-                    /*
-                    send(clients[target].fd, &out, sizeof(out), 0);
-                    send(clients[target].fd, buffer, sizeof(buffer), 0);
-                     */
-                    break;
-                }
-                case WATCH_GAME: {
-                    int game_id;
-                    if (recv(clients[i].fd, &game_id, sizeof(int), 0) <= 0) {
-                        close(clients[i].fd);
-                        clients[i].active = 0;
-                        break;
-                    }
-                    // because games are displayed to users starting from 1
-                    game_id--;
-                    // first we need to check if the game exists
-                    if (game_id < 0 || game_id >= next_game_id || games[game_id] == NULL) {
-                        printf("Client %d requested to watch non-existing game %d\n", clients[i].user_id, game_id);
-                        CallType error = ERROR;
-                        char error_msg[] = "The requested game does not exist.";
-                        send_error(call_type, error_msg, clients[i].fd);
-                        break;
-                    }
-                    // then fetch players in the game and asks them to allow or not
-                    //CallType user_request = USER_WANTS_TO_WATCH;
-                    //send_payload(user_request, &clients[i].user_id, sizeof(int), games[game_id]->game->player1.fd);
-                    //send_payload(user_request, &clients[i].user_id, sizeof(int), games[game_id]->game->player2.fd);
-                    //printf("Client %d wants to watch game %d\n", clients[i].user_id, game_id);
-                    // for now we do not handle multiple watchers or refusals, we just let the client watch directly
-                    // so we need to store it in the game instance
-                    games[game_id]->watchers_user_id[games[game_id]->num_watchers] = clients[i].user_id;
-                    games[game_id]->watchers_fd[games[game_id]->num_watchers] = clients[i].fd;
-                    games[game_id]->num_watchers++;
-                    break;
-                }
-                case SEND_LOBBY_CHAT: {
-                    char message[MAX_CHAT_MESSAGE_SIZE] = {0};
-                    if (recv(clients[i].fd, message, MAX_CHAT_MESSAGE_SIZE, 0) <= 0) {
-                        close(clients[i].fd);
-                        clients[i].active = 0;
-                        break;
-                    }
-
-                    printf("Lobby chat from %s (id=%d): %s\n", clients[i].username, clients[i].user_id, message);
-
-                    // Broadcast to all clients not in game (except sender)
-                    CallType out = RECEIVE_LOBBY_CHAT;
-                    uint8_t buffer[sizeof(int) + USERNAME_SIZE + 1 + MAX_CHAT_MESSAGE_SIZE];
-                    memcpy(buffer, &clients[i].user_id, sizeof(int));
-                    memcpy(buffer + sizeof(int), clients[i].username, USERNAME_SIZE + 1);
-                    memcpy(buffer + sizeof(int) + USERNAME_SIZE + 1, message, MAX_CHAT_MESSAGE_SIZE);
-
-                    for (int j = 0; j < MAX_CLIENTS; j++) {
-                        if (clients[j].active && clients[j].fd != clients[i].fd && !clients[j].in_game) {
-                            send_payload(out, buffer, sizeof(buffer), clients[j].fd);
-                        }
-                    }
-                    break;
-                }
-                default: break;
-            }
-        }
+    listener_fd = server_fd;
+    if (set_non_blocking(server_fd) < 0 || reactor_init() < 0 || reactor_add(server_fd, EPOLLIN, &listener_fd) < 0
+        || reactor_add(signal_fd, EPOLLIN, &signal_fd) < 0) {
+        exit(EXIT_FAILURE);
     }
-    // TODO : nettoyer proprement l'espace mémoire quand le serveur s'arrête
 
-    return 0;
+    printf("✨ Server listening on port %d\n", server_config.port);
+    int status = reactor_run(on_server_event);
+
+    // no new event reaches the games: the bot searches post their last moves, the workers finish the queued events
+    // (a new bot search is refused, the bot leaves its game), then the spectators get what the workers sent them,
+    // and what the games recorded is saved
+    close(listener_fd);
+    if (server_config.bot) bot_search_stop();
+    scheduler_stop();
+    fanout_stop();
+    leaderboard_stop();
+    if (user_store_flush(&users) < 0) {
+        fprintf(stderr, "Some changes of the users could not be saved\n");
+        status = -1;
+    }
+    user_store_close(&users);
+    game_log_close(&game_log);
+    printf("Serveur arrêté\n");
+    return status;
 }
@@ -1,2 +1,26 @@
 #pragma once
-int start_server(void);
+#include <stddef.h>
+
+// upper bounds of the connection and game tables, which grow by chunks up to them
+#define DEFAULT_MAX_CLIENTS 65536
+#define DEFAULT_MAX_GAMES 65536
+#define DEFAULT_BOT_TIME_MS 100
+
+typedef struct ServerConfig {
+    int port;
+    int max_clients; // connections served at the same time
+    int max_games; // games played at the same time
+    int bot; // register the computer player "awalbot"
+    long bot_max_nodes; // search budget of a bot move, 0 for no limit (bot_max_time_ms must then be set)
+    int bot_max_time_ms; // same in milliseconds of a bot search thread, 0 for no limit
+    size_t max_outbound_bytes; // a client whose pending outbound data exceeds this is disconnected
+    const char *tablebase_path; // endgame tablebase answering EVALUATE_POSITION, NULL for none
+    const char *book_path; // opening book answering SUGGEST_MOVE and played by the bot, NULL for none
+    const char *data_dir; // where the user store and the game log are kept, NULL to keep the users in memory only
+} ServerConfig;
+
+// Default configuration, overridden by the command line in main.c
+ServerConfig default_server_config(void);
+
+// Serve until SIGINT or SIGTERM, then save the users and the games. Returns -1 if they could not all be saved.
+int start_server(const ServerConfig *config);
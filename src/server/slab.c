@@ -0,0 +1,117 @@
+#include <stdlib.h>
+#include "slab.h"
+
+#define GENERATION_MASK ((1u << (31 - SLAB_INDEX_BITS)) - 1)
+
+struct SlabSlot {
+    uint32_t generation; // 1..GENERATION_MASK, so a handle is never 0
+    int32_t next_free; // next free slot when not in use
+    int in_use;
+};
+
+// the entry follows its header, aligned for any type
+#define SLOT_HEADER_SIZE ((sizeof(SlabSlot) + 15) & ~(size_t) 15)
+
+static size_t slot_size(const Slab *slab) {
+    return SLOT_HEADER_SIZE + ((slab->entry_size + 15) & ~(size_t) 15);
+}
+
+static SlabSlot *slot_at(const Slab *slab, size_t index) {
+    return (SlabSlot *) (slab->chunks[index / SLAB_CHUNK_ENTRIES] + (index % SLAB_CHUNK_ENTRIES) * slot_size(slab));
+}
+
+static void *entry_of(SlabSlot *slot) {
+    return (uint8_t *) slot + SLOT_HEADER_SIZE;
+}
+
+int slab_init(Slab *slab, size_t entry_size, size_t max_entries, void (*init_entry)(void *entry)) {
+    if (max_entries == 0 || max_entries > SLAB_MAX_ENTRIES) max_entries = SLAB_MAX_ENTRIES;
+    slab->entry_size = entry_size;
+    slab->init_entry = init_entry;
+    slab->max_entries = max_entries;
+    slab->nb_chunks = 0;
+    slab->free_list = -1;
+    slab->count = 0;
+    slab->chunks = calloc((max_entries + SLAB_CHUNK_ENTRIES - 1) / SLAB_CHUNK_ENTRIES, sizeof(uint8_t *));
+    return slab->chunks ? 0 : -1;
+}
+
+void slab_destroy(Slab *slab) {
+    for (size_t c = 0; c < slab->nb_chunks; c++) free(slab->chunks[c]);
+    free(slab->chunks);
+    slab->chunks = NULL;
+    slab->nb_chunks = 0;
+}
+
+static int add_chunk(Slab *slab) {
+    size_t first = slab->nb_chunks * SLAB_CHUNK_ENTRIES;
+    if (first >= slab->max_entries) return -1;
+    uint8_t *chunk = calloc(SLAB_CHUNK_ENTRIES, slot_size(slab));
+    if (!chunk) return -1;
+    slab->chunks[slab->nb_chunks] = chunk;
+
+    size_t last = first + SLAB_CHUNK_ENTRIES;
+    if (last > slab->max_entries) last = slab->max_entries;
+    for (size_t i = first; i < last; i++) {
+        SlabSlot *slot = slot_at(slab, i);
+        slot->generation = 1;
+        slot->next_free = i + 1 < last ? (int32_t) (i + 1) : -1;
+        if (slab->init_entry) slab->init_entry(entry_of(slot));
+    }
+    slab->free_list = (int) first;
+    // the chunk is complete before readers can index it
+    __atomic_store_n(&slab->nb_chunks, slab->nb_chunks + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+int32_t slab_alloc(Slab *slab, void **entry) {
+    if (slab->free_list == -1 && add_chunk(slab) < 0) return -1;
+    size_t index = slab->free_list;
+    SlabSlot *slot = slot_at(slab, index);
+    slab->free_list = slot->next_free;
+    slot->in_use = 1;
+    slab->count++;
+    if (entry) *entry = entry_of(slot);
+    return (int32_t) ((slot->generation << SLAB_INDEX_BITS) | index);
+}
+
+static SlabSlot *slot_of_handle(const Slab *slab, int32_t handle) {
+    if (handle <= 0) return NULL;
+    size_t index = slab_index_of(handle);
+    if (index >= slab_capacity(slab)) return NULL;
+    SlabSlot *slot = slot_at(slab, index);
+    if (!slot->in_use || slot->generation != ((uint32_t) handle >> SLAB_INDEX_BITS)) return NULL;
+    return slot;
+}
+
+void slab_free(Slab *slab, int32_t handle) {
+    SlabSlot *slot = slot_of_handle(slab, handle);
+    if (!slot) return;
+    slot->in_use = 0;
+    slot->generation = slot->generation == GENERATION_MASK ? 1 : slot->generation + 1;
+    slot->next_free = slab->free_list;
+    slab->free_list = slab_index_of(handle);
+    slab->count--;
+}
+
+void *slab_get(const Slab *slab, int32_t handle) {
+    SlabSlot *slot = slot_of_handle(slab, handle);
+    return slot ? entry_of(slot) : NULL;
+}
+
+void *slab_at(const Slab *slab, size_t index) {
+    if (index >= slab_capacity(slab)) return NULL;
+    return entry_of(slot_at(slab, index));
+}
+
+size_t slab_capacity(const Slab *slab) {
+    size_t capacity = __atomic_load_n(&slab->nb_chunks, __ATOMIC_ACQUIRE) * SLAB_CHUNK_ENTRIES;
+    return capacity < slab->max_entries ? capacity : slab->max_entries;
+}
+
+int32_t slab_handle_at(const Slab *slab, size_t index) {
+    if (index >= slab_capacity(slab)) return -1;
+    SlabSlot *slot = slot_at(slab, index);
+    if (!slot->in_use) return -1;
+    return (int32_t) ((slot->generation << SLAB_INDEX_BITS) | index);
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Table of fixed-size entries allocated by chunks of SLAB_CHUNK_ENTRIES.
+ * Growing adds a chunk and never moves the live entries, so a pointer to an entry stays valid until it is freed.
+ *
+ * Entries are named by handles: the index of the slot tagged with its generation, which changes every time the slot
+ * is freed. A handle kept after its entry was freed (the id of a finished game) is detected as stale instead of
+ * reaching the entry that reuses the slot.
+ *
+ * Not thread-safe: alloc and free are serialized by the owner. slab_at and slab_get can be called concurrently with
+ * slab_alloc, since the chunks never move.
+ */
+
+#define SLAB_CHUNK_ENTRIES 256
+#define SLAB_INDEX_BITS 20
+#define SLAB_MAX_ENTRIES (1 << SLAB_INDEX_BITS)
+
+typedef struct SlabSlot SlabSlot;
+
+typedef struct Slab {
+    size_t entry_size;
+    void (*init_entry)(void *entry); // called once per slot when its chunk is allocated, NULL to keep it zeroed
+    size_t max_entries; // at most SLAB_MAX_ENTRIES
+    size_t nb_chunks; // chunks allocated, each holding SLAB_CHUNK_ENTRIES slots
+    uint8_t **chunks; // room for every chunk up to max_entries, so it is never reallocated
+    int free_list; // first free slot, -1 when every allocated chunk is full
+    size_t count; // entries in use
+} Slab;
+
+/*
+ * Entries are zeroed then passed to @init_entry when their chunk is allocated. They are not cleared between uses:
+ * what an entry owns for its whole life (a mutex) is set up there, the rest by the caller of slab_alloc.
+ */
+int slab_init(Slab *slab, size_t entry_size, size_t max_entries, void (*init_entry)(void *entry));
+
+void slab_destroy(Slab *slab);
+
+// Allocates an entry and returns its handle (always > 0), or -1 when the slab is full
+int32_t slab_alloc(Slab *slab, void **entry);
+
+// Frees the entry of @handle, which becomes stale. Ignored if @handle is already stale.
+void slab_free(Slab *slab, int32_t handle);
+
+// Entry of @handle, NULL if the handle is stale or invalid
+void *slab_get(const Slab *slab, int32_t handle);
+
+// Entry of the slot @index whether it is in use or not, NULL beyond the allocated chunks
+void *slab_at(const Slab *slab, size_t index);
+
+// Number of slots currently allocated: every index below it can be passed to slab_at
+size_t slab_capacity(const Slab *slab);
+
+// Handle of the entry in use at @index, -1 if the slot is free
+int32_t slab_handle_at(const Slab *slab, size_t index);
+
+static inline int slab_index_of(int32_t handle) {
+    return handle & (SLAB_MAX_ENTRIES - 1);
+}
@@ -0,0 +1,634 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "../common/utils.h"
+#include "user_store.h"
+
+#define STORE_FORMAT_VERSION 1
+#define FILE_HEADER_SIZE 16 // magic, version, generation
+#define RECORD_HEADER_SIZE 8 // payload size, checksum
+#define RECORD_FIXED_SIZE (4 * 4 + 1 + 2) // the integers and both lengths
+#define MAX_RECORD_SIZE (RECORD_HEADER_SIZE + RECORD_FIXED_SIZE + USERNAME_SIZE + BIO_SIZE)
+#define USER_STORE_MIN_CAPACITY 64
+
+static const char log_magic[4] = {'A', 'W', 'U', 'L'};
+static const char snapshot_magic[4] = {'A', 'W', 'U', 'S'};
+
+// ---------------------- RECORDS ---------------------- //
+/*
+ * A record is the whole state of one user, the last record of a user wins:
+ *   [payload size: uint32 LE][FNV-1a of the payload: uint32 LE]
+ *   [id][total_score][total_games][total_wins: int32 LE][username length: 1 byte][username]
+ *   [bio length: uint16 LE][bio]
+ */
+static uint32_t checksum(const uint8_t *data, size_t size) {
+    uint32_t hash = 2166136261u;
+    for (size_t k = 0; k < size; k++) {
+        hash = (hash ^ data[k]) * 16777619u;
+    }
+    return hash;
+}
+
+static size_t encode_record(const StoredUser *user, uint8_t *buffer) {
+    size_t name_len = strnlen(user->username, USERNAME_SIZE);
+    size_t bio_len = strnlen(user->bio, BIO_SIZE);
+    uint8_t *payload = buffer + RECORD_HEADER_SIZE;
+    size_t pos = 0;
+    write_int32_le(payload, pos, user->id);
+    write_int32_le(payload, pos + 4, user->total_score);
+    write_int32_le(payload, pos + 8, user->total_games);
+    write_int32_le(payload, pos + 12, user->total_wins);
+    pos += 16;
+    payload[pos++] = (uint8_t) name_len;
+    memcpy(payload + pos, user->username, name_len);
+    pos += name_len;
+    payload[pos++] = (uint8_t) (bio_len & 0xFF);
+    payload[pos++] = (uint8_t) (bio_len >> 8);
+    memcpy(payload + pos, user->bio, bio_len);
+    pos += bio_len;
+    write_int32_le(buffer, 0, (int32_t) pos);
+    write_int32_le(buffer, 4, (int32_t) checksum(payload, pos));
+    return RECORD_HEADER_SIZE + pos;
+}
+
+/*
+ * Decode the record at the start of @data into @user, its bio into @bio (BIO_SIZE + 1 bytes).
+ * Returns the size of the record, -1 if it is truncated or corrupted.
+ */
+static long decode_record(const uint8_t *data, size_t size, StoredUser *user, char *bio) {
+    if (size < RECORD_HEADER_SIZE) return -1;
+    uint32_t payload_size = (uint32_t) read_int32_le(data, 0);
+    if (payload_size < RECORD_FIXED_SIZE || payload_size > MAX_RECORD_SIZE - RECORD_HEADER_SIZE
+        || payload_size > size - RECORD_HEADER_SIZE) {
+        return -1;
+    }
+    const uint8_t *payload = data + RECORD_HEADER_SIZE;
+    if (checksum(payload, payload_size) != (uint32_t) read_int32_le(data, 4)) return -1;
+    user->id = read_int32_le(payload, 0);
+    user->total_score = read_int32_le(payload, 4);
+    user->total_games = read_int32_le(payload, 8);
+    user->total_wins = read_int32_le(payload, 12);
+    size_t pos = 16;
+    size_t name_len = payload[pos++];
+    if (name_len > USERNAME_SIZE || pos + name_len + 2 > payload_size) return -1;
+    memcpy(user->username, payload + pos, name_len);
+    user->username[name_len] = '\0';
+    pos += name_len;
+    size_t bio_len = payload[pos] | (size_t) payload[pos + 1] << 8;
+    pos += 2;
+    if (bio_len > BIO_SIZE || pos + bio_len != payload_size) return -1;
+    memcpy(bio, payload + pos, bio_len);
+    bio[bio_len] = '\0';
+    user->bio = bio;
+    return (long) (RECORD_HEADER_SIZE + payload_size);
+}
+
+static void write_file_header(uint8_t *buffer, const char *magic, uint64_t generation) {
+    memcpy(buffer, magic, 4);
+    write_int32_le(buffer, 4, STORE_FORMAT_VERSION);
+    write_uint64_le(buffer, 8, generation);
+}
+
+// ---------------------- MEMORY ---------------------- //
+static size_t name_bucket(const UserStore *store, const char *username) {
+    uint64_t hash = 1469598103934665603ULL;
+    for (const char *c = username; *c; c++) {
+        hash = (hash ^ (uint8_t) *c) * 1099511628211ULL;
+    }
+    return (size_t) (hash & (store->name_capacity - 1));
+}
+
+static void name_insert(UserStore *store, int index) {
+    size_t b = name_bucket(store, store->users[index].username);
+    while (store->by_name[b] != -1) b = (b + 1) & (store->name_capacity - 1);
+    store->by_name[b] = index;
+}
+
+static int find_by_name(const UserStore *store, const char *username) {
+    size_t b = name_bucket(store, username);
+    while (store->by_name[b] != -1) {
+        if (strcmp(store->users[store->by_name[b]].username, username) == 0) return store->by_name[b];
+        b = (b + 1) & (store->name_capacity - 1);
+    }
+    return -1;
+}
+
+static int grow_names(UserStore *store) {
+    size_t capacity = store->name_capacity * 2;
+    int *by_name = malloc(capacity * sizeof(int));
+    if (!by_name) return -1;
+    free(store->by_name);
+    store->by_name = by_name;
+    store->name_capacity = capacity;
+    for (size_t b = 0; b < capacity; b++) by_name[b] = -1;
+    for (size_t u = 0; u < store->count; u++) name_insert(store, (int) u);
+    return 0;
+}
+
+// Add @user (its bio is copied) to the memory and both indexes. Returns its index, -1 if out of memory.
+static int add_user(UserStore *store, const StoredUser *user) {
+    if (store->count == store->capacity) {
+        StoredUser *users = realloc(store->users, store->capacity * 2 * sizeof(StoredUser));
+        if (!users) return -1;
+        store->users = users;
+        store->capacity *= 2;
+    }
+    if ((store->count + 1) * 2 > store->name_capacity && grow_names(store) < 0) return -1;
+    int index = (int) store->count;
+    StoredUser *stored = &store->users[index];
+    *stored = *user;
+    stored->bio = strdup(user->bio);
+    if (!stored->bio || user_index_put(&store->by_id, user->id, index) < 0) {
+        free(stored->bio);
+        return -1;
+    }
+    store->count++;
+    name_insert(store, index);
+    if (user->id > store->last_id) store->last_id = user->id;
+    return index;
+}
+
+// Returns 1 if the bio changed, 0 if it is the same, -1 if out of memory
+static int set_bio(StoredUser *user, const char *bio) {
+    if (strncmp(user->bio, bio, BIO_SIZE) == 0) return 0;
+    char *copy = strndup(bio, BIO_SIZE);
+    if (!copy) return -1;
+    free(user->bio);
+    user->bio = copy;
+    return 1;
+}
+
+// A record read back from the disk: the user is created or replaced
+static int apply_record(UserStore *store, const StoredUser *record) {
+    int index = user_index_get(&store->by_id, record->id);
+    if (index == -1) return add_user(store, record) < 0 ? -1 : 0;
+    StoredUser *user = &store->users[index];
+    user->total_score = record->total_score;
+    user->total_games = record->total_games;
+    user->total_wins = record->total_wins;
+    return set_bio(user, record->bio) < 0 ? -1 : 0;
+}
+
+static void copy_out(const StoredUser *stored, User *user, char *bio) {
+    memset(user, 0, sizeof(User));
+    memcpy(user->username, stored->username, USERNAME_SIZE + 1);
+    user->id = stored->id;
+    user->total_score = stored->total_score;
+    user->total_games = stored->total_games;
+    user->total_wins = stored->total_wins;
+    snprintf(bio, BIO_SIZE + 1, "%s", stored->bio);
+    user->bio = bio;
+}
+
+// ---------------------- FILES ---------------------- //
+static void log_path(const UserStore *store, uint64_t generation, char *path) {
+    snprintf(path, PATH_MAX, "%s/users.%llu.log", store->dir, (unsigned long long) generation);
+}
+
+static void snapshot_path(const UserStore *store, char *path, int tmp) {
+    snprintf(path, PATH_MAX, "%s/users.snapshot%s", store->dir, tmp ? ".tmp" : "");
+}
+
+static int write_all(int fd, const uint8_t *data, size_t size) {
+    while (size > 0) {
+        ssize_t n = write(fd, data, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        data += n;
+        size -= (size_t) n;
+    }
+    return 0;
+}
+
+// The renames and the new files of @dir are durable once the directory itself is synced
+static void sync_dir(const char *dir) {
+    int fd = open(dir, O_RDONLY | O_DIRECTORY);
+    if (fd < 0) return;
+    fsync(fd);
+    close(fd);
+}
+
+// Whole content of @path, NULL with errno ENOENT when it does not exist
+static uint8_t *read_file(const char *path, size_t *size) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat st;
+    uint8_t *data = NULL;
+    if (fstat(fd, &st) == 0 && (data = malloc(st.st_size ? (size_t) st.st_size : 1))) {
+        size_t done = 0;
+        while (done < (size_t) st.st_size) {
+            ssize_t n = read(fd, data + done, (size_t) st.st_size - done);
+            if (n <= 0) break;
+            done += (size_t) n;
+        }
+        *size = done;
+    }
+    close(fd);
+    return data;
+}
+
+/*
+ * Apply the records of a file. Returns the offset where the valid records end, -1 if the header does not match.
+ * With @strict, a record that cannot be read is an error instead of the end of the file.
+ */
+static long replay_file(UserStore *store, const uint8_t *data, size_t size, const char *magic, uint64_t *generation,
+                        int strict) {
+    if (size < FILE_HEADER_SIZE || memcmp(data, magic, 4) != 0 || read_int32_le(data, 4) != STORE_FORMAT_VERSION) {
+        return -1;
+    }
+    *generation = read_uint64_le(data, 8);
+    size_t pos = FILE_HEADER_SIZE;
+    char bio[BIO_SIZE + 1];
+    while (pos < size) {
+        StoredUser record;
+        long n = decode_record(data + pos, size - pos, &record, bio);
+        if (n < 0) {
+            if (strict) return -1;
+            fprintf(stderr, "User store: record at offset %zu unreadable, the end of the log is dropped\n", pos);
+            break;
+        }
+        if (apply_record(store, &record) < 0) return -1;
+        pos += (size_t) n;
+    }
+    return (long) pos;
+}
+
+static int create_log(const UserStore *store, uint64_t generation) {
+    char path[PATH_MAX];
+    log_path(store, generation, path);
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    if (fd < 0) return -1;
+    uint8_t header[FILE_HEADER_SIZE];
+    write_file_header(header, log_magic, generation);
+    if (write_all(fd, header, sizeof(header)) < 0 || fsync(fd) < 0) {
+        close(fd);
+        return -1;
+    }
+    sync_dir(store->dir);
+    return fd;
+}
+
+static int load(UserStore *store) {
+    char path[PATH_MAX];
+    size_t size = 0;
+    uint64_t generation = 0;
+    snapshot_path(store, path, 0);
+    uint8_t *data = read_file(path, &size);
+    if (data) {
+        long end = replay_file(store, data, size, snapshot_magic, &generation, 1);
+        free(data);
+        if (end < 0) {
+            fprintf(stderr, "User store: snapshot %s is corrupted\n", path);
+            return -1;
+        }
+        store->snapshot_bytes = size;
+    } else if (errno != ENOENT) {
+        perror(path);
+        return -1;
+    }
+    // the log older than the snapshot is left over when the server stopped right after writing it
+    if (generation > 0) {
+        log_path(store, generation - 1, path);
+        unlink(path);
+    }
+
+    // then the logs written since, the last one is appended to
+    store->log_fd = -1;
+    for (uint64_t g = generation;; g++) {
+        log_path(store, g, path);
+        data = read_file(path, &size);
+        if (!data) break;
+        uint64_t log_generation;
+        long end = replay_file(store, data, size, log_magic, &log_generation, 0);
+        free(data);
+        if (end < 0 || log_generation != g) {
+            fprintf(stderr, "User store: log %s is corrupted\n", path);
+            return -1;
+        }
+        if (store->log_fd >= 0) close(store->log_fd);
+        store->log_fd = open(path, O_WRONLY | O_APPEND);
+        // a record torn by a crash is cut off, the next ones are appended after the valid ones
+        if (store->log_fd < 0 || ((size_t) end < size && ftruncate(store->log_fd, end) < 0)) {
+            perror(path);
+            return -1;
+        }
+        store->generation = g;
+        store->log_bytes = (size_t) end;
+    }
+    if (store->log_fd < 0) {
+        store->generation = generation;
+        store->log_fd = create_log(store, generation);
+        store->log_bytes = FILE_HEADER_SIZE;
+        if (store->log_fd < 0) {
+            log_path(store, generation, path);
+            perror(path);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// ---------------------- COMMITS ---------------------- //
+static void append_record(UserStore *store, const StoredUser *user) {
+    if (!store->dir) return;
+    if (store->pending_len + MAX_RECORD_SIZE > store->pending_capacity) {
+        size_t capacity = store->pending_capacity ? store->pending_capacity * 2 : 64 * MAX_RECORD_SIZE;
+        uint8_t *pending = realloc(store->pending, capacity);
+        if (!pending) {
+            fprintf(stderr, "User store: change of user %d not logged, out of memory\n", user->id);
+            return;
+        }
+        store->pending = pending;
+        store->pending_capacity = capacity;
+    }
+    store->pending_len += encode_record(user, store->pending + store->pending_len);
+    store->appended++;
+}
+
+/*
+ * Write and sync @size bytes of records to the log, which is @log_bytes long before them.
+ * A write that fails halfway is cut off, so the records can be written again after the valid ones.
+ */
+static int commit_records(int fd, size_t log_bytes, const uint8_t *records, size_t size) {
+    if (write_all(fd, records, size) == 0 && fdatasync(fd) == 0) return 0;
+    perror("User store: log");
+    if (ftruncate(fd, (off_t) log_bytes) < 0) perror("User store: log");
+    return -1;
+}
+
+// Swap the pending records with the spare buffer, the records are then written from the spare buffer
+static uint8_t *take_pending(UserStore *store, size_t *size) {
+    uint8_t *records = store->pending;
+    size_t capacity = store->pending_capacity;
+    *size = store->pending_len;
+    store->pending = store->spare;
+    store->pending_capacity = store->spare_capacity;
+    store->pending_len = 0;
+    store->spare = records;
+    store->spare_capacity = capacity;
+    return records;
+}
+
+/*
+ * Put the records of a failed commit back in front of the ones appended since, to be written by the next pass.
+ * Called with the mutex held.
+ */
+static void requeue_records(UserStore *store, const uint8_t *records, size_t size) {
+    store->failed_commits++;
+    pthread_cond_broadcast(&store->committed);
+    if (store->pending_len + size > store->pending_capacity) {
+        size_t capacity = store->pending_len + size + 64 * MAX_RECORD_SIZE;
+        uint8_t *pending = realloc(store->pending, capacity);
+        if (!pending) {
+            fprintf(stderr, "User store: %zu bytes of changes lost, out of memory\n", size);
+            return;
+        }
+        store->pending = pending;
+        store->pending_capacity = capacity;
+    }
+    memmove(store->pending + size, store->pending, store->pending_len);
+    memcpy(store->pending, records, size);
+    store->pending_len += size;
+}
+
+/*
+ * Start the next log generation and write a snapshot of every user, which replaces the previous logs.
+ * Called by the committer with the mutex held; the files are created, written and synced without it.
+ */
+static void compact(UserStore *store) {
+    uint64_t next = store->generation + 1;
+    // only the committer changes the generation, it can be read without the mutex
+    pthread_mutex_unlock(&store->mutex);
+    int fd = create_log(store, next);
+    pthread_mutex_lock(&store->mutex);
+    if (fd < 0) return;
+
+    size_t size = FILE_HEADER_SIZE;
+    for (size_t u = 0; u < store->count; u++) {
+        size += RECORD_HEADER_SIZE + RECORD_FIXED_SIZE + strlen(store->users[u].username) + strlen(store->users[u].bio);
+    }
+    uint8_t *snapshot = malloc(size);
+    if (!snapshot) {
+        close(fd);
+        return;
+    }
+    write_file_header(snapshot, snapshot_magic, next);
+    size_t len = FILE_HEADER_SIZE;
+    for (size_t u = 0; u < store->count; u++) len += encode_record(&store->users[u], snapshot + len);
+    size_t count = store->count;
+    // records older than the snapshot must not be replayed after it: they end the previous log
+    size_t older_size;
+    uint8_t *older = take_pending(store, &older_size);
+    uint64_t appended = store->appended;
+    size_t previous_bytes = store->log_bytes;
+    int previous_fd = store->log_fd;
+    store->log_fd = fd;
+    store->generation = next;
+    store->log_bytes = FILE_HEADER_SIZE;
+    pthread_mutex_unlock(&store->mutex);
+
+    int committed = older_size == 0 || commit_records(previous_fd, previous_bytes, older, older_size) == 0;
+
+    char tmp[PATH_MAX], path[PATH_MAX];
+    snapshot_path(store, tmp, 1);
+    snapshot_path(store, path, 0);
+    int snapshot_fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    int ok = snapshot_fd >= 0 && write_all(snapshot_fd, snapshot, len) == 0 && fsync(snapshot_fd) == 0;
+    if (snapshot_fd >= 0) close(snapshot_fd);
+    ok = ok && rename(tmp, path) == 0;
+    if (ok) {
+        sync_dir(store->dir);
+        // until the snapshot is in place, the previous log is still needed
+        log_path(store, next - 1, path);
+        unlink(path);
+        printf("User store: snapshot of %zu users written (%zu bytes)\n", count, len);
+    } else {
+        perror("User store: snapshot");
+    }
+    close(previous_fd);
+    free(snapshot);
+    pthread_mutex_lock(&store->mutex);
+    if (ok) store->snapshot_bytes = len;
+    if (committed || ok) {
+        // the snapshot holds the changes of the records as well
+        store->durable = appended;
+        pthread_cond_broadcast(&store->committed);
+    } else {
+        // then they go to the new log, before the records appended since
+        requeue_records(store, older, older_size);
+    }
+}
+
+static void *run_committer(void *arg) {
+    UserStore *store = arg;
+    pthread_mutex_lock(&store->mutex);
+    while (1) {
+        if (!store->closing) {
+            // the records appended during the interval are committed together
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_nsec += USER_STORE_COMMIT_INTERVAL_MS * 1000000L;
+            deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+            deadline.tv_nsec %= 1000000000L;
+            pthread_cond_timedwait(&store->wake, &store->mutex, &deadline);
+        }
+        int failed = 0;
+        if (store->pending_len > 0) {
+            // the appenders fill the other buffer while this one is written
+            size_t size;
+            uint8_t *records = take_pending(store, &size);
+            uint64_t appended = store->appended;
+            int fd = store->log_fd;
+            size_t log_bytes = store->log_bytes;
+            pthread_mutex_unlock(&store->mutex);
+            failed = commit_records(fd, log_bytes, records, size) < 0;
+            pthread_mutex_lock(&store->mutex);
+            if (failed) {
+                requeue_records(store, records, size);
+            } else {
+                store->log_bytes += size;
+                store->durable = appended;
+                pthread_cond_broadcast(&store->committed);
+                if (store->log_bytes > USER_STORE_COMPACT_BYTES && store->log_bytes > store->snapshot_bytes) {
+                    compact(store);
+                }
+            }
+        }
+        if (store->closing && (store->pending_len == 0 || failed)) {
+            if (failed) {
+                fprintf(stderr, "User store: %llu changes could not be saved\n",
+                        (unsigned long long) (store->appended - store->durable));
+            }
+            break;
+        }
+    }
+    pthread_mutex_unlock(&store->mutex);
+    return NULL;
+}
+
+// ---------------------- API ---------------------- //
+int user_store_open(UserStore *store, const char *dir, int32_t reserved_id) {
+    memset(store, 0, sizeof(UserStore));
+    store->log_fd = -1;
+    store->reserved_id = reserved_id;
+    store->capacity = USER_STORE_MIN_CAPACITY;
+    store->name_capacity = USER_STORE_MIN_CAPACITY * 2;
+    store->users = malloc(store->capacity * sizeof(StoredUser));
+    store->by_name = malloc(store->name_capacity * sizeof(int));
+    if (!store->users || !store->by_name || user_index_init(&store->by_id, store->capacity) < 0) {
+        free(store->users);
+        free(store->by_name);
+        return -1;
+    }
+    for (size_t b = 0; b < store->name_capacity; b++) store->by_name[b] = -1;
+    pthread_mutex_init(&store->mutex, NULL);
+    pthread_cond_init(&store->wake, NULL);
+    pthread_cond_init(&store->committed, NULL);
+    if (!dir) return 0;
+
+    store->dir = dir;
+    if (mkdir(dir, 0755) < 0 && errno != EEXIST) {
+        perror(dir);
+        return -1;
+    }
+    if (load(store) < 0) return -1;
+    if (pthread_create(&store->committer, NULL, run_committer, store) != 0) return -1;
+    store->has_committer = 1;
+    return 0;
+}
+
+void user_store_close(UserStore *store) {
+    pthread_mutex_lock(&store->mutex);
+    store->closing = 1;
+    pthread_cond_signal(&store->wake);
+    pthread_mutex_unlock(&store->mutex);
+    if (store->has_committer) pthread_join(store->committer, NULL);
+    if (store->log_fd >= 0) close(store->log_fd);
+    for (size_t u = 0; u < store->count; u++) free(store->users[u].bio);
+    free(store->users);
+    free(store->by_name);
+    free(store->pending);
+    free(store->spare);
+    user_index_free(&store->by_id);
+    pthread_mutex_destroy(&store->mutex);
+    pthread_cond_destroy(&store->wake);
+    pthread_cond_destroy(&store->committed);
+}
+
+int user_store_flush(UserStore *store) {
+    pthread_mutex_lock(&store->mutex);
+    uint64_t target = store->appended;
+    uint64_t failed_commits = store->failed_commits;
+    if (store->has_committer) {
+        pthread_cond_signal(&store->wake);
+        while (store->durable < target && store->failed_commits == failed_commits) {
+            pthread_cond_wait(&store->committed, &store->mutex);
+        }
+    }
+    int flushed = !store->has_committer || store->durable >= target;
+    pthread_mutex_unlock(&store->mutex);
+    return flushed ? 0 : -1;
+}
+
+int user_store_login(UserStore *store, const char *username, User *user, char *bio) {
+    pthread_mutex_lock(&store->mutex);
+    int index = find_by_name(store, username);
+    int created = index == -1;
+    if (created) {
+        StoredUser fresh;
+        memset(&fresh, 0, sizeof(fresh));
+        snprintf(fresh.username, sizeof(fresh.username), "%s", username);
+        fresh.id = store->last_id + 1;
+        if (fresh.id == store->reserved_id) fresh.id++;
+        fresh.bio = "";
+        index = add_user(store, &fresh);
+        if (index != -1) append_record(store, &store->users[index]);
+    }
+    if (index != -1) copy_out(&store->users[index], user, bio);
+    pthread_mutex_unlock(&store->mutex);
+    return index == -1 ? -1 : created;
+}
+
+int user_store_get(UserStore *store, int32_t id, User *user, char *bio) {
+    pthread_mutex_lock(&store->mutex);
+    int index = user_index_get(&store->by_id, id);
+    if (index != -1) copy_out(&store->users[index], user, bio);
+    pthread_mutex_unlock(&store->mutex);
+    return index == -1 ? -1 : 0;
+}
+
+int user_store_set_bio(UserStore *store, int32_t id, const char *bio) {
+    pthread_mutex_lock(&store->mutex);
+    int index = user_index_get(&store->by_id, id);
+    int changed = index == -1 ? -1 : set_bio(&store->users[index], bio);
+    if (changed == 1) append_record(store, &store->users[index]);
+    pthread_mutex_unlock(&store->mutex);
+    return changed < 0 ? -1 : 0;
+}
+
+int user_store_record_game(UserStore *store, int32_t id, int won, int score) {
+    pthread_mutex_lock(&store->mutex);
+    int index = user_index_get(&store->by_id, id);
+    if (index != -1) {
+        StoredUser *user = &store->users[index];
+        user->total_games++;
+        user->total_wins += won != 0;
+        user->total_score += score;
+        append_record(store, user);
+    }
+    pthread_mutex_unlock(&store->mutex);
+    return index == -1 ? -1 : 0;
+}
+
+void user_store_for_each(UserStore *store, void (*visit)(const StoredUser *user, void *arg), void *arg) {
+    pthread_mutex_lock(&store->mutex);
+    for (size_t u = 0; u < store->count; u++) visit(&store->users[u], arg);
+    pthread_mutex_unlock(&store->mutex);
+}
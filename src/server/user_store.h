@@ -0,0 +1,92 @@
+#pragma once
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "../common/model.h"
+#include "client_index.h"
+
+/*
+ * Accounts of the players, kept across restarts: id, username, bio and statistics.
+ * Every user lives in memory, indexed by id and by username, so lookups never touch the disk.
+ * Every change is appended to a write-ahead log (users.<generation>.log in the data directory) and made durable by
+ * a committer thread, which writes and fsyncs everything appended since its previous pass at once (group commit).
+ * Once the log grows too big, the committer starts the next log generation and writes a compacted snapshot
+ * (users.snapshot) of all the users, then removes the previous log.
+ * At startup the snapshot is loaded and the logs of its generation and the next ones are replayed; a record torn by
+ * a crash ends the replay and is cut off.
+ *
+ * Thread-safe: the calls are serialized by the store mutex.
+ */
+
+#define USER_STORE_COMMIT_INTERVAL_MS 5
+#define USER_STORE_COMPACT_BYTES (4 << 20) // log size above which a snapshot is written
+
+typedef struct StoredUser {
+    int32_t id;
+    int32_t total_score;
+    int32_t total_games;
+    int32_t total_wins;
+    char username[USERNAME_SIZE + 1];
+    char *bio; // never NULL
+} StoredUser;
+
+typedef struct UserStore {
+    pthread_mutex_t mutex;
+    StoredUser *users;
+    size_t count;
+    size_t capacity;
+    UserIndex by_id; // id -> index in users
+    int *by_name; // open addressing on the username hash, index in users or -1
+    size_t name_capacity; // power of two, at least twice count
+    int32_t last_id;
+    int32_t reserved_id; // never given to a user (the bot), 0 for none
+    // persistence, unused when the store has no directory
+    const char *dir;
+    int log_fd;
+    uint64_t generation; // of the log being appended to
+    size_t log_bytes;
+    size_t snapshot_bytes; // size of the last snapshot
+    uint8_t *pending; // records appended since the last commit
+    size_t pending_len;
+    size_t pending_capacity;
+    uint8_t *spare; // buffer the committer writes while the next records go to pending
+    size_t spare_capacity;
+    uint64_t appended; // records appended so far
+    uint64_t durable; // of them, written and synced
+    uint64_t failed_commits; // commits that could not be written, their records are kept for the next one
+    int closing;
+    pthread_cond_t wake; // the committer has work to do
+    pthread_cond_t committed; // durable changed
+    pthread_t committer;
+    int has_committer;
+} UserStore;
+
+/*
+ * Load the store of @dir (created if needed), or start an empty in-memory store when @dir is NULL.
+ * @reserved_id is never given to a user. Returns -1 if the files could not be read or created.
+ */
+int user_store_open(UserStore *store, const char *dir, int32_t reserved_id);
+
+// Commit what was appended, stop the committer and release everything
+void user_store_close(UserStore *store);
+
+// Block until every change made so far is on disk. Returns -1 if a commit failed in the meantime.
+int user_store_flush(UserStore *store);
+
+/*
+ * Find the user named @username, or create it with the next id. The user is copied to @user, its bio to @bio
+ * (BIO_SIZE + 1 bytes) which @user->bio points to. Returns 1 if the user was created, 0 if it existed, -1 on failure.
+ */
+int user_store_login(UserStore *store, const char *username, User *user, char *bio);
+
+// Copy the user @id like user_store_login. Returns -1 if there is no such user.
+int user_store_get(UserStore *store, int32_t id, User *user, char *bio);
+
+// Replace the bio of the user @id. Returns -1 if there is no such user.
+int user_store_set_bio(UserStore *store, int32_t id, const char *bio);
+
+// Count a finished game of the user @id, with the seeds it captured. Returns -1 if there is no such user.
+int user_store_record_game(UserStore *store, int32_t id, int won, int score);
+
+// Call @visit for every user, under the store mutex
+void user_store_for_each(UserStore *store, void (*visit)(const StoredUser *user, void *arg), void *arg);
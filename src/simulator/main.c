@@ -0,0 +1,270 @@
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../common/ai.h"
+#include "../common/model.h"
+#include "../common/rules.h"
+
+#define DEFAULT_GAMES 100000
+#define DEFAULT_ENGINE_NODES 2000
+#define ENGINE_TT_ENTRIES (1 << 16)
+#define MAX_GAME_MOVES 1000 // games without round limit are cut there, as draws
+#define DUMP_BUFFER_SIZE (64 * 1024)
+
+/*
+ * Headless batch simulator: plays games between random and engine players on every core, with the server rules or
+ * a variant of their end conditions, and reports the throughput and the outcomes.
+ * The engines search with the default end conditions (ai.c), the referee applies the variant.
+ */
+
+typedef enum PlayerKind {
+    PLAYER_RANDOM,
+    PLAYER_ENGINE
+} PlayerKind;
+
+typedef enum Outcome {
+    OUTCOME_DRAW, // more than max_rounds moves
+    OUTCOME_PLAYER1,
+    OUTCOME_PLAYER2,
+    OUTCOME_BLOCKED, // the player to move has no legal move
+    NB_OUTCOMES
+} Outcome;
+
+static const char *outcome_names[NB_OUTCOMES] = {"draw", "player 1 wins", "player 2 wins", "no legal move"};
+
+typedef struct Simulation {
+    long games;
+    GameRules rules;
+    PlayerKind players[2];
+    AiLimits engine_limits;
+    unsigned int seed;
+    FILE *dump;
+    pthread_mutex_t dump_mutex;
+} Simulation;
+
+typedef struct Worker {
+    Simulation *simulation;
+    pthread_t thread;
+    int threaded; // runs on its own thread, to be joined
+    int id;
+    long first_game;
+    long games;
+    // results
+    long moves;
+    long outcomes[NB_OUTCOMES];
+    long scores[2];
+    long engine_nodes;
+} Worker;
+
+static int randomMove(unsigned int legal, unsigned int *seed) {
+    int skip = rand_r(seed) % __builtin_popcount(legal);
+    while (skip--) legal &= legal - 1;
+    return __builtin_ctz(legal) + 1;
+}
+
+static void flushDump(Simulation *simulation, char *buffer, size_t *len) {
+    if (*len == 0) return;
+    pthread_mutex_lock(&simulation->dump_mutex);
+    fwrite(buffer, 1, *len, simulation->dump);
+    pthread_mutex_unlock(&simulation->dump_mutex);
+    *len = 0;
+}
+
+static void *runWorker(void *arg) {
+    Worker *worker = arg;
+    Simulation *simulation = worker->simulation;
+    const GameRules *rules = &simulation->rules;
+    unsigned int seed = simulation->seed + (unsigned int) worker->id * 7919U;
+    AiSearch *search = NULL;
+    if (simulation->players[0] == PLAYER_ENGINE || simulation->players[1] == PLAYER_ENGINE) {
+        if (!(search = aiCreate(ENGINE_TT_ENTRIES))) {
+            fprintf(stderr, "Worker %d: out of memory\n", worker->id);
+            // its games are not played, they stay out of the totals
+            worker->games = 0;
+            return NULL;
+        }
+    }
+    char *dump = simulation->dump ? malloc(DUMP_BUFFER_SIZE) : NULL;
+    size_t dump_len = 0;
+
+    Player player1 = newPlayer(1, -1), player2 = newPlayer(2, -1);
+    Game *start = newGame(&player1, &player2);
+    if (!start) {
+        fprintf(stderr, "Worker %d: out of memory\n", worker->id);
+        worker->games = 0;
+        free(dump);
+        aiDestroy(search);
+        return NULL;
+    }
+    PackedBoard start_board = packBoard(start->board);
+    free(start);
+
+    int max_moves = rules->max_rounds >= 0 && rules->max_rounds < MAX_GAME_MOVES ? rules->max_rounds + 1 : MAX_GAME_MOVES;
+    char moves[MAX_GAME_MOVES + 1];
+    for (long g = 0; g < worker->games; g++) {
+        AiPosition position = {start_board, {0, 0}, 1, -1};
+        Outcome outcome = OUTCOME_DRAW;
+        int tours = 0;
+        while (tours < max_moves) {
+            int player = position.to_move;
+            unsigned int legal = packedLegalMoves(&position.board, player);
+            if (!legal) {
+                outcome = OUTCOME_BLOCKED;
+                break;
+            }
+            int move;
+            if (simulation->players[player - 1] == PLAYER_ENGINE) {
+                position.plies_left = max_moves - tours;
+                AiResult result = aiBestMove(search, &position, &simulation->engine_limits);
+                worker->engine_nodes += result.nodes;
+                move = result.move;
+            } else {
+                move = randomMove(legal, &seed);
+            }
+            int points = packedPlayMove(&position.board, player, move);
+            position.scores[player - 1] += points;
+            position.to_move = 3 - player;
+            moves[tours++] = (char) ('0' + move);
+            int winner = gameWinnerWithRules(&position.board, position.scores[0], position.scores[1], rules);
+            if (winner) {
+                outcome = winner == 1 ? OUTCOME_PLAYER1 : OUTCOME_PLAYER2;
+                break;
+            }
+        }
+        worker->moves += tours;
+        worker->outcomes[outcome]++;
+        worker->scores[0] += position.scores[0];
+        worker->scores[1] += position.scores[1];
+
+        if (dump) {
+            // game number, outcome, scores, then one digit per move
+            if (DUMP_BUFFER_SIZE - dump_len < MAX_GAME_MOVES + 64) flushDump(simulation, dump, &dump_len);
+            moves[tours] = '\0';
+            dump_len += (size_t) snprintf(dump + dump_len, DUMP_BUFFER_SIZE - dump_len, "%ld %d %d %d %s\n",
+                                          worker->first_game + g, outcome, position.scores[0], position.scores[1], moves);
+        }
+    }
+    if (dump) {
+        flushDump(simulation, dump, &dump_len);
+        free(dump);
+    }
+    aiDestroy(search);
+    return NULL;
+}
+
+static int parsePlayer(const char *name, PlayerKind *kind) {
+    if (strcmp(name, "random") == 0) *kind = PLAYER_RANDOM;
+    else if (strcmp(name, "engine") == 0) *kind = PLAYER_ENGINE;
+    else return -1;
+    return 0;
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "Usage: %s [--games N] [--threads N] [--p1 random|engine] [--p2 random|engine] [--engine-nodes N]\n"
+                    "          [--engine-depth D] [--max-rounds N (-1: none)] [--winning-score N] [--min-seeds N]\n"
+                    "          [--seed S] [--dump FILE]\n", name);
+}
+
+int main(int argc, char **argv) {
+    Simulation simulation = {
+        .games = DEFAULT_GAMES,
+        .rules = DEFAULT_GAME_RULES,
+        .players = {PLAYER_RANDOM, PLAYER_RANDOM},
+        .engine_limits = {DEFAULT_ENGINE_NODES, 0, 0},
+        .seed = (unsigned int) time(NULL),
+        .dump = NULL
+    };
+    int threads = 0;
+    const char *dump_path = NULL;
+    for (int a = 1; a < argc; a++) {
+        if (strcmp(argv[a], "--games") == 0 && a + 1 < argc) {
+            simulation.games = atol(argv[++a]);
+        } else if (strcmp(argv[a], "--threads") == 0 && a + 1 < argc) {
+            threads = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "--p1") == 0 && a + 1 < argc && parsePlayer(argv[a + 1], &simulation.players[0]) == 0) {
+            a++;
+        } else if (strcmp(argv[a], "--p2") == 0 && a + 1 < argc && parsePlayer(argv[a + 1], &simulation.players[1]) == 0) {
+            a++;
+        } else if (strcmp(argv[a], "--engine-nodes") == 0 && a + 1 < argc) {
+            simulation.engine_limits.max_nodes = atol(argv[++a]);
+        } else if (strcmp(argv[a], "--engine-depth") == 0 && a + 1 < argc) {
+            simulation.engine_limits.max_depth = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "--max-rounds") == 0 && a + 1 < argc) {
+            simulation.rules.max_rounds = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "--winning-score") == 0 && a + 1 < argc) {
+            simulation.rules.winning_score = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "--min-seeds") == 0 && a + 1 < argc) {
+            simulation.rules.min_seeds = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "--seed") == 0 && a + 1 < argc) {
+            simulation.seed = (unsigned int) strtoul(argv[++a], NULL, 10);
+        } else if (strcmp(argv[a], "--dump") == 0 && a + 1 < argc) {
+            dump_path = argv[++a];
+        } else {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (threads <= 0) threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads < 1) threads = 1;
+    if (dump_path && !(simulation.dump = fopen(dump_path, "w"))) {
+        perror(dump_path);
+        return EXIT_FAILURE;
+    }
+    pthread_mutex_init(&simulation.dump_mutex, NULL);
+
+    Worker *workers = calloc(threads, sizeof(Worker));
+    if (!workers) return EXIT_FAILURE;
+    printf("Playing %ld games (%s vs %s) on %d threads, max rounds %d, winning score %d, min seeds %d\n",
+           simulation.games, simulation.players[0] == PLAYER_ENGINE ? "engine" : "random",
+           simulation.players[1] == PLAYER_ENGINE ? "engine" : "random", threads, simulation.rules.max_rounds,
+           simulation.rules.winning_score, simulation.rules.min_seeds);
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int t = 0; t < threads; t++) {
+        workers[t].simulation = &simulation;
+        workers[t].id = t;
+        workers[t].first_game = simulation.games * t / threads;
+        workers[t].games = simulation.games * (t + 1) / threads - workers[t].first_game;
+        // worker 0 runs on this thread
+        if (t > 0) workers[t].threaded = pthread_create(&workers[t].thread, NULL, runWorker, &workers[t]) == 0;
+    }
+    for (int t = 0; t < threads; t++) {
+        // no thread: its games are played by the calling one
+        if (!workers[t].threaded) runWorker(&workers[t]);
+    }
+    for (int t = 1; t < threads; t++) {
+        if (workers[t].threaded) pthread_join(workers[t].thread, NULL);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (double) (end.tv_sec - start.tv_sec) + (double) (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    long games = 0, moves = 0, nodes = 0, outcomes[NB_OUTCOMES] = {0}, scores[2] = {0, 0};
+    for (int t = 0; t < threads; t++) {
+        games += workers[t].games;
+        moves += workers[t].moves;
+        nodes += workers[t].engine_nodes;
+        scores[0] += workers[t].scores[0];
+        scores[1] += workers[t].scores[1];
+        for (int o = 0; o < NB_OUTCOMES; o++) outcomes[o] += workers[t].outcomes[o];
+    }
+    if (games == 0) {
+        fprintf(stderr, "No game played\n");
+        return EXIT_FAILURE;
+    }
+    printf("%ld games, %ld moves in %.3f s: %.0f games/s, %.0f moves/s", games, moves, seconds, games / seconds,
+           moves / seconds);
+    if (nodes) printf(", %.0f engine nodes/s", nodes / seconds);
+    printf("\n%.2f moves per game, average score %.2f - %.2f\n", (double) moves / games, (double) scores[0] / games,
+           (double) scores[1] / games);
+    for (int o = 0; o < NB_OUTCOMES; o++) {
+        printf("%-14s %10ld  %5.1f%%\n", outcome_names[o], outcomes[o], 100.0 * outcomes[o] / games);
+    }
+    if (simulation.dump) fclose(simulation.dump);
+    free(workers);
+    return EXIT_SUCCESS;
+}
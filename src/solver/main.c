@@ -0,0 +1,80 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../common/model.h"
+#include "../common/solver.h"
+
+/*
+ * Solves an Awalé position with every core.
+ * The board is given as its 12 pits, in the order of Game.board (pits 0-5 are player 1's row).
+ */
+static void usage(const char *name) {
+    fprintf(stderr, "Usage: %s [--threads N] [--time MS] [--depth D] [--tt-mb MB] [--to-move 1|2] [--scores S1 S2]\n"
+                    "          [--plies-left N] [p0 p1 ... p11]\n"
+                    "  Without pits, solves the starting position. --plies-left -1 (default) plays without the\n"
+                    "  server's draw after %d moves.\n", name, MAX_ROUNDS + 1);
+}
+
+int main(int argc, char **argv) {
+    SolverOptions options = {0, 0, 0, 0};
+    int board[12];
+    for (int i = 0; i < 12; i++) board[i] = 4;
+    int scores[2] = {0, 0};
+    int to_move = 1;
+    int plies_left = -1;
+    int nb_pits = 0;
+
+    for (int a = 1; a < argc; a++) {
+        if (strcmp(argv[a], "--threads") == 0 && a + 1 < argc) {
+            options.threads = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "--time") == 0 && a + 1 < argc) {
+            options.max_time_ms = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "--depth") == 0 && a + 1 < argc) {
+            options.max_depth = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "--tt-mb") == 0 && a + 1 < argc) {
+            options.tt_megabytes = strtoul(argv[++a], NULL, 10);
+        } else if (strcmp(argv[a], "--to-move") == 0 && a + 1 < argc) {
+            to_move = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "--scores") == 0 && a + 2 < argc) {
+            scores[0] = atoi(argv[++a]);
+            scores[1] = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "--plies-left") == 0 && a + 1 < argc) {
+            plies_left = atoi(argv[++a]);
+        } else if (argv[a][0] != '-' && nb_pits < 12) {
+            board[nb_pits++] = atoi(argv[a]);
+        } else {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    int seeds = scores[0] + scores[1];
+    for (int i = 0; i < 12; i++) seeds += board[i] < 0 ? 1000 : board[i];
+    if ((nb_pits != 0 && nb_pits != 12) || (to_move != 1 && to_move != 2) || seeds > 48) {
+        fprintf(stderr, "Invalid position: 12 pits and the scores hold at most 48 seeds.\n");
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (options.max_time_ms == 0 && options.max_depth == 0 && plies_left < 0) {
+        // an unbounded game would never end the search
+        options.max_time_ms = 5000;
+    }
+
+    AiPosition position;
+    position.board = packBoard(board);
+    position.scores[0] = scores[0];
+    position.scores[1] = scores[1];
+    position.to_move = to_move;
+    position.plies_left = plies_left;
+    printBoard(board, to_move);
+
+    SolverResult result = solvePosition(&position, &options);
+    if (result.move == -1) {
+        printf("No legal move for player %d\n", to_move);
+        return EXIT_SUCCESS;
+    }
+    printf("best_move=%d value=%d proven=%d depth=%d nodes=%ld seconds=%.3f nps=%.0f\n", result.move, result.value,
+           result.proven, result.depth, result.nodes, result.seconds,
+           result.seconds > 0 ? result.nodes / result.seconds : 0.0);
+    return EXIT_SUCCESS;
+}
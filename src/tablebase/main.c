@@ -0,0 +1,245 @@
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../common/rules.h"
+#include "../common/tablebase.h"
+#include "../common/utils.h"
+
+#define DEFAULT_SEEDS 14
+#define DEFAULT_OUTPUT "awalnet.tb"
+
+/*
+ * Retrograde generator of the endgame tablebase (see tablebase.h), layer by layer of seeds on the board.
+ * A capture leads to a smaller layer, already solved. Inside a layer, the non-capturing moves can loop, so the layer
+ * is solved by sweeps: sweep k gives the value of the game cut after k moves inside the layer (the cut counting as
+ * no more captures), computed from sweep k - 1 only. Once a sweep changes nothing, every value is exact.
+ * The moves are played once per layer: a sweep only reads the best capture of each board and the index of its
+ * non-capturing children.
+ */
+
+typedef struct Layer {
+    uint32_t start; // index of the first board of the layer
+    uint32_t size;
+    int8_t *captures; // best value of the capturing moves (and 0 when there is no legal move), -128 if none
+    uint32_t *first_child; // children of board k: children[first_child[k]] to children[first_child[k + 1]] excluded
+    uint32_t *children; // index in the layer of the boards reached without capture
+    size_t nb_children;
+    size_t children_capacity;
+} Layer;
+
+typedef struct Sweep {
+    const Layer *layer;
+    const int8_t *current; // previous sweep
+    int8_t *next;
+    uint32_t from;
+    uint32_t to;
+    long changed;
+} Sweep;
+
+// Next board with the same seeds, in index order. Returns 0 after the last one.
+static int nextBoard(int *pits) {
+    int rest = 0;
+    int j = 10;
+    for (; j >= 0; j--) {
+        rest += pits[j + 1];
+        if (rest > 0) break;
+    }
+    if (j < 0) return 0;
+    pits[j]++;
+    for (int i = j + 1; i < 12; i++) pits[i] = 0;
+    pits[11] = rest - 1;
+    return 1;
+}
+
+static int addChild(Layer *layer, uint32_t child) {
+    if (layer->nb_children == layer->children_capacity) {
+        size_t capacity = layer->children_capacity ? layer->children_capacity * 2 : 4096;
+        uint32_t *children = realloc(layer->children, capacity * sizeof(uint32_t));
+        if (!children) return -1;
+        layer->children = children;
+        layer->children_capacity = capacity;
+    }
+    layer->children[layer->nb_children++] = child;
+    return 0;
+}
+
+// Plays every move of every board of the layer
+static int buildLayer(Layer *layer, const int8_t *values, int seeds) {
+    int pits[12] = {0};
+    pits[11] = seeds;
+    uint32_t k = 0;
+    do {
+        PackedBoard board = packBoard(pits);
+        unsigned int legal = packedLegalMoves(&board, 1);
+        // no legal move: the game is over, nothing more is captured
+        int best = legal ? -128 : 0;
+        layer->first_child[k] = (uint32_t) layer->nb_children;
+        for (int move = 1; move <= 6; move++) {
+            if (!((legal >> (move - 1)) & 1)) continue;
+            PackedBoard child = board;
+            int points = packedPlayMove(&child, 1, move);
+            int absolute[12], opponent[12];
+            unpackBoard(&child, absolute);
+            for (int i = 0; i < 12; i++) opponent[i] = absolute[(i + 6) % 12];
+            uint32_t index = tablebaseIndex(opponent);
+            if (points == 0) {
+                if (addChild(layer, index - layer->start) < 0) return -1;
+            } else if (points - values[index] > best) {
+                best = points - values[index];
+            }
+        }
+        layer->captures[k] = (int8_t) best;
+        k++;
+    } while (nextBoard(pits));
+    layer->first_child[k] = (uint32_t) layer->nb_children;
+    return 0;
+}
+
+static void *runSweep(void *arg) {
+    Sweep *sweep = arg;
+    const Layer *layer = sweep->layer;
+    for (uint32_t k = sweep->from; k < sweep->to; k++) {
+        int best = layer->captures[k];
+        for (uint32_t c = layer->first_child[k]; c < layer->first_child[k + 1]; c++) {
+            int value = -sweep->current[layer->children[c]];
+            if (value > best) best = value;
+        }
+        if (best != sweep->current[k]) sweep->changed++;
+        sweep->next[k] = (int8_t) best;
+    }
+    return NULL;
+}
+
+static double elapsedSince(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double) (now.tv_sec - start->tv_sec) + (double) (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// Sweeps until nothing changes, on @threads threads. Returns the number of sweeps.
+static int sweepLayer(const Layer *layer, int8_t *current, int8_t *next, int threads) {
+    Sweep sweeps[threads];
+    pthread_t ids[threads];
+    long changed;
+    int rounds = 0;
+    memset(current, 0, layer->size);
+    do {
+        changed = 0;
+        for (int t = 0; t < threads; t++) {
+            uint32_t from = (uint32_t) ((uint64_t) layer->size * t / threads);
+            uint32_t to = (uint32_t) ((uint64_t) layer->size * (t + 1) / threads);
+            sweeps[t] = (Sweep) {layer, current, next, from, to, 0};
+            ids[t] = 0;
+            if (t > 0 && pthread_create(&ids[t], NULL, runSweep, &sweeps[t]) != 0) {
+                // no thread: done by the calling one
+                runSweep(&sweeps[t]);
+                ids[t] = 0;
+            }
+        }
+        runSweep(&sweeps[0]);
+        for (int t = 0; t < threads; t++) {
+            if (ids[t]) pthread_join(ids[t], NULL);
+            changed += sweeps[t].changed;
+        }
+        memcpy(current, next, layer->size);
+        rounds++;
+    } while (changed);
+    return rounds;
+}
+
+// Returns the number of sweeps, -1 if out of memory
+static int solveLayer(int8_t *values, int seeds, int threads) {
+    Layer layer = {0};
+    layer.start = seeds ? tablebaseEntries(seeds - 1) : 0;
+    layer.size = tablebaseEntries(seeds) - layer.start;
+    layer.captures = malloc(layer.size);
+    layer.first_child = malloc(((size_t) layer.size + 1) * sizeof(uint32_t));
+    int8_t *next = malloc(layer.size);
+    int rounds = -1;
+    if (layer.captures && layer.first_child && next && buildLayer(&layer, values, seeds) == 0) {
+        rounds = sweepLayer(&layer, values + layer.start, next, threads);
+    }
+    free(layer.captures);
+    free(layer.first_child);
+    free(layer.children);
+    free(next);
+    return rounds;
+}
+
+static int writeTable(const char *path, const int8_t *values, int max_seeds) {
+    uint8_t header[TABLEBASE_HEADER_SIZE];
+    uint32_t entries = tablebaseEntries(max_seeds);
+    memcpy(header, TABLEBASE_MAGIC, 4);
+    write_int32_le(header, 4, TABLEBASE_VERSION);
+    write_int32_le(header, 8, max_seeds);
+    write_int32_le(header, 12, (int32_t) entries);
+
+    // written aside then renamed, the servers mapping the previous table keep reading it
+    char tmp_path[4096];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    FILE *file = fopen(tmp_path, "wb");
+    if (!file) return -1;
+    int ok = fwrite(header, 1, sizeof(header), file) == sizeof(header) && fwrite(values, 1, entries, file) == entries;
+    if (fclose(file) != 0) ok = 0;
+    if (!ok || rename(tmp_path, path) != 0) {
+        unlink(tmp_path);
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    int max_seeds = DEFAULT_SEEDS;
+    int threads = 0;
+    const char *output = DEFAULT_OUTPUT;
+    for (int a = 1; a < argc; a++) {
+        if (strcmp(argv[a], "--seeds") == 0 && a + 1 < argc) {
+            max_seeds = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "--threads") == 0 && a + 1 < argc) {
+            threads = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "--output") == 0 && a + 1 < argc) {
+            output = argv[++a];
+        } else {
+            fprintf(stderr, "Usage: %s [--seeds K (default %d, at most %d)] [--threads N] [--output FILE (default %s)]\n",
+                    argv[0], DEFAULT_SEEDS, TABLEBASE_MAX_SEEDS, DEFAULT_OUTPUT);
+            return EXIT_FAILURE;
+        }
+    }
+    if (max_seeds < 0 || max_seeds > TABLEBASE_MAX_SEEDS) {
+        fprintf(stderr, "--seeds must be between 0 and %d\n", TABLEBASE_MAX_SEEDS);
+        return EXIT_FAILURE;
+    }
+    if (threads <= 0) threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads < 1) threads = 1;
+
+    uint32_t entries = tablebaseEntries(max_seeds);
+    int8_t *values = malloc(entries);
+    if (!values) {
+        perror("malloc");
+        return EXIT_FAILURE;
+    }
+    printf("Solving %u positions up to %d seeds on %d threads\n", entries, max_seeds, threads);
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int seeds = 0; seeds <= max_seeds; seeds++) {
+        int rounds = solveLayer(values, seeds, threads);
+        if (rounds < 0) {
+            perror("solveLayer");
+            return EXIT_FAILURE;
+        }
+        printf("%2d seeds: %10u positions, %3d sweeps, %.1f s\n", seeds,
+               tablebaseEntries(seeds) - (seeds ? tablebaseEntries(seeds - 1) : 0), rounds, elapsedSince(&start));
+    }
+    if (writeTable(output, values, max_seeds) < 0) {
+        perror(output);
+        return EXIT_FAILURE;
+    }
+    printf("Tablebase written to %s (%u bytes)\n", output, TABLEBASE_HEADER_SIZE + entries);
+    free(values);
+    return EXIT_SUCCESS;
+}